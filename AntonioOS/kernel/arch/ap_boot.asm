@@ -0,0 +1,92 @@
+; ap_boot.asm
+; Código de partida das CPUs secundárias (APs)
+;
+; smp_init copia o trecho entre ap_trampoline_start e ap_trampoline_end para
+; SMP_TRAMPOLINE (0x70000) e preenche as variáveis do fim. O SIPI começa a
+; execução em modo real em CS:IP = 0x7000:0000; daqui a AP passa para o modo
+; protegido, liga a paginação com o diretório do kernel e chama
+; ap_boot_entry(ap_boot_cpu) na pilha ap_boot_stack.
+
+TRAMPOLINE_BASE equ 0x70000
+
+; Deslocamento dentro do trampolim e endereço linear na cópia
+%define REL(label) ((label) - ap_trampoline_start)
+%define ABS(label) (TRAMPOLINE_BASE + REL(label))
+
+CR0_PE equ 0x1
+CR0_WP equ 0x10000
+CR0_PG equ 0x80000000
+
+global ap_trampoline_start
+global ap_trampoline_end
+global ap_boot_cr3
+global ap_boot_cr4
+global ap_boot_stack
+global ap_boot_cpu
+global ap_boot_entry
+
+section .text
+
+[BITS 16]
+ap_trampoline_start:
+    cli
+    cld
+    mov ax, cs                  ; ds = 0x7000: variáveis pelo deslocamento
+    mov ds, ax
+    lgdt [REL(ap_gdt_descriptor)]
+    
+    mov eax, cr0
+    or eax, CR0_PE
+    mov cr0, eax
+    
+    ; Far jump de 32 bits para o endereço linear da cópia
+    jmp dword 0x08:ABS(ap_protected)
+
+[BITS 32]
+ap_protected:
+    mov ax, 0x10
+    mov ds, ax
+    mov es, ax
+    mov ss, ax
+    mov fs, ax
+    mov gs, ax
+    
+    ; Mesma configuração de paginação da BSP (PSE/PGE precisam vir antes de PG)
+    mov eax, [ABS(ap_boot_cr4)]
+    mov cr4, eax
+    mov eax, [ABS(ap_boot_cr3)]
+    mov cr3, eax
+    mov eax, cr0
+    or eax, CR0_PG | CR0_WP
+    mov cr0, eax
+    
+    ; Pilha do processo idle desta CPU
+    mov esp, [ABS(ap_boot_stack)]
+    xor ebp, ebp
+    push dword [ABS(ap_boot_cpu)]
+    call [ABS(ap_boot_entry)]
+    
+    ; Não deveria chegar aqui
+.halt:
+    cli
+    hlt
+    jmp .halt
+
+; GDT provisória, só até smp_ap_main carregar a GDT do kernel
+align 8
+ap_gdt:
+    dq 0x0000000000000000       ; Nulo
+    dq 0x00CF9A000000FFFF       ; Código: base 0, limite 4GB, 32 bits
+    dq 0x00CF92000000FFFF       ; Dados: base 0, limite 4GB, 32 bits
+ap_gdt_descriptor:
+    dw 3 * 8 - 1
+    dd ABS(ap_gdt)
+
+; Preenchidas por smp_init na cópia
+align 4
+ap_boot_cr3:   dd 0             ; Diretório do kernel
+ap_boot_cr4:   dd 0             ; CR4 da BSP
+ap_boot_stack: dd 0             ; Topo da pilha
+ap_boot_cpu:   dd 0             ; cpu_t* desta AP
+ap_boot_entry: dd 0             ; Função em C (smp_ap_main)
+ap_trampoline_end:
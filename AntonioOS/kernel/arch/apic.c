@@ -0,0 +1,149 @@
+#include "../include/apic.h"
+#include "../include/cpu.h"
+#include "../include/memory.h"
+#include "../include/interrupts.h"
+#include "../include/process.h"
+#include "../include/timer.h"
+
+// Registradores do APIC local (deslocamento a partir da base)
+#define LAPIC_ID 0x020
+#define LAPIC_TPR 0x080
+#define LAPIC_EOI 0x0B0
+#define LAPIC_SVR 0x0F0
+#define LAPIC_ESR 0x280
+#define LAPIC_ICR_LOW 0x300
+#define LAPIC_ICR_HIGH 0x310
+#define LAPIC_LVT_TIMER 0x320
+#define LAPIC_TIMER_INITIAL 0x380
+#define LAPIC_TIMER_CURRENT 0x390
+#define LAPIC_TIMER_DIVIDE 0x3E0
+
+#define LAPIC_SVR_ENABLE 0x100        // APIC habilitado por software
+#define LAPIC_LVT_MASKED 0x10000
+#define LAPIC_TIMER_PERIODIC 0x20000
+#define LAPIC_TIMER_DIVIDE_16 0x3
+
+// Comandos do ICR
+#define LAPIC_ICR_FIXED 0x000
+#define LAPIC_ICR_INIT 0x500
+#define LAPIC_ICR_STARTUP 0x600
+#define LAPIC_ICR_PENDING 0x1000      // Envio ainda não concluído
+#define LAPIC_ICR_ASSERT 0x4000
+#define LAPIC_ICR_LEVEL 0x8000
+
+// Duração da medição do timer do APIC contra o PIT
+#define LAPIC_CALIBRATE_MS 10
+
+static volatile u32* lapic = NULL;
+static u32 lapic_ticks_per_ms = 0;    // Contagens do timer (divisor 16) por ms
+
+static inline u32 lapic_read(u32 reg) {
+    return lapic[reg / 4];
+}
+
+static inline void lapic_write(u32 reg, u32 value) {
+    lapic[reg / 4] = value;
+}
+
+// Escreve um comando no ICR e espera a entrega
+// As interrupções ficam desligadas entre a escrita das duas metades
+static void lapic_send(u32 apic_id, u32 command) {
+    u32 flags = cpu_irq_save();
+    lapic_write(LAPIC_ICR_HIGH, apic_id << 24);
+    lapic_write(LAPIC_ICR_LOW, command);
+    while (lapic_read(LAPIC_ICR_LOW) & LAPIC_ICR_PENDING) {
+        cpu_pause();
+    }
+    cpu_irq_restore(flags);
+}
+
+// Manipulador do timer do APIC local (quantum das CPUs secundárias)
+static void lapic_timer_irq(interrupt_frame_t* frame) {
+    (void)frame;
+    scheduler_tick(1);
+}
+
+// Mapeia os registradores do APIC local e habilita o da CPU atual
+void lapic_init(u32 base) {
+    // Registradores de dispositivo: nunca em cache
+    vmm_map_page((void*)base, (void*)base, PAGE_WRITE | PAGE_NOCACHE | vmm_kernel_flags());
+    lapic = (volatile u32*)base;
+    
+    interrupt_register_handler(INT_APIC_TIMER, lapic_timer_irq);
+    lapic_init_cpu();
+}
+
+// Habilita o APIC local da CPU atual
+// Na BSP, LINT0/LINT1 continuam como a BIOS deixou (PIC em modo virtual wire)
+void lapic_init_cpu() {
+    lapic_write(LAPIC_TPR, 0);
+    lapic_write(LAPIC_SVR, LAPIC_SVR_ENABLE | INT_APIC_SPURIOUS);
+    lapic_write(LAPIC_LVT_TIMER, LAPIC_LVT_MASKED);
+    lapic_write(LAPIC_ESR, 0);
+}
+
+// ID do APIC local da CPU atual
+u32 lapic_get_id() {
+    return lapic_read(LAPIC_ID) >> 24;
+}
+
+// Sinaliza o fim do tratamento de uma interrupção
+void lapic_eoi() {
+    lapic_write(LAPIC_EOI, 0);
+}
+
+// Sequência INIT-SIPI-SIPI da especificação MP
+void lapic_start_ap(u32 apic_id, u32 trampoline) {
+    lapic_write(LAPIC_ESR, 0);
+    lapic_send(apic_id, LAPIC_ICR_INIT | LAPIC_ICR_LEVEL | LAPIC_ICR_ASSERT);
+    lapic_send(apic_id, LAPIC_ICR_INIT | LAPIC_ICR_LEVEL);
+    timer_wait(10);
+    
+    // O segundo SIPI cobre CPUs que perderam o primeiro; uma AP que já
+    // partiu ignora SIPIs
+    for (u32 i = 0; i < 2; i++) {
+        lapic_send(apic_id, LAPIC_ICR_STARTUP | (trampoline >> 12));
+        timer_wait(1);
+    }
+}
+
+// Envia uma interrupção a outra CPU
+void lapic_send_ipi(u32 apic_id, u8 vector) {
+    lapic_send(apic_id, LAPIC_ICR_FIXED | LAPIC_ICR_ASSERT | vector);
+}
+
+// Mede quantas contagens o timer do APIC faz por ms, usando os ticks do PIT
+// A frequência do barramento é a mesma em todas as CPUs
+void lapic_timer_calibrate() {
+    lapic_write(LAPIC_TIMER_DIVIDE, LAPIC_TIMER_DIVIDE_16);
+    lapic_write(LAPIC_LVT_TIMER, LAPIC_LVT_MASKED);
+    
+    // Começa na borda de um tick para medir ticks inteiros
+    u64 start = timer_get_ticks();
+    while (timer_get_ticks() == start) {
+        cpu_pause();
+    }
+    lapic_write(LAPIC_TIMER_INITIAL, 0xFFFFFFFF);
+    u64 end = start + 1 + timer_ms_to_ticks(LAPIC_CALIBRATE_MS);
+    while (timer_get_ticks() < end) {
+        cpu_pause();
+    }
+    u32 elapsed = 0xFFFFFFFF - lapic_read(LAPIC_TIMER_CURRENT);
+    lapic_write(LAPIC_TIMER_INITIAL, 0);
+    
+    lapic_ticks_per_ms = elapsed / LAPIC_CALIBRATE_MS;
+}
+
+// Liga o timer do APIC local no modo periódico
+void lapic_timer_start(u32 frequency) {
+    u32 count = lapic_ticks_per_ms * 1000 / frequency;
+    lapic_write(LAPIC_TIMER_DIVIDE, LAPIC_TIMER_DIVIDE_16);
+    lapic_write(LAPIC_LVT_TIMER, INT_APIC_TIMER | LAPIC_TIMER_PERIODIC);
+    lapic_write(LAPIC_TIMER_INITIAL, count ? count : 1);
+}
+
+// Para o timer do APIC local
+void lapic_timer_stop() {
+    lapic_write(LAPIC_LVT_TIMER, LAPIC_LVT_MASKED);
+    lapic_write(LAPIC_TIMER_INITIAL, 0);
+}
@@ -0,0 +1,190 @@
+#include "../include/fpu.h"
+#include "../include/cpu.h"
+#include "../include/smp.h"
+#include "../include/interrupts.h"
+#include "../include/slab.h"
+#include "../include/vga.h"
+
+// MXCSR após o reset: todas as exceções SIMD mascaradas
+#define MXCSR_DEFAULT 0x1F80
+
+// Cada CPU guarda em cpu_t o processo cujo estado está carregado nos seus
+// registradores da FPU (fpu_owner) e uma cópia de CR0.TS (fpu_ts)
+// O estado só é salvo quando outro processo usar a FPU (troca preguiçosa)
+static u8 fpu_has_fxsr = 0;
+static u8 fpu_has_sse = 0;
+static kmem_cache_t* fpu_cache = NULL;
+
+// Registradores de uma seção do kernel interrompida por outra (falha de página)
+static u8 fpu_kernel_saved[SMP_MAX_CPUS][FPU_KERNEL_NEST][FPU_STATE_SIZE] __attribute__((aligned(16)));
+
+// Salva o estado da FPU (e do SSE, com fxsave) na área do processo
+static inline void fpu_save(void* area) {
+    if (fpu_has_fxsr) {
+        asm volatile("fxsave (%0)" : : "r"(area) : "memory");
+    } else {
+        asm volatile("fnsave (%0)" : : "r"(area) : "memory");
+    }
+}
+
+// Carrega o estado salvo por fpu_save
+static inline void fpu_restore(void* area) {
+    if (fpu_has_fxsr) {
+        asm volatile("fxrstor (%0)" : : "r"(area) : "memory");
+    } else {
+        asm volatile("frstor (%0)" : : "r"(area) : "memory");
+    }
+}
+
+// Deixa a FPU no estado inicial de um processo novo
+static inline void fpu_reset() {
+    asm volatile("fninit");
+    if (fpu_has_fxsr) {
+        u32 mxcsr = MXCSR_DEFAULT;
+        asm volatile("ldmxcsr %0" : : "m"(mxcsr));
+    }
+}
+
+// Tratador de #NM (vetor 7): primeira instrução de FPU com CR0.TS ligado
+static void fpu_trap(interrupt_frame_t* frame) {
+    (void)frame;
+    cpu_t* cpu = smp_this_cpu();
+    process_t* current = cpu->current;
+    
+    // Primeiro uso: a área só é criada para quem usa a FPU
+    // Vem antes de mexer em TS e no dono: a alocação pode pegar uma falha de
+    // página que zera o frame com SSE2, e fpu_kernel_end religa TS e tira o dono
+    u8 first_use = 0;
+    if (current && !current->fpu_state) {
+        void* state = kmem_cache_alloc(fpu_cache);
+        if (!state) {
+            vga_write("\nSem memoria para o estado da FPU\n");
+            cpu_halt();
+        }
+        current->fpu_state = state;
+        first_use = 1;
+    }
+    
+    cpu_clts();
+    cpu->fpu_ts = 0;
+    if (!current || cpu->fpu_owner == current) return;
+    
+    // Guarda o estado do dono anterior antes de sobrescrevê-lo
+    if (cpu->fpu_owner) {
+        fpu_save(cpu->fpu_owner->fpu_state);
+    }
+    
+    if (first_use) {
+        fpu_reset();
+    } else {
+        fpu_restore(current->fpu_state);
+    }
+    cpu->fpu_owner = current;
+}
+
+// Configura a FPU/SSE e o tratamento preguiçoso do seu estado
+void fpu_init() {
+    u32 eax, ebx, ecx, edx;
+    cpu_cpuid(1, &eax, &ebx, &ecx, &edx);
+    fpu_has_fxsr = (edx & CPUID_EDX_FXSR) ? 1 : 0;
+    fpu_has_sse = (edx & CPUID_EDX_SSE) ? 1 : 0;
+    
+    fpu_cache = kmem_cache_create("fpu_state", FPU_STATE_SIZE, 16, NULL);
+    interrupt_register_handler(INT_DEVICE_NOT_AVAILABLE, fpu_trap);
+    fpu_init_cpu();
+}
+
+// Configura a FPU/SSE da CPU atual (cada CPU tem os seus CR0 e CR4)
+void fpu_init_cpu() {
+    cpu_t* cpu = smp_this_cpu();
+    
+    // FPU presente (EM=0), fwait respeita TS (MP=1)
+    cpu_write_cr0((cpu_read_cr0() & ~CR0_EM) | CR0_MP);
+    if (fpu_has_fxsr) {
+        u32 cr4 = cpu_read_cr4() | CR4_OSFXSR;
+        if (fpu_has_sse) cr4 |= CR4_OSXMMEXCPT;
+        cpu_write_cr4(cr4);
+    }
+    fpu_reset();
+    
+    // Ninguém é dono da FPU ainda: o primeiro uso passa pelo #NM
+    cpu->fpu_owner = NULL;
+    cpu->fpu_kernel_depth = 0;
+    cpu_write_cr0(cpu_read_cr0() | CR0_TS);
+    cpu->fpu_ts = 1;
+}
+
+// Chamado antes de cada troca de contexto, com as interrupções desligadas
+// CR0 só é escrito quando TS precisa mudar
+void fpu_switch(process_t* next) {
+    cpu_t* cpu = smp_this_cpu();
+    if (next == cpu->fpu_owner) {
+        if (cpu->fpu_ts) {
+            cpu_clts();
+            cpu->fpu_ts = 0;
+        }
+    } else if (!cpu->fpu_ts) {
+        cpu_write_cr0(cpu_read_cr0() | CR0_TS);
+        cpu->fpu_ts = 1;
+    }
+}
+
+// Libera a área de estado de um processo que está terminando
+// O processo não está em execução, mas pode ser dono da FPU de qualquer CPU
+void fpu_release(process_t* process) {
+    for (u32 i = 0; i < smp_get_cpu_count(); i++) {
+        cpu_t* cpu = smp_get_cpu(i);
+        if (cpu->fpu_owner == process) {
+            cpu->fpu_owner = NULL;
+        }
+    }
+    if (process->fpu_state) {
+        kmem_cache_free(fpu_cache, process->fpu_state);
+        process->fpu_state = NULL;
+    }
+}
+
+// Empresta a FPU ao kernel sem trocar de processo
+// O dono perde a posse: o seu próximo uso recarrega o estado pelo #NM
+// Aninhada, a seção de fora está usando os registradores: eles são salvos
+// e TS continua desligado
+u32 fpu_kernel_begin() {
+    u32 flags = cpu_irq_save();
+    cpu_t* cpu = smp_this_cpu();
+    
+    if (cpu->fpu_kernel_depth) {
+        if (cpu->fpu_kernel_depth > FPU_KERNEL_NEST) {
+            vga_write("\nSecoes de FPU do kernel aninhadas demais\n");
+            cpu_halt();
+        }
+        fpu_save(fpu_kernel_saved[cpu->id][cpu->fpu_kernel_depth - 1]);
+        cpu->fpu_kernel_depth++;
+        return flags;
+    }
+    
+    // fxsave com CR0.TS ligado geraria #NM: limpa TS antes de salvar
+    if (cpu->fpu_ts) {
+        cpu_clts();
+        cpu->fpu_ts = 0;
+    }
+    if (cpu->fpu_owner) {
+        fpu_save(cpu->fpu_owner->fpu_state);
+        cpu->fpu_owner = NULL;
+    }
+    cpu->fpu_kernel_depth = 1;
+    return flags;
+}
+
+// Devolve a FPU: sem dono, o próximo uso passa pelo #NM
+// Aninhada, recarrega os registradores da seção de fora
+void fpu_kernel_end(u32 flags) {
+    cpu_t* cpu = smp_this_cpu();
+    if (--cpu->fpu_kernel_depth) {
+        fpu_restore(fpu_kernel_saved[cpu->id][cpu->fpu_kernel_depth - 1]);
+        cpu_irq_restore(flags);
+        return;
+    }
+    cpu_write_cr0(cpu_read_cr0() | CR0_TS);
+    cpu->fpu_ts = 1;
+    cpu_irq_restore(flags);
+}
@@ -0,0 +1,113 @@
+; interrupts.asm
+; Stubs de entrada das exceções (0-31), das IRQs remapeadas (32-47)
+; e dos vetores do APIC local (48-63)
+
+[BITS 32]
+extern interrupt_dispatch
+global isr_stub_table
+
+; Exceção sem código de erro: empilha um 0 para manter o mesmo formato
+%macro ISR_NOERR 1
+isr_stub_%1:
+    push dword 0
+    push dword %1
+    jmp interrupt_common
+%endmacro
+
+; Exceção em que a CPU já empilhou um código de erro
+%macro ISR_ERR 1
+isr_stub_%1:
+    push dword %1
+    jmp interrupt_common
+%endmacro
+
+; Caminho comum: salva os registradores e chama o despachante em C
+; com um ponteiro para o interrupt_frame_t montado na pilha
+interrupt_common:
+    pusha
+    cld
+    push esp           ; interrupt_frame_t*
+    call interrupt_dispatch
+    add esp, 4
+    popa
+    add esp, 8         ; Descarta vetor e código de erro
+    iret
+
+; Exceções
+ISR_NOERR 0
+ISR_NOERR 1
+ISR_NOERR 2
+ISR_NOERR 3
+ISR_NOERR 4
+ISR_NOERR 5
+ISR_NOERR 6
+ISR_NOERR 7
+ISR_ERR   8
+ISR_NOERR 9
+ISR_ERR   10
+ISR_ERR   11
+ISR_ERR   12
+ISR_ERR   13
+ISR_ERR   14
+ISR_NOERR 15
+ISR_NOERR 16
+ISR_ERR   17
+ISR_NOERR 18
+ISR_NOERR 19
+ISR_NOERR 20
+ISR_ERR   21
+ISR_NOERR 22
+ISR_NOERR 23
+ISR_NOERR 24
+ISR_NOERR 25
+ISR_NOERR 26
+ISR_NOERR 27
+ISR_NOERR 28
+ISR_ERR   29
+ISR_ERR   30
+ISR_NOERR 31
+
+; IRQs 0-15
+ISR_NOERR 32
+ISR_NOERR 33
+ISR_NOERR 34
+ISR_NOERR 35
+ISR_NOERR 36
+ISR_NOERR 37
+ISR_NOERR 38
+ISR_NOERR 39
+ISR_NOERR 40
+ISR_NOERR 41
+ISR_NOERR 42
+ISR_NOERR 43
+ISR_NOERR 44
+ISR_NOERR 45
+ISR_NOERR 46
+ISR_NOERR 47
+
+; Vetores do APIC local
+ISR_NOERR 48
+ISR_NOERR 49
+ISR_NOERR 50
+ISR_NOERR 51
+ISR_NOERR 52
+ISR_NOERR 53
+ISR_NOERR 54
+ISR_NOERR 55
+ISR_NOERR 56
+ISR_NOERR 57
+ISR_NOERR 58
+ISR_NOERR 59
+ISR_NOERR 60
+ISR_NOERR 61
+ISR_NOERR 62
+ISR_NOERR 63
+
+; Tabela de endereços dos stubs, usada por idt_init
+section .data
+isr_stub_table:
+%assign i 0
+%rep 64
+    dd isr_stub_%+i
+%assign i i+1
+%endrep
@@ -0,0 +1,283 @@
+#include "../include/smp.h"
+#include "../include/apic.h"
+#include "../include/gdt.h"
+#include "../include/interrupts.h"
+#include "../include/memory.h"
+#include "../include/timer.h"
+#include "../include/fpu.h"
+#include "../include/vga.h"
+
+// Tabela MP (Intel MultiProcessor Specification 1.4)
+// Estrutura de ponteiro flutuante, encontrada por varredura da memória baixa
+typedef struct {
+    char signature[4];            // "_MP_"
+    u32 config_table;             // Endereço físico da tabela de configuração
+    u8 length;                    // Tamanho em blocos de 16 bytes
+    u8 revision;
+    u8 checksum;                  // Soma de todos os bytes = 0
+    u8 features[5];
+} __attribute__((packed)) mp_floating_t;
+
+// Cabeçalho da tabela de configuração, seguido por entry_count entradas
+typedef struct {
+    char signature[4];            // "PCMP"
+    u16 length;                   // Tamanho da parte básica, com o cabeçalho
+    u8 revision;
+    u8 checksum;
+    char oem_id[8];
+    char product_id[12];
+    u32 oem_table;
+    u16 oem_table_size;
+    u16 entry_count;
+    u32 lapic_base;               // Endereço dos registradores do APIC local
+    u16 extended_length;
+    u8 extended_checksum;
+    u8 reserved;
+} __attribute__((packed)) mp_config_t;
+
+// Entrada de processador
+typedef struct {
+    u8 type;                      // MP_ENTRY_PROCESSOR
+    u8 lapic_id;
+    u8 lapic_version;
+    u8 flags;                     // MP_CPU_ENABLED, MP_CPU_BSP
+    u32 signature;
+    u32 features;
+    u32 reserved[2];
+} __attribute__((packed)) mp_processor_t;
+
+#define MP_ENTRY_PROCESSOR 0
+#define MP_PROCESSOR_ENTRY_SIZE 20    // As demais entradas têm 8 bytes
+#define MP_OTHER_ENTRY_SIZE 8
+#define MP_CPU_ENABLED 0x1
+#define MP_CPU_BSP 0x2
+
+// As tabelas precisam estar na região mapeada 1:1
+#define MP_TABLE_LIMIT 0x01000000
+
+// Tempo máximo de espera pela partida de uma AP
+#define SMP_AP_TIMEOUT_MS 100
+
+// Código de partida das APs (kernel/arch/ap_boot.asm)
+extern u8 ap_trampoline_start[];
+extern u8 ap_trampoline_end[];
+extern u32 ap_boot_cr3;
+extern u32 ap_boot_cr4;
+extern u32 ap_boot_stack;
+extern u32 ap_boot_cpu;
+extern u32 ap_boot_entry;
+
+// Variável do trampolim na cópia em SMP_TRAMPOLINE
+#define TRAMPOLINE_VAR(var) \
+    (*(volatile u32*)(SMP_TRAMPOLINE + ((u32)&(var) - (u32)ap_trampoline_start)))
+
+// Fim da imagem do kernel (definido em link.ld)
+extern u8 _kernel_end;
+
+// Dados por CPU
+static cpu_t cpus[SMP_MAX_CPUS];
+static volatile u32 cpu_count = 1;
+
+// Soma dos bytes de uma estrutura da tabela MP (0 se válida)
+static u8 mp_checksum(const u8* data, u32 length) {
+    u8 sum = 0;
+    for (u32 i = 0; i < length; i++) {
+        sum += data[i];
+    }
+    return sum;
+}
+
+// Procura a estrutura de ponteiro flutuante em [start, start + length)
+static mp_floating_t* mp_scan(u32 start, u32 length) {
+    for (u32 addr = start; addr + sizeof(mp_floating_t) <= start + length; addr += 16) {
+        mp_floating_t* mp = (mp_floating_t*)addr;
+        if (mp->signature[0] == '_' && mp->signature[1] == 'M' &&
+            mp->signature[2] == 'P' && mp->signature[3] == '_' &&
+            mp->length && !mp_checksum((const u8*)mp, mp->length * 16)) {
+            return mp;
+        }
+    }
+    return NULL;
+}
+
+// Lê uma palavra da área de dados da BIOS (0x400)
+// O endereço passa pelo asm para o compilador não tratá-lo como ponteiro nulo
+static u16 bios_data_read(u32 offset) {
+    volatile u16* address;
+    asm("" : "=r"(address) : "0"(0x400 + offset));
+    return *address;
+}
+
+// Locais definidos pela especificação: primeiro KB da EBDA, último KB da
+// memória base e a ROM da BIOS
+static mp_floating_t* mp_find() {
+    mp_floating_t* mp = NULL;
+    u32 ebda = (u32)bios_data_read(0x0E) << 4;
+    u32 base_end = (u32)bios_data_read(0x13) * 1024;
+    
+    if (ebda) mp = mp_scan(ebda, 1024);
+    if (!mp && base_end >= 1024) mp = mp_scan(base_end - 1024, 1024);
+    if (!mp) mp = mp_scan(0xF0000, 0x10000);
+    return mp;
+}
+
+// Aponta o descritor de dados da CPU para o seu cpu_t e o carrega em %gs
+static void smp_load_cpu_segment(cpu_t* cpu) {
+    gdt_set_gate(GDT_CPU_FIRST + cpu->id, (u32)cpu, sizeof(cpu_t) - 1, 0x92, 0x40);
+    u16 selector = GDT_CPU_SELECTOR(cpu->id);
+    asm volatile("mov %0, %%gs" : : "r"(selector) : "memory");
+}
+
+// Prepara o cpu_t de índice id
+static cpu_t* smp_setup_cpu(u32 id, u32 apic_id) {
+    cpu_t* cpu = &cpus[id];
+    cpu->self = cpu;
+    cpu->id = id;
+    cpu->apic_id = apic_id;
+    cpu->online = 0;
+    spin_init(&cpu->rq_lock);
+    return cpu;
+}
+
+// IPI de reescalonamento: acorda a CPU do hlt (o laço do idle chama
+// scheduler_schedule em seguida), tira da CPU um processo que outra CPU
+// terminou e preempta o processo atual quando chega um processo EDF
+static void smp_reschedule_irq(interrupt_frame_t* frame) {
+    (void)frame;
+    if (scheduler_need_resched()) {
+        scheduler_schedule();
+    }
+}
+
+// Para uma AP ociosa até a próxima interrupção
+// Sem processos, o timer do APIC (que só conta o quantum) fica parado;
+// quem põe um processo na fila desta CPU a acorda com smp_send_reschedule
+static void smp_idle() {
+    u32 flags = cpu_irq_save();
+    if (!scheduler_ready_count()) {
+        lapic_timer_stop();
+        asm volatile("sti; hlt; cli");
+        lapic_timer_start(TIMER_HZ);
+    }
+    cpu_irq_restore(flags);
+}
+
+// Primeira função em C de uma AP, chamada pelo trampolim com a paginação
+// ligada e na pilha do processo idle desta CPU
+static void smp_ap_main(cpu_t* cpu) {
+    gdt_load();
+    smp_load_cpu_segment(cpu);
+    idt_reload();
+    fpu_init_cpu();
+    lapic_init_cpu();
+    
+    cpu->online = 1;
+    lapic_timer_start(TIMER_HZ);
+    asm volatile("sti");
+    
+    // Laço do processo idle desta CPU
+    while (1) {
+        scheduler_schedule();
+        smp_idle();
+    }
+}
+
+// Acorda uma AP e espera que ela entre no escalonador
+static u32 smp_start_ap(cpu_t* cpu) {
+    process_t* idle = scheduler_init_cpu(cpu);
+    if (!idle) return 0;
+    
+    TRAMPOLINE_VAR(ap_boot_stack) = (u32)idle->kernel_stack + KERNEL_STACK_SIZE;
+    TRAMPOLINE_VAR(ap_boot_cpu) = (u32)cpu;
+    lapic_start_ap(cpu->apic_id, SMP_TRAMPOLINE);
+    
+    u64 deadline = timer_get_ticks() + timer_ms_to_ticks(SMP_AP_TIMEOUT_MS);
+    while (!cpu->online && timer_get_ticks() < deadline) {
+        cpu_pause();
+    }
+    return cpu->online;
+}
+
+// Prepara os dados da BSP e carrega o seu %gs
+void smp_init_bsp() {
+    cpu_t* cpu = smp_setup_cpu(0, 0);
+    smp_load_cpu_segment(cpu);
+    cpu->online = 1;
+}
+
+// Procura as outras CPUs na tabela MP e as coloca no escalonador
+void smp_init() {
+    mp_floating_t* mp = mp_find();
+    if (!mp || !mp->config_table || mp->config_table >= MP_TABLE_LIMIT) {
+        return; // Sem tabela (ou configuração padrão sem tabela): uma CPU
+    }
+    
+    mp_config_t* config = (mp_config_t*)mp->config_table;
+    if (config->signature[0] != 'P' || config->signature[1] != 'C' ||
+        config->signature[2] != 'M' || config->signature[3] != 'P' ||
+        mp_checksum((const u8*)config, config->length)) {
+        return;
+    }
+    
+    // O trampolim não pode sobrescrever a imagem do kernel
+    if ((u32)&_kernel_end > SMP_TRAMPOLINE) {
+        vga_write("SMP: o kernel ocupa o endereco do trampolim\n");
+        return;
+    }
+    
+    lapic_init(config->lapic_base ? config->lapic_base : LAPIC_DEFAULT_BASE);
+    cpus[0].apic_id = lapic_get_id();
+    lapic_timer_calibrate();
+    interrupt_register_handler(INT_APIC_RESCHEDULE, smp_reschedule_irq);
+    
+    // Copia o trampolim e preenche o que é comum a todas as APs
+    u8* trampoline = (u8*)SMP_TRAMPOLINE;
+    for (u32 i = 0; i < (u32)(ap_trampoline_end - ap_trampoline_start); i++) {
+        trampoline[i] = ap_trampoline_start[i];
+    }
+    TRAMPOLINE_VAR(ap_boot_cr3) = (u32)vmm_get_kernel_directory();
+    TRAMPOLINE_VAR(ap_boot_cr4) = cpu_read_cr4();
+    TRAMPOLINE_VAR(ap_boot_entry) = (u32)smp_ap_main;
+    
+    // Uma AP por vez: todas usam as mesmas variáveis do trampolim
+    u8* entry = (u8*)(config + 1);
+    for (u32 i = 0; i < config->entry_count; i++) {
+        if (*entry != MP_ENTRY_PROCESSOR) {
+            entry += MP_OTHER_ENTRY_SIZE;
+            continue;
+        }
+        
+        mp_processor_t* processor = (mp_processor_t*)entry;
+        entry += MP_PROCESSOR_ENTRY_SIZE;
+        if (!(processor->flags & MP_CPU_ENABLED) || (processor->flags & MP_CPU_BSP)) continue;
+        if (cpu_count >= SMP_MAX_CPUS) break;
+        
+        cpu_t* cpu = smp_setup_cpu(cpu_count, processor->lapic_id);
+        if (!smp_start_ap(cpu)) {
+            // Uma AP atrasada ainda poderia usar o trampolim: não tenta outras
+            vga_write("SMP: a CPU com APIC ");
+            vga_write_dec(cpu->apic_id);
+            vga_write(" nao respondeu\n");
+            break;
+        }
+        
+        // A partir daqui as outras CPUs podem roubar processos desta e vice-versa
+        cpu_count++;
+    }
+}
+
+// Dados da CPU de índice id
+cpu_t* smp_get_cpu(u32 id) {
+    return &cpus[id];
+}
+
+// Número de CPUs em funcionamento
+u32 smp_get_cpu_count() {
+    return cpu_count;
+}
+
+// Acorda uma CPU parada em hlt
+void smp_send_reschedule(cpu_t* cpu) {
+    if (!cpu->online || cpu == smp_this_cpu()) return;
+    lapic_send_ipi(cpu->apic_id, INT_APIC_RESCHEDULE);
+}
@@ -0,0 +1,177 @@
+#include "../include/bench.h"
+#include "../include/ata.h"
+#include "../include/memory.h"
+#include "../include/cpu.h"
+#include "../include/timer.h"
+#include "../include/vga.h"
+
+// Região de rascunho do disco (make run usa disk.img, criado zerado)
+#define BLOCK_BENCH_LBA 2048
+#define BLOCK_BENCH_REQUESTS 256
+#define BLOCK_BENCH_SECTORS 8         // 4KB por pedido: 1MB no total
+#define BLOCK_BENCH_BYTES (BLOCK_BENCH_REQUESTS * BLOCK_BENCH_SECTORS * BLOCK_SECTOR_SIZE)
+
+static block_device_t* bench_device;
+static block_request_t* bench_requests;
+static u32 bench_order[BLOCK_BENCH_REQUESTS];
+static u8* bench_data;
+static u8* bench_check;
+static volatile u32 bench_completed;
+static volatile u32 bench_done;
+
+// Resultados de uma rodada (PIO ou DMA)
+typedef struct {
+    u32 single_commands;          // Comandos com um pedido por vez
+    u32 single_cycles_kb;         // Ciclos por KB com um pedido por vez
+    u32 batch_commands;           // Comandos com os pedidos em lote
+    u32 batch_merges;             // Pedidos fundidos no lote
+    u32 batch_cycles_kb;          // Ciclos por KB em lote
+    u32 verified;                 // Leitura em lote igual ao que foi escrito
+} block_bench_result_t;
+
+static block_bench_result_t bench_results[2];
+static u32 bench_rounds;
+
+static void block_bench_complete(block_request_t* request) {
+    (void)request;
+    cpu_xadd(&bench_completed, 1);
+}
+
+// Ordem embaralhada fixa (gerador congruencial): o elevador precisa ordenar
+static void block_bench_shuffle() {
+    u32 seed = 0x5EED1234;
+    for (u32 i = 0; i < BLOCK_BENCH_REQUESTS; i++) {
+        bench_order[i] = i;
+    }
+    for (u32 i = BLOCK_BENCH_REQUESTS - 1; i > 0; i--) {
+        seed = seed * 1103515245 + 12345;
+        u32 j = (seed >> 16) % (i + 1);
+        u32 swap = bench_order[i];
+        bench_order[i] = bench_order[j];
+        bench_order[j] = swap;
+    }
+}
+
+static void block_bench_prepare(u32 index, u8* buffer, u8 write) {
+    block_request_t* request = &bench_requests[index];
+    u32 offset = index * BLOCK_BENCH_SECTORS;
+    block_request_init(request, BLOCK_BENCH_LBA + offset, BLOCK_BENCH_SECTORS,
+                       buffer + offset * BLOCK_SECTOR_SIZE, write);
+    request->complete = block_bench_complete;
+}
+
+// Todos os pedidos na ordem embaralhada; em lote, com a fila segurada até o fim
+// Retorna os ciclos até o último terminar
+static u64 block_bench_run(u8* buffer, u8 write, u32 batch) {
+    bench_completed = 0;
+    u64 start = cpu_rdtsc();
+    if (batch) block_plug(bench_device);
+    for (u32 i = 0; i < BLOCK_BENCH_REQUESTS; i++) {
+        u32 index = bench_order[i];
+        block_bench_prepare(index, buffer, write);
+        block_submit(bench_device, &bench_requests[index]);
+        if (!batch) block_wait(bench_device, &bench_requests[index]);
+    }
+    if (batch) block_unplug(bench_device);
+    wait_event(&bench_device->wait, bench_completed == BLOCK_BENCH_REQUESTS);
+    return cpu_rdtsc() - start;
+}
+
+static void block_bench_round(block_bench_result_t* result, u8 pattern) {
+    for (u32 i = 0; i < BLOCK_BENCH_BYTES; i++) {
+        bench_data[i] = (u8)(i * 7 + pattern + i / BLOCK_SECTOR_SIZE);
+    }
+    
+    u32 dispatches = bench_device->dispatches;
+    u64 cycles = block_bench_run(bench_data, 1, 0);
+    result->single_commands = bench_device->dispatches - dispatches;
+    result->single_cycles_kb = (u32)(cycles / (BLOCK_BENCH_BYTES / 1024));
+    
+    // Segunda escrita com outro padrão, em lote: a leitura confere esta
+    for (u32 i = 0; i < BLOCK_BENCH_BYTES; i++) {
+        bench_data[i] ^= 0xFF;
+    }
+    dispatches = bench_device->dispatches;
+    u32 merges = bench_device->merges;
+    cycles = block_bench_run(bench_data, 1, 1);
+    result->batch_commands = bench_device->dispatches - dispatches;
+    result->batch_merges = bench_device->merges - merges;
+    result->batch_cycles_kb = (u32)(cycles / (BLOCK_BENCH_BYTES / 1024));
+    
+    for (u32 i = 0; i < BLOCK_BENCH_BYTES; i++) {
+        bench_check[i] = 0;
+    }
+    block_bench_run(bench_check, 0, 1);
+    result->verified = 1;
+    for (u32 i = 0; i < BLOCK_BENCH_BYTES; i++) {
+        if (bench_check[i] != bench_data[i]) {
+            result->verified = 0;
+            break;
+        }
+    }
+    for (u32 i = 0; i < BLOCK_BENCH_REQUESTS; i++) {
+        if (bench_requests[i].status != BLOCK_OK) result->verified = 0;
+    }
+}
+
+// Thread do benchmark: wait_event não pode ser usada pelo processo idle
+static void block_bench_thread(void* arg) {
+    (void)arg;
+    u32 dma = ata_get_dma(bench_device);
+    block_bench_shuffle();
+    
+    ata_set_dma(bench_device, 0);
+    block_bench_round(&bench_results[0], 0x11);
+    bench_rounds = 1;
+    if (ata_set_dma(bench_device, 1)) {
+        block_bench_round(&bench_results[1], 0x22);
+        bench_rounds = 2;
+    }
+    ata_set_dma(bench_device, dma);
+    bench_done = 1;
+}
+
+void bench_block() {
+    bench_device = block_find("hda");
+    if (!bench_device) {
+        vga_write("Disco: nenhum disco IDE em hda (make run usa disk.img)\n");
+        return;
+    }
+    
+    bench_requests = (block_request_t*)kmalloc(BLOCK_BENCH_REQUESTS * sizeof(block_request_t));
+    bench_data = (u8*)kmalloc(BLOCK_BENCH_BYTES);
+    bench_check = (u8*)kmalloc(BLOCK_BENCH_BYTES);
+    bench_done = 0;
+    if (bench_requests && bench_data && bench_check &&
+        kthread_create_named("block_bench", block_bench_thread, NULL)) {
+        // kernel_main é o idle desta CPU: não pode bloquear, só ceder a vez
+        while (!bench_done) {
+            scheduler_schedule();
+            timer_idle();
+        }
+    }
+    
+    if (bench_done) {
+        vga_write("Disco hda: 1MB em 256 pedidos de 4KB fora de ordem\n");
+        for (u32 i = 0; i < bench_rounds; i++) {
+            block_bench_result_t* result = &bench_results[i];
+            vga_write(i ? "  DMA: " : "  PIO: ");
+            vga_write("um por vez ");
+            vga_write_dec(result->single_commands);
+            vga_write(" comandos, ");
+            vga_write_dec(result->single_cycles_kb);
+            vga_write(" ciclos/KB; em lote ");
+            vga_write_dec(result->batch_commands);
+            vga_write(" comandos (");
+            vga_write_dec(result->batch_merges);
+            vga_write(" fusoes), ");
+            vga_write_dec(result->batch_cycles_kb);
+            vga_write(" ciclos/KB");
+            vga_write(result->verified ? "\n" : " FALHOU\n");
+        }
+    }
+    
+    if (bench_requests) kfree(bench_requests);
+    if (bench_data) kfree(bench_data);
+    if (bench_check) kfree(bench_check);
+}
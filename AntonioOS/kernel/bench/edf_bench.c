@@ -0,0 +1,143 @@
+#include "../include/bench.h"
+#include "../include/process.h"
+#include "../include/smp.h"
+#include "../include/cpu.h"
+#include "../include/timer.h"
+#include "../include/vga.h"
+
+#define EDF_BENCH_MS 2000             // Duração de cada nível de utilização
+#define EDF_BENCH_MAX_TASKS 8
+
+// Conjuntos de tarefas com utilização conhecida (runtime, deadline, period em ms)
+// As tarefas vão para a primeira CPU que as comporta, então cada conjunto
+// cabe inteiro na BSP
+typedef struct {
+    const char* name;
+    u32 count;
+    edf_params_t tasks[EDF_BENCH_MAX_TASKS];
+} edf_bench_set_t;
+
+static const edf_bench_set_t edf_sets[] = {
+    { "50%", 2, { { 5, 20, 20 }, { 10, 40, 40 } } },
+    { "75%", 3, { { 5, 20, 20 }, { 10, 40, 40 }, { 25, 100, 100 } } },
+    { "95%", 4, { { 5, 20, 20 }, { 10, 40, 40 }, { 25, 100, 100 }, { 20, 100, 100 } } },
+    { "55% (prazos menores que o periodo, densidade 85%)", 3,
+      { { 2, 10, 20 }, { 10, 40, 40 }, { 20, 50, 100 } } },
+};
+
+static volatile u64 edf_end;          // Tick em que as tarefas param
+static volatile u32 edf_finished;
+static volatile u32 edf_jobs, edf_misses, edf_overruns;
+
+// Cada execução consome o orçamento do período menos um tick, a margem
+// para a contagem do orçamento, que é feita em ticks inteiros
+static void edf_task(void* arg) {
+    (void)arg;
+    process_t* self = process_get_current();
+    u32 jobs = 0;
+    while (timer_get_ticks() < edf_end) {
+        while (self->edf_budget > 1) {
+            cpu_pause();
+        }
+        jobs++;
+        process_wait_next_period();
+    }
+    
+    cpu_xadd(&edf_jobs, jobs);
+    cpu_xadd(&edf_misses, self->edf_misses);
+    cpu_xadd(&edf_overruns, self->edf_overruns);
+    cpu_xadd(&edf_finished, 1);
+}
+
+// Processo Round Robin que quer a CPU o tempo todo
+static void edf_hog(void* arg) {
+    (void)arg;
+    while (timer_get_ticks() < edf_end) {
+        cpu_pause();
+    }
+    cpu_xadd(&edf_finished, 1);
+}
+
+// kernel_main é o idle desta CPU: não pode bloquear, só ceder a vez
+// (e só volta a rodar quando as tarefas e os processos Round Robin pararem)
+static void edf_wait(u32 finished) {
+    while (edf_finished < finished) {
+        scheduler_schedule();
+        timer_idle();
+    }
+}
+
+// Roda um conjunto contra um processo Round Robin em cada CPU
+static void edf_run_set(const edf_bench_set_t* set) {
+    edf_end = timer_get_ticks() + timer_ms_to_ticks(EDF_BENCH_MS);
+    edf_finished = edf_jobs = edf_misses = edf_overruns = 0;
+    
+    u32 started = 0;
+    for (u32 i = 0; i < smp_get_cpu_count(); i++) {
+        if (kthread_create_named("edf_hog", edf_hog, NULL)) started++;
+    }
+    u32 admitted = 0;
+    for (u32 i = 0; i < set->count; i++) {
+        if (kthread_create_edf("edf_task", edf_task, NULL, &set->tasks[i])) admitted++;
+    }
+    started += admitted;
+    
+    edf_wait(started);
+    
+    vga_write("  U=");
+    vga_write(set->name);
+    vga_write(": ");
+    vga_write_dec(admitted);
+    vga_write("/");
+    vga_write_dec(set->count);
+    vga_write(" admitidas, ");
+    vga_write_dec(edf_jobs);
+    vga_write(" execucoes, ");
+    vga_write_dec(edf_misses);
+    vga_write(" prazos perdidos, ");
+    vga_write_dec(edf_overruns);
+    vga_write(" orcamentos estourados");
+    vga_write(edf_misses || edf_overruns || admitted != set->count ? " FALHOU\n" : "\n");
+}
+
+// Tarefa que reserva a utilização sem usá-la, até edf_admitting zerar
+// (terminar devolveria a utilização antes da recusa)
+static volatile u32 edf_admitting;
+
+static void edf_reserve(void* arg) {
+    (void)arg;
+    while (edf_admitting) {
+        process_wait_next_period();
+    }
+    cpu_xadd(&edf_finished, 1);
+}
+
+// Controle de admissão: tarefas de 50% até a primeira recusa
+// Cabem exatamente duas por CPU
+static void edf_admission() {
+    static const edf_params_t half = { 50, 100, 100 };
+    edf_admitting = 1;
+    edf_finished = 0;
+    
+    u32 admitted = 0;
+    while (admitted <= 2 * SMP_MAX_CPUS && kthread_create_edf("edf_reserve", edf_reserve, NULL, &half)) {
+        admitted++;
+    }
+    edf_admitting = 0;
+    edf_wait(admitted);
+    
+    u32 expected = 2 * smp_get_cpu_count();
+    vga_write("  admissao: ");
+    vga_write_dec(admitted);
+    vga_write(" tarefas de 50% admitidas (esperado ");
+    vga_write_dec(expected);
+    vga_write(admitted != expected ? ") FALHOU\n" : ")\n");
+}
+
+void bench_edf() {
+    vga_write("EDF (tarefas de tempo real contra processos Round Robin):\n");
+    for (u32 i = 0; i < sizeof(edf_sets) / sizeof(edf_sets[0]); i++) {
+        edf_run_set(&edf_sets[i]);
+    }
+    edf_admission();
+}
@@ -0,0 +1,222 @@
+#include "../include/bench.h"
+#include "../include/kstring.h"
+#include "../include/memory.h"
+#include "../include/cpu.h"
+#include "../include/process.h"
+#include "../include/timer.h"
+#include "../include/vga.h"
+
+#define STRING_BENCH_MAX 0x100000      // Maior tamanho medido (1MB)
+#define STRING_BENCH_BYTES 0x400000    // Bytes movidos por medida (4MB)
+#define STRING_BENCH_MIN_ROUNDS 4
+#define STRING_BENCH_FAULT 0x40000     // Buffers novos do teste com falhas de página (256KB)
+#define STRING_BENCH_PAGE 4096
+#define STRING_BENCH_FPU_THREADS 16    // Threads do teste do #NM: mais de uma placa do cache de estados
+#define STRING_FPU_CONTROL_RESET 0x037F // Palavra de controle da x87 depois de fninit
+
+static const char* string_mode_names[] = { "bytes", "rep", "sse2" };
+
+// Escreve bytes / cycles com duas casas decimais
+static void string_write_rate(u32 bytes, u64 cycles) {
+    if (!cycles) cycles = 1;
+    u32 hundredths = (u32)(((u64)bytes * 100) / cycles);
+    vga_write_dec(hundredths / 100);
+    vga_putchar('.');
+    vga_putchar('0' + hundredths / 10 % 10);
+    vga_putchar('0' + hundredths % 10);
+}
+
+// Bytes por ciclo de kmemcpy (fill = 0) ou kmemset (fill = 1) com size bytes
+static void string_measure(u8* destination, u8* source, u32 size, u32 fill) {
+    u32 rounds = STRING_BENCH_BYTES / size;
+    if (rounds < STRING_BENCH_MIN_ROUNDS) rounds = STRING_BENCH_MIN_ROUNDS;
+    
+    // Aquecimento: cache e TLB no estado da medida
+    if (fill) kmemset(destination, 0x5A, size);
+    else kmemcpy(destination, source, size);
+    
+    u64 start = cpu_rdtsc();
+    for (u32 i = 0; i < rounds; i++) {
+        if (fill) kmemset(destination, (u8)i, size);
+        else kmemcpy(destination, source, size);
+    }
+    u64 end = cpu_rdtsc();
+    string_write_rate(size * rounds, end - start);
+}
+
+// Confere cópias, preenchimentos e sobreposições com cabeça e cauda desalinhadas
+static u32 string_verify(u8* destination, u8* source) {
+    static const u32 sizes[] = { 7, 61, 4099, 70001 };
+    for (u32 n = 0; n < sizeof(sizes) / sizeof(sizes[0]); n++) {
+        u32 size = sizes[n];
+        u8* d = destination + 3;
+        u8* s = source + 1;
+        
+        kmemcpy(d, s, size);
+        for (u32 i = 0; i < size; i++) {
+            if (d[i] != s[i]) return 0;
+        }
+        
+        kmemset(d, 0xA5, size);
+        for (u32 i = 0; i < size; i++) {
+            if (d[i] != 0xA5) return 0;
+        }
+        
+        // Destino sobre o fim da origem: só a cópia de trás para frente acerta
+        kmemcpy(d, s, size);
+        kmemmove(d + 5, d, size);
+        for (u32 i = 0; i < size; i++) {
+            if (d[i + 5] != s[i]) return 0;
+        }
+    }
+    return 1;
+}
+
+// Esvazia a reserva de frames zerados, guardando os frames em frames
+// A reserva guarda no máximo PMM_ZERO_POOL_SIZE frames: tantos pedidos a esvaziam
+static void string_drain_zero_pool(void** frames) {
+    for (u32 i = 0; i < PMM_ZERO_POOL_SIZE; i++) {
+        frames[i] = pmm_alloc_zeroed_frame();
+    }
+}
+
+// Devolve os frames tirados por string_drain_zero_pool
+static void string_release_frames(void** frames) {
+    for (u32 i = 0; i < PMM_ZERO_POOL_SIZE; i++) {
+        if (frames[i]) pmm_free_frame(frames[i]);
+    }
+}
+
+// Páginas do buffer ainda sem frame (o heap é mapeado sob demanda)
+static u32 string_count_unmapped(u8* buffer, u32 size) {
+    u32 unmapped = 0;
+    for (u32 offset = 0; offset < size; offset += STRING_BENCH_PAGE) {
+        if (!vmm_get_physical(buffer + offset)) unmapped++;
+    }
+    return unmapped;
+}
+
+// Cópia e preenchimento em buffers nunca tocados, com a reserva de frames
+// zerados vazia: cada falha de página zera o frame com kmemset no meio da
+// cópia SSE2, que precisa continuar com os próprios registradores
+// Retorna as páginas que faltaram (pages) e se o conteúdo conferiu
+static u32 string_verify_faults(u8* source, u32* pages) {
+    void* frames[PMM_ZERO_POOL_SIZE];
+    string_drain_zero_pool(frames);
+    
+    u8* copy = (u8*)kmalloc(STRING_BENCH_FAULT);
+    u8* fill = (u8*)kmalloc(STRING_BENCH_FAULT);
+    u32 ok = copy && fill;
+    *pages = 0;
+    if (ok) {
+        *pages = string_count_unmapped(copy, STRING_BENCH_FAULT) +
+                 string_count_unmapped(fill, STRING_BENCH_FAULT);
+        kmemcpy(copy, source, STRING_BENCH_FAULT);
+        kmemset(fill, 0x3C, STRING_BENCH_FAULT);
+        for (u32 i = 0; i < STRING_BENCH_FAULT; i++) {
+            if (copy[i] != source[i] || fill[i] != 0x3C) {
+                ok = 0;
+                break;
+            }
+        }
+    }
+    
+    if (copy) kfree(copy);
+    if (fill) kfree(fill);
+    string_release_frames(frames);
+    return ok;
+}
+
+static volatile u32 string_fpu_finished;
+static volatile u32 string_fpu_good;
+
+// Primeiro uso da FPU por um processo novo: o #NM cria a área de estado
+// (podendo zerar um frame com SSE2) e a FPU precisa chegar no estado inicial
+static void string_fpu_thread(void* arg) {
+    (void)arg;
+    u16 control;
+    u32 two;
+    asm volatile("fnstcw %0" : "=m"(control));
+    asm volatile("fld1; fld1; faddp; fistpl %0" : "=m"(two));
+    if (control == STRING_FPU_CONTROL_RESET && two == 2) cpu_xadd(&string_fpu_good, 1);
+    cpu_xadd(&string_fpu_finished, 1);
+}
+
+// Processos novos tomam o #NM com a reserva de frames zerados vazia
+static u32 string_verify_fpu_trap() {
+    void* frames[PMM_ZERO_POOL_SIZE];
+    string_drain_zero_pool(frames);
+    
+    string_fpu_finished = 0;
+    string_fpu_good = 0;
+    u32 started = 0;
+    for (u32 i = 0; i < STRING_BENCH_FPU_THREADS; i++) {
+        if (kthread_create_named("fpu_check", string_fpu_thread, NULL)) started++;
+    }
+    // kernel_main é o idle desta CPU: não pode bloquear, só ceder a vez
+    while (string_fpu_finished < started) {
+        scheduler_schedule();
+        timer_idle();
+    }
+    
+    string_release_frames(frames);
+    return started && string_fpu_good == started;
+}
+
+void bench_string() {
+    u8* source = (u8*)kmalloc(STRING_BENCH_MAX + 64);
+    u8* destination = (u8*)kmalloc(STRING_BENCH_MAX + 64);
+    if (!source || !destination) {
+        if (source) kfree(source);
+        if (destination) kfree(destination);
+        return;
+    }
+    for (u32 i = 0; i < STRING_BENCH_MAX + 64; i++) {
+        source[i] = (u8)(i * 31 + 7);
+    }
+    
+    string_mode_t boot_mode = string_get_mode();
+    vga_write("kmemcpy / kmemset (bytes por ciclo), em uso: ");
+    vga_write(string_mode_names[boot_mode]);
+    vga_write("\n  tamanho   copia bytes/rep/sse2    preenche bytes/rep/sse2\n");
+    
+    for (u32 size = 16; size <= STRING_BENCH_MAX; size *= 4) {
+        vga_write("  ");
+        vga_write_dec(size);
+        vga_write(" B:");
+        for (u32 fill = 0; fill < 2; fill++) {
+            vga_write(fill ? "  |" : "");
+            for (u32 mode = STRING_BYTES; mode <= STRING_SSE2; mode++) {
+                vga_putchar(' ');
+                if (string_select((string_mode_t)mode)) {
+                    string_measure(destination, source, size, fill);
+                } else {
+                    vga_write("-");
+                }
+            }
+        }
+        vga_putchar('\n');
+    }
+    
+    vga_write("  conferencia:");
+    for (u32 mode = STRING_BYTES; mode <= STRING_SSE2; mode++) {
+        if (!string_select((string_mode_t)mode)) continue;
+        vga_putchar(' ');
+        vga_write(string_mode_names[mode]);
+        vga_write(string_verify(destination, source) ? " ok" : " FALHOU");
+    }
+    vga_putchar('\n');
+    
+    // Com o modo em uso no boot: é ele que as falhas de página vão aninhar
+    string_select(boot_mode);
+    u32 pages;
+    vga_write("  com falhas de pagina: ");
+    vga_write(string_verify_faults(source, &pages) ? "ok (" : "FALHOU (");
+    vga_write_dec(pages);
+    vga_write(" paginas novas)\n");
+    vga_write("  primeiro uso da FPU com a reserva vazia: ");
+    vga_write(string_verify_fpu_trap() ? "ok\n" : "FALHOU\n");
+    
+    kfree(source);
+    kfree(destination);
+}
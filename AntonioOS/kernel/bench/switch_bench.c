@@ -0,0 +1,110 @@
+#include "../include/bench.h"
+#include "../include/process.h"
+#include "../include/fpu.h"
+#include "../include/cpu.h"
+#include "../include/vga.h"
+
+#define SWITCH_BENCH_ROUNDS 100000
+#define SWITCH_BENCH_STACK 4096
+
+// Estado salvo pela rotina antiga (kernel/bench/switch_legacy.asm)
+typedef struct {
+    u32 ebx, ecx, edx, esi, edi, ebp;
+    u32 esp, eip, eflags;
+    u32 cs, ds, es, fs, gs, ss;
+} legacy_state_t;
+
+extern void context_switch_legacy(legacy_state_t* old_state, legacy_state_t* new_state);
+
+// O benchmark alterna entre kernel_main e um parceiro com pilha própria,
+// sem passar pelo escalonador: mede só a rotina de troca
+static u8 partner_stack[SWITCH_BENCH_STACK] __attribute__((aligned(16)));
+static u32 main_esp, partner_esp;
+static legacy_state_t main_state, partner_state;
+static u8 fpu_area[FPU_STATE_SIZE] __attribute__((aligned(16)));
+
+static void partner_current() {
+    while (1) {
+        context_switch(&partner_esp, main_esp);
+    }
+}
+
+static void partner_legacy() {
+    while (1) {
+        context_switch_legacy(&partner_state, &main_state);
+    }
+}
+
+// Ciclos por troca com a rotina atual (cada rodada são duas trocas)
+static u32 bench_current() {
+    u32* stack = (u32*)(partner_stack + SWITCH_BENCH_STACK);
+    *--stack = 0;                       // Endereço de retorno fictício
+    *--stack = (u32)partner_current;    // Retorno de context_switch
+    for (int i = 0; i < 4; i++) {
+        *--stack = 0;                   // ebp, ebx, esi, edi
+    }
+    partner_esp = (u32)stack;
+    
+    context_switch(&main_esp, partner_esp); // Aquecimento
+    u64 start = cpu_rdtsc();
+    for (u32 i = 0; i < SWITCH_BENCH_ROUNDS; i++) {
+        context_switch(&main_esp, partner_esp);
+    }
+    u64 end = cpu_rdtsc();
+    return (u32)(end - start) / (2 * SWITCH_BENCH_ROUNDS);
+}
+
+// Ciclos por troca com a rotina antiga
+static u32 bench_legacy() {
+    u32 segment;
+    asm volatile("mov %%cs, %0" : "=r"(segment));
+    partner_state.cs = segment;
+    asm volatile("mov %%ds, %0" : "=r"(segment));
+    partner_state.ds = partner_state.es = partner_state.fs = partner_state.gs = segment;
+    asm volatile("mov %%ss, %0" : "=r"(segment));
+    partner_state.ss = segment;
+    asm volatile("pushf; pop %0" : "=r"(partner_state.eflags));
+    partner_state.eip = (u32)partner_legacy;
+    partner_state.esp = (u32)(partner_stack + SWITCH_BENCH_STACK - 4);
+    
+    context_switch_legacy(&main_state, &partner_state); // Aquecimento
+    u64 start = cpu_rdtsc();
+    for (u32 i = 0; i < SWITCH_BENCH_ROUNDS; i++) {
+        context_switch_legacy(&main_state, &partner_state);
+    }
+    u64 end = cpu_rdtsc();
+    return (u32)(end - start) / (2 * SWITCH_BENCH_ROUNDS);
+}
+
+// Ciclos de um fxsave seguido de fxrstor, o que uma troca ansiosa pagaria
+static u32 bench_fpu_save() {
+    u32 eax, ebx, ecx, edx;
+    cpu_cpuid(1, &eax, &ebx, &ecx, &edx);
+    if (!(edx & CPUID_EDX_FXSR)) return 0;
+    
+    u32 cr0 = cpu_read_cr0();
+    cpu_clts();
+    u64 start = cpu_rdtsc();
+    for (u32 i = 0; i < SWITCH_BENCH_ROUNDS; i++) {
+        asm volatile("fxsave (%0); fxrstor (%0)" : : "r"(fpu_area) : "memory");
+    }
+    u64 end = cpu_rdtsc();
+    cpu_write_cr0(cr0);
+    return (u32)(end - start) / SWITCH_BENCH_ROUNDS;
+}
+
+void bench_context_switch() {
+    u32 flags = cpu_irq_save();
+    u32 legacy = bench_legacy();
+    u32 current = bench_current();
+    u32 fpu = bench_fpu_save();
+    cpu_irq_restore(flags);
+    
+    vga_write("Troca de contexto (ciclos por troca): antiga ");
+    vga_write_dec(legacy);
+    vga_write(", atual ");
+    vga_write_dec(current);
+    vga_write("\n  fxsave+fxrstor evitados pela FPU preguicosa: ");
+    vga_write_dec(fpu);
+    vga_write(" ciclos\n");
+}
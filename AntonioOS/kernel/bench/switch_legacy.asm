@@ -0,0 +1,85 @@
+; switch_legacy.asm
+; Troca de contexto no formato antigo, usada apenas como referência pelo
+; benchmark de troca de contexto (make BENCH=1)
+;
+; Faz o mesmo trabalho da rotina substituída: salva todos os registradores
+; gerais, EFLAGS e os seis segmentos, recarrega os segmentos e termina com
+; iret. Diferente da original, troca de fato de pilha (iret no mesmo anel
+; não restaura ss:esp), para que o benchmark possa executá-la.
+
+[BITS 32]
+global context_switch_legacy
+
+; Deslocamentos em legacy_state_t
+%define ST_EBX 0
+%define ST_ECX 4
+%define ST_EDX 8
+%define ST_ESI 12
+%define ST_EDI 16
+%define ST_EBP 20
+%define ST_ESP 24
+%define ST_EIP 28
+%define ST_EFLAGS 32
+%define ST_CS 36
+%define ST_DS 40
+%define ST_ES 44
+%define ST_FS 48
+%define ST_GS 52
+%define ST_SS 56
+
+; void context_switch_legacy(legacy_state_t* old_state, legacy_state_t* new_state);
+context_switch_legacy:
+    mov eax, [esp+4]   ; old_state
+    mov edx, [esp+8]   ; new_state
+    
+    ; Salva o contexto atual no old_state
+    mov [eax+ST_EBX], ebx
+    mov [eax+ST_ECX], ecx
+    mov [eax+ST_EDX], edx
+    mov [eax+ST_ESI], esi
+    mov [eax+ST_EDI], edi
+    mov [eax+ST_EBP], ebp
+    lea ebx, [esp+4]           ; esp após o retorno
+    mov [eax+ST_ESP], ebx
+    mov ebx, [esp]             ; eip (endereço de retorno)
+    mov [eax+ST_EIP], ebx
+    pushfd
+    pop ebx
+    mov [eax+ST_EFLAGS], ebx
+    mov ebx, cs
+    mov [eax+ST_CS], ebx
+    mov ebx, ds
+    mov [eax+ST_DS], ebx
+    mov ebx, es
+    mov [eax+ST_ES], ebx
+    mov ebx, fs
+    mov [eax+ST_FS], ebx
+    mov ebx, gs
+    mov [eax+ST_GS], ebx
+    mov ebx, ss
+    mov [eax+ST_SS], ebx
+    
+    ; Restaura o contexto do new_state
+    mov ebx, [edx+ST_EBX]
+    mov ecx, [edx+ST_ECX]
+    mov esi, [edx+ST_ESI]
+    mov edi, [edx+ST_EDI]
+    mov ebp, [edx+ST_EBP]
+    mov eax, [edx+ST_DS]
+    mov ds, eax
+    mov eax, [edx+ST_ES]
+    mov es, eax
+    mov eax, [edx+ST_FS]
+    mov fs, eax
+    mov eax, [edx+ST_GS]
+    mov gs, eax
+    mov eax, [edx+ST_SS]
+    mov ss, eax
+    mov esp, [edx+ST_ESP]
+    
+    ; Quadro do iret na nova pilha (mesmo anel: eip, cs, eflags)
+    push dword [edx+ST_EFLAGS]
+    push dword [edx+ST_CS]
+    push dword [edx+ST_EIP]
+    mov edx, [edx+ST_EDX]
+    iret
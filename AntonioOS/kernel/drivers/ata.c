@@ -0,0 +1,479 @@
+#include "../include/ata.h"
+#include "../include/io.h"
+#include "../include/cpu.h"
+#include "../include/interrupts.h"
+#include "../include/memory.h"
+#include "../include/pci.h"
+#include "../include/workqueue.h"
+
+// Registradores do bloco de comandos (a partir da porta base do canal)
+#define ATA_REG_DATA 0
+#define ATA_REG_SECTOR_COUNT 2
+#define ATA_REG_LBA_LOW 3
+#define ATA_REG_LBA_MID 4
+#define ATA_REG_LBA_HIGH 5
+#define ATA_REG_DRIVE 6
+#define ATA_REG_STATUS 7              // Leitura: confirma a IRQ
+#define ATA_REG_COMMAND 7             // Escrita
+
+// Registrador de controle; lido, é o status alternativo (não confirma a IRQ)
+#define ATA_CONTROL_NIEN 0x02         // Disco não interrompe
+
+#define ATA_DRIVE_LBA 0xE0            // Modo LBA (e os dois bits fixos em 1)
+#define ATA_DRIVE_SLAVE 0x10
+
+// Bits do status
+#define ATA_STATUS_ERR 0x01
+#define ATA_STATUS_DRQ 0x08           // Disco pronto para transferir dados
+#define ATA_STATUS_DF 0x20            // Falha do disco
+#define ATA_STATUS_BSY 0x80
+#define ATA_STATUS_FLOATING 0xFF      // Canal sem nenhum disco
+
+// Comandos
+#define ATA_CMD_READ_SECTORS 0x20
+#define ATA_CMD_WRITE_SECTORS 0x30
+#define ATA_CMD_READ_MULTIPLE 0xC4
+#define ATA_CMD_WRITE_MULTIPLE 0xC5
+#define ATA_CMD_SET_MULTIPLE 0xC6
+#define ATA_CMD_READ_DMA 0xC8
+#define ATA_CMD_WRITE_DMA 0xCA
+#define ATA_CMD_IDENTIFY 0xEC
+
+// Palavras da resposta do IDENTIFY
+#define ATA_ID_MULTIPLE 47            // Byte baixo: máximo de setores por bloco (READ/WRITE MULTIPLE)
+#define ATA_ID_CAPABILITIES 49
+#define ATA_ID_LBA_SECTORS 60         // Palavras 60 e 61: setores endereçáveis com LBA28
+#define ATA_CAP_DMA 0x100
+#define ATA_CAP_LBA 0x200
+
+// Controladora IDE no PCI: registradores do bus master no BAR4, 8 portas por canal
+#define PCI_CLASS_STORAGE 0x01
+#define PCI_SUBCLASS_IDE 0x01
+#define PCI_IDE_BUS_MASTER 0x80       // Bit do prog-if: controladora com bus master
+#define ATA_BM_COMMAND 0
+#define ATA_BM_STATUS 2
+#define ATA_BM_PRDT 4
+#define ATA_BM_START 0x01
+#define ATA_BM_READ 0x08              // Do disco para a memória
+#define ATA_BM_STATUS_ERROR 0x02
+#define ATA_BM_STATUS_IRQ 0x04
+
+#define ATA_MAX_SECTORS 256           // LBA28: contagem 0 no registrador vale 256
+#define ATA_LBA28_LIMIT 0x10000000
+#define ATA_MULTIPLE_MAX 16
+#define ATA_POLL_LOOPS 1000000        // Leituras do status antes de desistir (~1s)
+#define ATA_PAGE_SIZE 4096
+
+// Entrada da tabela de regiões físicas (PRD) do DMA
+// Uma região tem até 64KB e não cruza um limite de 64KB
+typedef struct {
+    u32 address;                  // Endereço físico (par)
+    u16 bytes;                    // 0 vale 64KB
+    u16 flags;                    // ATA_PRD_END na última
+} __attribute__((packed)) ata_prd_t;
+
+#define ATA_PRD_END 0x8000
+#define ATA_PRD_REGION 0x10000
+// Uma página de entradas: cada setor de um comando de 256 toca no máximo
+// duas páginas que não continuam a região anterior
+#define ATA_PRD_MAX (ATA_PAGE_SIZE / sizeof(ata_prd_t))
+
+struct ata_channel;
+
+// Disco de um canal
+typedef struct ata_drive {
+    work_t error_work;            // Termina com erro um comando que não começou (primeiro campo)
+    block_device_t device;        // Dispositivo de blocos registrado
+    struct ata_channel* channel;
+    u8 slave;                     // 0: mestre, 1: escravo
+    u8 dma_capable;               // Disco e controladora suportam DMA
+    u8 dma;                       // Usar DMA nos próximos comandos
+    u8 multiple;                  // Setores por interrupção no PIO (0: READ/WRITE SECTORS)
+    
+    // Comando em andamento
+    block_request_t* request;     // Primeiro pedido da cadeia
+    block_request_t* cursor;      // Pedido onde está o próximo setor (PIO)
+    u32 cursor_sector;            // Setor dentro de cursor
+    u32 remaining;                // Setores ainda não transferidos (PIO)
+    u8 using_dma;                 // O comando usa DMA
+    u8 failed;                    // O comando falhou ao começar (error_work o termina)
+} ata_drive_t;
+
+// Canal IDE: dois discos com os mesmos registradores, um comando por vez
+typedef struct ata_channel {
+    u16 base;                     // Bloco de comandos
+    u16 control;                  // Controle / status alternativo
+    u16 bus_master;               // Registradores do bus master (0: sem DMA)
+    u8 irq;
+    spinlock_t lock;              // Protege active e os registradores
+    ata_drive_t* active;          // Disco com comando em andamento
+    ata_drive_t* drives[2];       // Mestre e escravo (NULL se ausente)
+    ata_prd_t* prd;               // Tabela PRD (uma página)
+    u32 prd_physical;
+} ata_channel_t;
+
+static ata_channel_t ata_channels[2] = {
+    { 0x1F0, 0x3F6, 0, IRQ_ATA_PRIMARY, SPINLOCK_INIT, NULL, { NULL, NULL }, NULL, 0 },
+    { 0x170, 0x376, 0, IRQ_ATA_SECONDARY, SPINLOCK_INIT, NULL, { NULL, NULL }, NULL, 0 }
+};
+
+// ~400ns depois de selecionar um disco, antes de o status valer
+static void ata_delay(ata_channel_t* channel) {
+    for (int i = 0; i < 4; i++) {
+        inb(channel->control);
+    }
+}
+
+// Espera o disco sair de BSY; devolve o status (ainda com BSY se desistir)
+// Conta voltas em vez de ticks: também é usada com as interrupções desligadas
+static u8 ata_wait(ata_channel_t* channel) {
+    u8 status = inb(channel->control);
+    for (u32 i = 0; (status & ATA_STATUS_BSY) && i < ATA_POLL_LOOPS; i++) {
+        cpu_pause();
+        status = inb(channel->control);
+    }
+    return status;
+}
+
+// Seleciona o disco e escreve o setor inicial e a contagem
+static void ata_setup(ata_drive_t* drive, u32 lba, u32 count) {
+    u16 base = drive->channel->base;
+    outb(base + ATA_REG_DRIVE, ATA_DRIVE_LBA | (drive->slave ? ATA_DRIVE_SLAVE : 0) | ((lba >> 24) & 0x0F));
+    ata_delay(drive->channel);
+    outb(base + ATA_REG_SECTOR_COUNT, count & 0xFF);
+    outb(base + ATA_REG_LBA_LOW, lba & 0xFF);
+    outb(base + ATA_REG_LBA_MID, (lba >> 8) & 0xFF);
+    outb(base + ATA_REG_LBA_HIGH, (lba >> 16) & 0xFF);
+}
+
+// Transfere o próximo bloco do PIO (multiple setores, ou 1) entre o disco e
+// os buffers dos pedidos da cadeia
+static void ata_pio_block(ata_drive_t* drive) {
+    u32 sectors = drive->multiple ? drive->multiple : 1;
+    if (sectors > drive->remaining) sectors = drive->remaining;
+    
+    u16 port = drive->channel->base + ATA_REG_DATA;
+    for (u32 i = 0; i < sectors; i++) {
+        u8* buffer = (u8*)drive->cursor->buffer + drive->cursor_sector * BLOCK_SECTOR_SIZE;
+        if (drive->request->write) {
+            outsw(port, buffer, BLOCK_SECTOR_SIZE / 2);
+        } else {
+            insw(port, buffer, BLOCK_SECTOR_SIZE / 2);
+        }
+        if (++drive->cursor_sector == drive->cursor->count) {
+            drive->cursor = drive->cursor->merged;
+            drive->cursor_sector = 0;
+        }
+    }
+    drive->remaining -= sectors;
+}
+
+// Monta a tabela PRD com as páginas físicas dos buffers da cadeia
+// Páginas fisicamente contíguas continuam a mesma região
+// Retorna 0 se um buffer não servir para DMA (o comando vai por PIO)
+static u32 ata_build_prd(ata_channel_t* channel, block_request_t* request) {
+    ata_prd_t* prd = channel->prd;
+    u32 count = 0;
+    u32 region_bytes = 0;
+    
+    for (block_request_t* member = request; member; member = member->merged) {
+        u32 address = (u32)member->buffer;
+        u32 size = member->count * BLOCK_SECTOR_SIZE;
+        if (address & 1) return 0;
+        
+        while (size) {
+            u32 physical = vmm_get_physical((void*)address);
+            if (!physical) return 0;
+            u32 chunk = ATA_PAGE_SIZE - (address & (ATA_PAGE_SIZE - 1));
+            if (chunk > size) chunk = size;
+            
+            u32 last = count - 1;
+            if (count && prd[last].address + region_bytes == physical &&
+                (physical & (ATA_PRD_REGION - 1)) && region_bytes + chunk <= ATA_PRD_REGION) {
+                region_bytes += chunk;
+            } else {
+                if (count == ATA_PRD_MAX) return 0;
+                last = count++;
+                prd[last].address = physical;
+                prd[last].flags = 0;
+                region_bytes = chunk;
+            }
+            prd[last].bytes = (u16)region_bytes;
+            
+            address += chunk;
+            size -= chunk;
+        }
+    }
+    
+    prd[count - 1].flags = ATA_PRD_END;
+    return 1;
+}
+
+// Termina o comando e dá a vez ao outro disco do canal
+// Chamada sem a trava do canal
+static void ata_finish(ata_drive_t* drive, u8 status) {
+    block_complete(&drive->device, status);
+    ata_drive_t* sibling = drive->channel->drives[!drive->slave];
+    if (sibling) {
+        block_run_queue(&sibling->device);
+    }
+}
+
+// Comando que falhou antes da primeira interrupção, terminado pela fila de trabalho
+static void ata_error_work(work_t* work) {
+    ata_drive_t* drive = (ata_drive_t*)work;
+    ata_channel_t* channel = drive->channel;
+    
+    u32 flags = spin_lock_irqsave(&channel->lock);
+    drive->failed = 0;
+    channel->active = NULL;
+    spin_unlock_irqrestore(&channel->lock, flags);
+    
+    ata_finish(drive, BLOCK_ERROR);
+}
+
+// Inicia o comando de uma cadeia de pedidos (block_device_t.start)
+// Retorna 0 se o outro disco do canal estiver no meio de um comando
+static u32 ata_start(block_device_t* device, block_request_t* request) {
+    ata_drive_t* drive = (ata_drive_t*)device->driver_data;
+    ata_channel_t* channel = drive->channel;
+    
+    u32 flags = spin_lock_irqsave(&channel->lock);
+    if (channel->active) {
+        spin_unlock_irqrestore(&channel->lock, flags);
+        return 0;
+    }
+    channel->active = drive;
+    drive->request = request;
+    drive->cursor = request;
+    drive->cursor_sector = 0;
+    drive->remaining = request->total;
+    drive->using_dma = drive->dma && ata_build_prd(channel, request);
+    
+    u16 base = channel->base;
+    ata_setup(drive, request->lba, request->total);
+    if (drive->using_dma) {
+        // Tabela, direção e status limpo antes do comando; o bus master
+        // começa depois que o disco recebe o comando
+        u16 bus_master = channel->bus_master;
+        outb(bus_master + ATA_BM_COMMAND, 0);
+        outl(bus_master + ATA_BM_PRDT, channel->prd_physical);
+        outb(bus_master + ATA_BM_STATUS, ATA_BM_STATUS_ERROR | ATA_BM_STATUS_IRQ);
+        outb(base + ATA_REG_COMMAND, request->write ? ATA_CMD_WRITE_DMA : ATA_CMD_READ_DMA);
+        outb(bus_master + ATA_BM_COMMAND, (request->write ? 0 : ATA_BM_READ) | ATA_BM_START);
+    } else if (!request->write) {
+        outb(base + ATA_REG_COMMAND, drive->multiple ? ATA_CMD_READ_MULTIPLE : ATA_CMD_READ_SECTORS);
+    } else {
+        outb(base + ATA_REG_COMMAND, drive->multiple ? ATA_CMD_WRITE_MULTIPLE : ATA_CMD_WRITE_SECTORS);
+        
+        // O primeiro bloco de uma escrita não é precedido por interrupção:
+        // vai assim que o disco pedir os dados
+        u8 status = ata_wait(channel);
+        if ((status & (ATA_STATUS_BSY | ATA_STATUS_ERR | ATA_STATUS_DF)) || !(status & ATA_STATUS_DRQ)) {
+            drive->failed = 1;
+            queue_work(system_workqueue, &drive->error_work);
+        } else {
+            ata_pio_block(drive);
+        }
+    }
+    
+    spin_unlock_irqrestore(&channel->lock, flags);
+    return 1;
+}
+
+// Manipulador da IRQ14/IRQ15
+// DMA: uma interrupção no fim do comando; PIO: uma por bloco de setores
+// (na leitura, o bloco já está pronto; na escrita, o anterior foi gravado)
+static void ata_irq(interrupt_frame_t* frame) {
+    ata_channel_t* channel = &ata_channels[frame->int_no == IRQ_BASE + IRQ_ATA_PRIMARY ? 0 : 1];
+    
+    spin_lock(&channel->lock);
+    ata_drive_t* drive = channel->active;
+    u8 bus_master_status = 0;
+    if (drive && drive->using_dma) {
+        bus_master_status = inb(channel->bus_master + ATA_BM_STATUS);
+    }
+    u8 status = inb(channel->base + ATA_REG_STATUS);
+    
+    // Sem comando, ou um que já falhou ao começar: só confirma a interrupção
+    if (!drive || drive->failed) {
+        spin_unlock(&channel->lock);
+        return;
+    }
+    
+    u32 finished = 0;
+    u8 result = BLOCK_OK;
+    if (drive->using_dma) {
+        outb(channel->bus_master + ATA_BM_COMMAND, 0);
+        outb(channel->bus_master + ATA_BM_STATUS, ATA_BM_STATUS_ERROR | ATA_BM_STATUS_IRQ);
+        if ((bus_master_status & ATA_BM_STATUS_ERROR) || (status & (ATA_STATUS_ERR | ATA_STATUS_DF))) {
+            result = BLOCK_ERROR;
+        }
+        finished = 1;
+    } else if (status & (ATA_STATUS_ERR | ATA_STATUS_DF)) {
+        result = BLOCK_ERROR;
+        finished = 1;
+    } else if (!drive->request->write) {
+        ata_pio_block(drive);
+        finished = !drive->remaining;
+    } else if (drive->remaining) {
+        ata_pio_block(drive);
+    } else {
+        finished = 1;
+    }
+    
+    if (finished) {
+        channel->active = NULL;
+    }
+    spin_unlock(&channel->lock);
+    
+    if (finished) {
+        ata_finish(drive, result);
+    }
+}
+
+// Identifica um disco ATA (discos ATAPI e SATA ficam de fora)
+// Retorna 0 se não houver disco
+static u32 ata_identify(ata_channel_t* channel, u8 slave, u16* id) {
+    u16 base = channel->base;
+    outb(base + ATA_REG_DRIVE, 0xA0 | (slave ? ATA_DRIVE_SLAVE : 0));
+    ata_delay(channel);
+    outb(base + ATA_REG_SECTOR_COUNT, 0);
+    outb(base + ATA_REG_LBA_LOW, 0);
+    outb(base + ATA_REG_LBA_MID, 0);
+    outb(base + ATA_REG_LBA_HIGH, 0);
+    outb(base + ATA_REG_COMMAND, ATA_CMD_IDENTIFY);
+    
+    u8 status = inb(base + ATA_REG_STATUS);
+    if (!status || status == ATA_STATUS_FLOATING) return 0;
+    
+    status = ata_wait(channel);
+    if (status & ATA_STATUS_BSY) return 0;
+    
+    // Assinatura diferente de zero: ATAPI ou SATA, que não respondem ao IDENTIFY
+    if (inb(base + ATA_REG_LBA_MID) || inb(base + ATA_REG_LBA_HIGH)) return 0;
+    
+    for (u32 i = 0; !(status & (ATA_STATUS_DRQ | ATA_STATUS_ERR)); i++) {
+        if (i == ATA_POLL_LOOPS) return 0;
+        status = inb(channel->control);
+    }
+    if (status & ATA_STATUS_ERR) return 0;
+    
+    insw(base + ATA_REG_DATA, id, 256);
+    return 1;
+}
+
+// Liga o READ/WRITE MULTIPLE com o maior bloco que o disco aceita (até 16)
+static u8 ata_set_multiple(ata_drive_t* drive, u16* id) {
+    u32 multiple = id[ATA_ID_MULTIPLE] & 0xFF;
+    if (!multiple) return 0;
+    if (multiple > ATA_MULTIPLE_MAX) multiple = ATA_MULTIPLE_MAX;
+    
+    ata_setup(drive, 0, multiple);
+    outb(drive->channel->base + ATA_REG_COMMAND, ATA_CMD_SET_MULTIPLE);
+    u8 status = ata_wait(drive->channel);
+    if (status & (ATA_STATUS_BSY | ATA_STATUS_ERR)) return 0;
+    return (u8)multiple;
+}
+
+// Procura a controladora IDE no PCI e liga o bus master
+// Retorna a porta dos registradores do bus master (0 se não houver)
+static u16 ata_find_bus_master() {
+    pci_address_t address;
+    if (!pci_find_class(PCI_CLASS_STORAGE, PCI_SUBCLASS_IDE, &address)) return 0;
+    
+    u32 prog_if = (pci_read_config(&address, PCI_CLASS) >> 8) & 0xFF;
+    if (!(prog_if & PCI_IDE_BUS_MASTER)) return 0;
+    
+    u32 bar4 = pci_read_config(&address, PCI_BAR4);
+    if (!(bar4 & 1)) return 0;    // Esperado no espaço de E/S
+    
+    u32 command = pci_read_config(&address, PCI_COMMAND) & 0xFFFF;
+    pci_write_config(&address, PCI_COMMAND, command | PCI_COMMAND_IO | PCI_COMMAND_MASTER);
+    return (u16)(bar4 & 0xFFFC);
+}
+
+// Procura os dois discos de um canal e registra os encontrados
+static void ata_probe_channel(ata_channel_t* channel, u32 index, u16 bus_master) {
+    // Canal sem discos: o barramento flutua em 0xFF
+    if (inb(channel->base + ATA_REG_STATUS) == ATA_STATUS_FLOATING) return;
+    
+    // A identificação espera por polling
+    outb(channel->control, ATA_CONTROL_NIEN);
+    
+    u16 id[256];
+    for (u8 slave = 0; slave < 2; slave++) {
+        if (!ata_identify(channel, slave, id)) continue;
+        if (!(id[ATA_ID_CAPABILITIES] & ATA_CAP_LBA)) continue;
+        
+        ata_drive_t* drive = (ata_drive_t*)kmalloc(sizeof(ata_drive_t));
+        if (!drive) break;
+        work_init(&drive->error_work, ata_error_work);
+        drive->channel = channel;
+        drive->slave = slave;
+        drive->dma_capable = bus_master && (id[ATA_ID_CAPABILITIES] & ATA_CAP_DMA);
+        drive->dma = drive->dma_capable;
+        drive->multiple = ata_set_multiple(drive, id);
+        drive->request = NULL;
+        drive->using_dma = 0;
+        drive->failed = 0;
+        
+        block_device_t* device = &drive->device;
+        device->name[0] = 'h';
+        device->name[1] = 'd';
+        device->name[2] = 'a' + index * 2 + slave;
+        device->name[3] = '\0';
+        device->sector_count = id[ATA_ID_LBA_SECTORS] | ((u32)id[ATA_ID_LBA_SECTORS + 1] << 16);
+        if (device->sector_count > ATA_LBA28_LIMIT) device->sector_count = ATA_LBA28_LIMIT;
+        device->max_sectors = ATA_MAX_SECTORS;
+        device->start = ata_start;
+        device->driver_data = drive;
+        channel->drives[slave] = drive;
+        block_register(device);
+    }
+    
+    if (!channel->drives[0] && !channel->drives[1]) return;
+    
+    // Tabela PRD do canal: uma página do heap, fisicamente contígua
+    if (bus_master) {
+        channel->prd = (ata_prd_t*)kmalloc_aligned(ATA_PAGE_SIZE, ATA_PAGE_SIZE);
+        if (channel->prd) {
+            channel->prd[0].flags = 0;
+            channel->prd_physical = vmm_get_physical(channel->prd);
+            channel->bus_master = bus_master + index * 8;
+        }
+        if (!channel->prd) {
+            for (u32 slave = 0; slave < 2; slave++) {
+                if (channel->drives[slave]) {
+                    channel->drives[slave]->dma_capable = 0;
+                    channel->drives[slave]->dma = 0;
+                }
+            }
+        }
+    }
+    
+    interrupt_register_handler(IRQ_BASE + channel->irq, ata_irq);
+    pic_unmask_irq(channel->irq);
+    outb(channel->control, 0);
+}
+
+// Procura e registra os discos dos dois canais
+void ata_init() {
+    u16 bus_master = ata_find_bus_master();
+    for (u32 i = 0; i < 2; i++) {
+        ata_probe_channel(&ata_channels[i], i, bus_master);
+    }
+}
+
+// Liga ou desliga o DMA de um disco
+u32 ata_set_dma(block_device_t* device, u32 enable) {
+    ata_drive_t* drive = (ata_drive_t*)device->driver_data;
+    if (enable && !drive->dma_capable) return 0;
+    drive->dma = enable ? 1 : 0;
+    return 1;
+}
+
+// 1 se o disco está usando DMA
+u32 ata_get_dma(block_device_t* device) {
+    return ((ata_drive_t*)device->driver_data)->dma;
+}
@@ -0,0 +1,333 @@
+#include "../include/block.h"
+#include "../include/memory.h"
+
+#define BLOCK_PAGE_SIZE 4096
+
+// Dispositivos registrados
+static block_device_t* block_devices = NULL;
+static spinlock_t block_devices_lock = SPINLOCK_INIT;
+
+// A fila de um dispositivo é uma lista dupla em ordem de setor; cada
+// elemento é o primeiro de uma cadeia de pedidos contíguos (merged), que o
+// driver transfere em um único comando
+// Ordem das travas: device->lock antes das travas do driver; o driver chama
+// block_complete sem as suas travas
+
+// Registra um dispositivo
+void block_register(block_device_t* device) {
+    spin_init(&device->lock);
+    device->queue = NULL;
+    device->active = NULL;
+    device->position = 0;
+    device->plugged = 0;
+    device->next_seq = 0;
+    wait_queue_init(&device->wait);
+    device->submitted = 0;
+    device->merges = 0;
+    device->dispatches = 0;
+    device->errors = 0;
+    
+    u32 flags = spin_lock_irqsave(&block_devices_lock);
+    device->next = block_devices;
+    block_devices = device;
+    spin_unlock_irqrestore(&block_devices_lock, flags);
+}
+
+// Procura um dispositivo pelo nome
+block_device_t* block_find(const char* name) {
+    u32 flags = spin_lock_irqsave(&block_devices_lock);
+    block_device_t* device = block_devices;
+    for (; device; device = device->next) {
+        u32 i = 0;
+        while (name[i] && device->name[i] == name[i]) {
+            i++;
+        }
+        if (!name[i] && !device->name[i]) break;
+    }
+    spin_unlock_irqrestore(&block_devices_lock, flags);
+    return device;
+}
+
+// Primeiro dispositivo registrado
+// Dispositivos só são acrescentados no início: os seguintes (next) não mudam
+block_device_t* block_get_devices() {
+    u32 flags = spin_lock_irqsave(&block_devices_lock);
+    block_device_t* device = block_devices;
+    spin_unlock_irqrestore(&block_devices_lock, flags);
+    return device;
+}
+
+// Prepara um pedido
+void block_request_init(block_request_t* request, u32 lba, u32 count, void* buffer, u8 write) {
+    request->lba = lba;
+    request->count = count;
+    request->buffer = buffer;
+    request->write = write;
+    request->done = 0;
+    request->status = BLOCK_OK;
+    request->complete = NULL;
+    request->private = NULL;
+}
+
+// Os dois pedidos (cadeias) acessam setores em comum e um deles escreve:
+// o que foi submetido antes precisa chegar antes ao disco
+static u32 block_conflict(block_request_t* a, block_request_t* b) {
+    if (!a->write && !b->write) return 0;
+    return a->lba < b->lba + b->total && b->lba < a->lba + a->total;
+}
+
+// b pode ir no mesmo comando logo depois de a
+static u32 block_can_append(block_device_t* device, block_request_t* a, block_request_t* b) {
+    return a->write == b->write && a->lba + a->total == b->lba &&
+           a->total + b->total <= device->max_sectors;
+}
+
+// Alguma cadeia da fila, além de a e b, conflita com a ou com b
+static u32 block_conflicts_queue(block_device_t* device, block_request_t* a, block_request_t* b) {
+    for (block_request_t* queued = device->queue; queued; queued = queued->queue_next) {
+        if (queued == a || queued == b) continue;
+        if (block_conflict(queued, a) || block_conflict(queued, b)) return 1;
+    }
+    return 0;
+}
+
+// Acrescenta a cadeia de b ao fim da cadeia de a
+static void block_chain_append(block_request_t* a, block_request_t* b) {
+    a->merged_tail->merged = b;
+    a->merged_tail = b->merged_tail;
+    a->total += b->total;
+    if (b->seq < a->seq) a->seq = b->seq;
+}
+
+// Tira uma cadeia da fila (device->lock travado)
+static void block_queue_unlink(block_device_t* device, block_request_t* request) {
+    if (request->queue_prev) {
+        request->queue_prev->queue_next = request->queue_next;
+    } else {
+        device->queue = request->queue_next;
+    }
+    if (request->queue_next) {
+        request->queue_next->queue_prev = request->queue_prev;
+    }
+}
+
+// Coloca uma cadeia na fila depois de prev (NULL: no início)
+static void block_queue_insert(block_device_t* device, block_request_t* prev, block_request_t* request) {
+    request->queue_prev = prev;
+    request->queue_next = prev ? prev->queue_next : device->queue;
+    if (request->queue_next) {
+        request->queue_next->queue_prev = request;
+    }
+    if (prev) {
+        prev->queue_next = request;
+    } else {
+        device->queue = request;
+    }
+}
+
+// Insere um pedido na fila, fundindo-o com os vizinhos quando contíguos
+// Um pedido que conflita com outro já na fila não é fundido: ele mantém a
+// própria ordem de submissão, respeitada por block_pick
+static void block_enqueue(block_device_t* device, block_request_t* request) {
+    u32 conflict = 0;
+    block_request_t* prev = NULL;
+    for (block_request_t* queued = device->queue; queued; queued = queued->queue_next) {
+        if (block_conflict(queued, request)) conflict = 1;
+        if (queued->lba <= request->lba) prev = queued;
+    }
+    block_request_t* next = prev ? prev->queue_next : device->queue;
+    
+    if (!conflict) {
+        // Fusão pelo fim: o pedido continua a cadeia anterior, que pode
+        // então alcançar a seguinte
+        // Juntar duas cadeias antigas dá a ambas a menor ordem de submissão:
+        // só é feito se nenhuma delas esperar por outro pedido da fila
+        if (prev && block_can_append(device, prev, request)) {
+            block_chain_append(prev, request);
+            device->merges++;
+            if (next && block_can_append(device, prev, next) && !block_conflicts_queue(device, prev, next)) {
+                block_queue_unlink(device, next);
+                block_chain_append(prev, next);
+                device->merges++;
+            }
+            return;
+        }
+        
+        // Fusão pelo início: o pedido passa a ser o primeiro da cadeia seguinte
+        if (next && block_can_append(device, request, next)) {
+            block_queue_unlink(device, next);
+            block_chain_append(request, next);
+            block_queue_insert(device, prev, request);
+            device->merges++;
+            return;
+        }
+    }
+    
+    block_queue_insert(device, prev, request);
+}
+
+// Escolhe o próximo comando pelo C-LOOK: a primeira cadeia a partir da
+// posição do último comando, ou a de menor setor quando não houver nenhuma
+// adiante (o braço volta ao início sem percorrer o disco até o fim)
+// Uma cadeia submetida antes que conflite com a escolhida vai primeiro
+static block_request_t* block_pick(block_device_t* device) {
+    block_request_t* pick = device->queue;
+    for (block_request_t* queued = device->queue; queued; queued = queued->queue_next) {
+        if (queued->lba >= device->position) {
+            pick = queued;
+            break;
+        }
+    }
+    
+    block_request_t* queued = device->queue;
+    while (queued) {
+        if (queued->seq < pick->seq && block_conflict(queued, pick)) {
+            pick = queued;
+            queued = device->queue;
+            continue;
+        }
+        queued = queued->queue_next;
+    }
+    return pick;
+}
+
+// Envia o próximo comando ao driver (device->lock travado)
+static void block_dispatch(block_device_t* device) {
+    if (device->active || device->plugged || !device->queue) return;
+    
+    block_request_t* request = block_pick(device);
+    device->active = request;
+    if (!device->start(device, request)) {
+        // Dispositivo ocupado (outro disco do mesmo canal): o driver chama
+        // block_run_queue quando ele se liberar
+        device->active = NULL;
+        return;
+    }
+    block_queue_unlink(device, request);
+    device->position = request->lba + request->total;
+    device->dispatches++;
+}
+
+// Toca cada página do buffer: o heap é reservado sob demanda e o driver,
+// no manipulador de interrupção, precisa encontrá-las mapeadas
+static void block_touch_pages(u8* buffer, u32 size) {
+    u32 page = (u32)buffer & ~(BLOCK_PAGE_SIZE - 1);
+    u32 end = (u32)buffer + size;
+    for (; page < end; page += BLOCK_PAGE_SIZE) {
+        u8* address = page < (u32)buffer ? buffer : (u8*)page;
+        (void)*(volatile u8*)address;
+    }
+}
+
+// Coloca um pedido na fila e retorna sem esperar
+u32 block_submit(block_device_t* device, block_request_t* request) {
+    if (!request->count || request->count > device->max_sectors) return 0;
+    if (request->lba >= device->sector_count || request->count > device->sector_count - request->lba) return 0;
+    
+    block_touch_pages((u8*)request->buffer, request->count * BLOCK_SECTOR_SIZE);
+    request->done = 0;
+    request->status = BLOCK_OK;
+    request->total = request->count;
+    request->merged = NULL;
+    request->merged_tail = request;
+    
+    u32 flags = spin_lock_irqsave(&device->lock);
+    request->seq = device->next_seq++;
+    device->submitted++;
+    block_enqueue(device, request);
+    block_dispatch(device);
+    spin_unlock_irqrestore(&device->lock, flags);
+    return 1;
+}
+
+// Segura os pedidos na fila
+void block_plug(block_device_t* device) {
+    u32 flags = spin_lock_irqsave(&device->lock);
+    device->plugged++;
+    spin_unlock_irqrestore(&device->lock, flags);
+}
+
+// Libera os pedidos acumulados
+void block_unplug(block_device_t* device) {
+    u32 flags = spin_lock_irqsave(&device->lock);
+    if (device->plugged) device->plugged--;
+    block_dispatch(device);
+    spin_unlock_irqrestore(&device->lock, flags);
+}
+
+// Envia o próximo pedido da fila se o dispositivo estiver livre
+void block_run_queue(block_device_t* device) {
+    u32 flags = spin_lock_irqsave(&device->lock);
+    block_dispatch(device);
+    spin_unlock_irqrestore(&device->lock, flags);
+}
+
+// Termina o pedido em andamento
+// O próximo comando é enviado antes de completar os pedidos, para que o
+// dispositivo não fique parado durante as funções de término
+void block_complete(block_device_t* device, u8 status) {
+    u32 flags = spin_lock_irqsave(&device->lock);
+    block_request_t* request = device->active;
+    device->active = NULL;
+    if (status != BLOCK_OK) device->errors++;
+    block_dispatch(device);
+    spin_unlock_irqrestore(&device->lock, flags);
+    
+    while (request) {
+        // merged é lido antes: a função de término pode reutilizar o pedido
+        block_request_t* next = request->merged;
+        request->status = status;
+        request->done = 1;
+        if (request->complete) request->complete(request);
+        request = next;
+    }
+    wake_up_all(&device->wait);
+}
+
+// Bloqueia até o pedido terminar
+u32 block_wait(block_device_t* device, block_request_t* request) {
+    wait_event(&device->wait, request->done);
+    return request->status;
+}
+
+// Leitura ou escrita síncrona: todos os comandos são submetidos com a fila
+// segurada e só depois esperados
+#define BLOCK_SYNC_REQUESTS 8
+
+static u32 block_transfer(block_device_t* device, u32 lba, u32 count, u8* buffer, u8 write) {
+    block_request_t requests[BLOCK_SYNC_REQUESTS];
+    u32 ok = 1;
+    
+    while (count && ok) {
+        u32 used = 0;
+        block_plug(device);
+        while (count && used < BLOCK_SYNC_REQUESTS) {
+            u32 sectors = count < device->max_sectors ? count : device->max_sectors;
+            block_request_init(&requests[used], lba, sectors, buffer, write);
+            if (!block_submit(device, &requests[used])) {
+                ok = 0;
+                break;
+            }
+            used++;
+            lba += sectors;
+            count -= sectors;
+            buffer += sectors * BLOCK_SECTOR_SIZE;
+        }
+        block_unplug(device);
+        
+        for (u32 i = 0; i < used; i++) {
+            if (block_wait(device, &requests[i]) != BLOCK_OK) ok = 0;
+        }
+    }
+    return ok;
+}
+
+// Leitura síncrona de count setores
+u32 block_read(block_device_t* device, u32 lba, u32 count, void* buffer) {
+    return block_transfer(device, lba, count, (u8*)buffer, 0);
+}
+
+// Escrita síncrona de count setores
+u32 block_write(block_device_t* device, u32 lba, u32 count, void* buffer) {
+    return block_transfer(device, lba, count, (u8*)buffer, 1);
+}
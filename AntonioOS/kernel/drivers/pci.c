@@ -0,0 +1,64 @@
+#include "../include/pci.h"
+#include "../include/io.h"
+#include "../include/spinlock.h"
+
+// Mecanismo de configuração 1: o endereço vai para CONFIG_ADDRESS e a
+// palavra é lida ou escrita em CONFIG_DATA
+#define PCI_CONFIG_ADDRESS 0xCF8
+#define PCI_CONFIG_DATA 0xCFC
+#define PCI_CONFIG_ENABLE 0x80000000
+#define PCI_HEADER_TYPE 0x0C          // Byte 2: tipo do cabeçalho (bit 7: várias funções)
+#define PCI_MULTIFUNCTION 0x00800000
+
+// Protege o par CONFIG_ADDRESS / CONFIG_DATA, compartilhado por todas as CPUs
+static spinlock_t pci_lock = SPINLOCK_INIT;
+
+static u32 pci_config_address(pci_address_t* address, u8 offset) {
+    return PCI_CONFIG_ENABLE | ((u32)address->bus << 16) | ((u32)address->device << 11) |
+           ((u32)address->function << 8) | (offset & 0xFC);
+}
+
+// Lê uma palavra de 32 bits do espaço de configuração
+u32 pci_read_config(pci_address_t* address, u8 offset) {
+    u32 flags = spin_lock_irqsave(&pci_lock);
+    outl(PCI_CONFIG_ADDRESS, pci_config_address(address, offset));
+    u32 value = inl(PCI_CONFIG_DATA);
+    spin_unlock_irqrestore(&pci_lock, flags);
+    return value;
+}
+
+// Escreve uma palavra de 32 bits no espaço de configuração
+void pci_write_config(pci_address_t* address, u8 offset, u32 value) {
+    u32 flags = spin_lock_irqsave(&pci_lock);
+    outl(PCI_CONFIG_ADDRESS, pci_config_address(address, offset));
+    outl(PCI_CONFIG_DATA, value);
+    spin_unlock_irqrestore(&pci_lock, flags);
+}
+
+// Procura a primeira função com a classe e a subclasse pedidas
+// A função 0 diz se o dispositivo tem outras; as demais só são lidas nesse caso
+u32 pci_find_class(u8 class_code, u8 subclass, pci_address_t* address) {
+    for (u32 bus = 0; bus < 256; bus++) {
+        for (u32 device = 0; device < 32; device++) {
+            for (u32 function = 0; function < 8; function++) {
+                pci_address_t candidate = { (u8)bus, (u8)device, (u8)function };
+                u32 id = pci_read_config(&candidate, PCI_VENDOR_ID);
+                if ((id & 0xFFFF) == PCI_NO_VENDOR) {
+                    if (!function) break;
+                    continue;
+                }
+                
+                u32 class_reg = pci_read_config(&candidate, PCI_CLASS);
+                if ((class_reg >> 24) == class_code && ((class_reg >> 16) & 0xFF) == subclass) {
+                    *address = candidate;
+                    return 1;
+                }
+                
+                if (!function && !(pci_read_config(&candidate, PCI_HEADER_TYPE) & PCI_MULTIFUNCTION)) {
+                    break;
+                }
+            }
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,138 @@
+#include "../include/timer.h"
+#include "../include/io.h"
+#include "../include/cpu.h"
+#include "../include/interrupts.h"
+#include "../include/process.h"
+
+// PIT (Programmable Interval Timer 8253/8254), canal 0 ligado à IRQ0
+#define PIT_FREQUENCY 1193182
+#define PIT_CHANNEL0 0x40
+#define PIT_COMMAND 0x43
+#define PIT_MODE_ONESHOT 0x30   // Canal 0, byte baixo e alto, modo 0 (interrompe ao chegar a zero)
+#define PIT_MODE_PERIODIC 0x34  // Canal 0, byte baixo e alto, modo 2 (gerador de taxa)
+#define PIT_LATCH 0x00          // Congela a contagem do canal 0 para leitura
+#define PIT_MAX_COUNT 0xFFFF
+
+// Estado do timer
+static volatile u64 timer_ticks = 0;
+static u32 timer_frequency = TIMER_HZ;
+static u32 timer_divisor = PIT_FREQUENCY / TIMER_HZ;  // Contagens do PIT por tick
+static volatile u32 timer_oneshot_ticks = 0;           // Ticks do disparo único armado (0 = periódico)
+
+// Programa o canal 0 do PIT
+static void pit_program(u8 mode, u32 count) {
+    outb(PIT_COMMAND, mode);
+    outb(PIT_CHANNEL0, count & 0xFF);
+    outb(PIT_CHANNEL0, (count >> 8) & 0xFF);
+}
+
+// Lê a contagem atual do canal 0
+static u32 pit_read_count() {
+    outb(PIT_COMMAND, PIT_LATCH);
+    u32 low = inb(PIT_CHANNEL0);
+    u32 high = inb(PIT_CHANNEL0);
+    return (high << 8) | low;
+}
+
+// Manipulador da IRQ0 (só chega à BSP)
+static void timer_irq(interrupt_frame_t* frame) {
+    (void)frame;
+    u32 elapsed = 1;
+    
+    // Fim de um período sem ticks: contabiliza o intervalo inteiro e volta
+    // aos ticks periódicos
+    if (timer_oneshot_ticks) {
+        elapsed = timer_oneshot_ticks;
+        timer_oneshot_ticks = 0;
+        pit_program(PIT_MODE_PERIODIC, timer_divisor);
+    }
+    
+    timer_ticks += elapsed;
+    scheduler_wake_sleepers();
+    scheduler_tick(elapsed);
+}
+
+// Inicializa o PIT no modo periódico e libera a IRQ0
+void timer_init(u32 frequency) {
+    timer_frequency = frequency;
+    timer_divisor = PIT_FREQUENCY / frequency;
+    if (timer_divisor > PIT_MAX_COUNT) timer_divisor = PIT_MAX_COUNT;
+    
+    interrupt_register_handler(IRQ_BASE + IRQ_TIMER, timer_irq);
+    pit_program(PIT_MODE_PERIODIC, timer_divisor);
+    pic_unmask_irq(IRQ_TIMER);
+}
+
+// Ticks desde a inicialização
+// Um u64 não é lido atomicamente em 32 bits, e a IRQ0 pode chegar à BSP
+// enquanto outra CPU lê: repete a leitura até obter duas iguais
+u64 timer_get_ticks() {
+    u64 ticks;
+    do {
+        ticks = timer_ticks;
+    } while (ticks != timer_ticks);
+    return ticks;
+}
+
+// Espera ativa de pelo menos ms milissegundos (precisa da IRQ0 ligada)
+void timer_wait(u32 ms) {
+    u64 end = timer_get_ticks() + timer_ms_to_ticks(ms) + 1;
+    while (timer_get_ticks() < end) {
+        cpu_pause();
+    }
+}
+
+// Converte milissegundos em ticks (arredonda para cima, mínimo 1)
+u32 timer_ms_to_ticks(u32 ms) {
+    u32 ticks = (ms * timer_frequency + 999) / 1000;
+    return ticks ? ticks : 1;
+}
+
+// Chamado pelo processo idle: troca os ticks periódicos por um único disparo
+// no próximo prazo do escalonador e para a CPU até a próxima interrupção
+void timer_idle() {
+    u32 flags = cpu_irq_save();
+    
+    // Algo ficou pronto depois que o idle olhou as filas: não dorme
+    if (scheduler_ready_count()) {
+        cpu_irq_restore(flags);
+        return;
+    }
+    
+    // O PIT conta no máximo 65535 vezes (~55ms) por disparo
+    u32 max_ticks = PIT_MAX_COUNT / timer_divisor;
+    u64 deadline = scheduler_next_deadline();
+    u32 sleep = max_ticks;
+    if (deadline != TIMER_NO_DEADLINE) {
+        u64 now = timer_ticks;
+        if (deadline <= now) {
+            sleep = 0;
+        } else if (deadline - now < max_ticks) {
+            sleep = (u32)(deadline - now);
+        }
+    }
+    
+    // Um tick ou menos até o prazo: não compensa sair do modo periódico
+    if (sleep <= 1) {
+        asm volatile("sti; hlt; cli");
+        cpu_irq_restore(flags);
+        return;
+    }
+    
+    timer_oneshot_ticks = sleep;
+    pit_program(PIT_MODE_ONESHOT, sleep * timer_divisor);
+    
+    // sti só vale após a instrução seguinte: nenhuma IRQ escapa antes do hlt
+    asm volatile("sti; hlt; cli");
+    
+    // Acordado por outra IRQ antes do disparo: contabiliza só os ticks que
+    // passaram (a fração do tick atual é descartada) e volta ao modo periódico
+    if (timer_oneshot_ticks) {
+        u32 counted = sleep * timer_divisor - pit_read_count();
+        timer_ticks += counted / timer_divisor;
+        timer_oneshot_ticks = 0;
+        pit_program(PIT_MODE_PERIODIC, timer_divisor);
+    }
+    
+    cpu_irq_restore(flags);
+}
@@ -1,285 +1,638 @@
 #include "../include/filesystem.h"
 #include "../include/memory.h"
+#include "../include/slab.h"
+#include "../include/kstring.h"
+#include "../include/spinlock.h"
 
 // Nó raiz do sistema de arquivos
 fs_node_t* fs_root = NULL;
 
 // Sistema de arquivos simples em memória
+// Cada arquivo ou diretório é um inode da tabela de inodes; um diretório
+// guarda as suas entradas em um vetor, na ordem de criação (readdir), e uma
+// tabela de endereçamento aberto indexa o vetor pelo hash do nome (finddir)
+// fs_node_t é a visão de um inode entregue a quem chama: há no máximo um
+// por inode, compartilhado e contado por referência
+
+// Entrada de diretório
 typedef struct {
-    char name[128];
-    u8* data;
-    u32 size;
-    u32 capacity;
-} simplefs_file_t;
+    u32 hash;                     // Hash do nome, calculado uma única vez
+    u32 inode;                    // Inode da entrada
+    char* name;                   // Nome (cópia no heap)
+} simplefs_dirent_t;
 
-#define MAX_FILES 64
-static simplefs_file_t files[MAX_FILES];
-static u32 file_count = 0;
+// Entradas de um diretório
+typedef struct {
+    simplefs_dirent_t* entries;   // Entradas na ordem de criação
+    u32 count;
+    u32 capacity;                 // Entradas alocadas em entries
+    u32* slots;                   // Índice da entrada + 1 (0: posição vazia)
+    u32 slot_mask;                // Número de posições - 1 (potência de 2)
+} simplefs_dir_t;
 
-// Inicializa o sistema de arquivos
-void fs_init() {
-    // Inicializa o array de arquivos
-    for (u32 i = 0; i < MAX_FILES; i++) {
-        files[i].name[0] = '\0';
-        files[i].data = NULL;
-        files[i].size = 0;
-        files[i].capacity = 0;
+// Inode
+typedef struct {
+    fs_node_type_t type;
+    u32 permissions;
+    u32 parent;                   // Inode do diretório pai (a raiz é pai de si mesma)
+    u32 size;                     // Tamanho do arquivo em bytes
+    u8*** leaves;                 // Mapa de blocos: folhas de SIMPLEFS_LEAF_BLOCKS blocos (NULL: buraco)
+    u32 leaf_slots;               // Posições alocadas em leaves
+    simplefs_dir_t* dir;          // Entradas de um diretório
+    const char* name;             // Nome da entrada que aponta para o inode
+    struct simplefs_vnode* vnode; // Nó em cache (NULL se não houver)
+    fs_node_t* node;              // Nó mantido por outro subsistema (fs_register_node)
+} simplefs_inode_t;
+
+// Nó em cache
+// Quem recebe um nó recebe uma referência e a devolve com fs_close (ou
+// fs_release); sem referências, o nó continua em cache em uma lista LRU
+// e a próxima busca pelo mesmo inode o reaproveita sem alocar nada
+typedef struct simplefs_vnode {
+    fs_node_t node;               // Primeiro campo: os dois ponteiros se convertem
+    u32 refs;
+    struct simplefs_vnode* lru_prev;
+    struct simplefs_vnode* lru_next;
+} simplefs_vnode_t;
+
+// Tabela de inodes, indexada pelo número do inode (0 é a raiz)
+// Cresce dobrando de tamanho: não há limite fixo de arquivos
+static simplefs_inode_t** inodes = NULL;
+static u32 inode_count = 0;
+static u32 inode_capacity = 0;
+
+#define SIMPLEFS_NO_INODE 0xFFFFFFFF  // Retorno de simplefs_inode_create sem memória
+#define SIMPLEFS_DIR_SLOTS 16         // Posições iniciais da tabela de um diretório
+#define SIMPLEFS_NAME_MAX 127         // Bytes de um nome, sem o '\0'
+#define SIMPLEFS_LRU_MAX 128          // Nós sem referências mantidos em cache
+#define SIMPLEFS_BLOCK_SIZE 4096      // Bytes de cada bloco de um arquivo
+#define SIMPLEFS_LEAF_BLOCKS 1024     // Blocos por folha do mapa (uma folha ocupa 4KB)
+
+// Cache de objetos para os nós entregues por readdir/finddir/create
+static kmem_cache_t* node_cache = NULL;
+
+// Nós sem referências, do mais recente (lru_head) ao mais antigo (lru_tail)
+static simplefs_vnode_t* lru_head = NULL;
+static simplefs_vnode_t* lru_tail = NULL;
+static u32 lru_count = 0;
+
+// Protege a tabela de inodes, os diretórios, os blocos dos arquivos, as
+// referências dos nós e a lista LRU; as funções *_locked a esperam travada
+static spinlock_t simplefs_lock = SPINLOCK_INIT;
+
+static u32 simplefs_read(fs_node_t* node, u32 offset, u32 size, u8* buffer);
+static u32 simplefs_write(fs_node_t* node, u32 offset, u32 size, u8* buffer);
+static fs_node_t* simplefs_readdir(fs_node_t* node, u32 index);
+static fs_node_t* simplefs_finddir(fs_node_t* node, char* name);
+
+// Hash FNV-1a de um nome
+static u32 simplefs_hash(const char* name) {
+    u32 hash = 2166136261u;
+    while (*name) {
+        hash ^= (u8)*name++;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+// Compara dois nomes
+static u32 simplefs_name_equal(const char* a, const char* b) {
+    while (*a && *a == *b) {
+        a++;
+        b++;
+    }
+    return *a == *b;
+}
+
+// Comprimento de um nome (0 se passar de SIMPLEFS_NAME_MAX ou tiver '/')
+static u32 simplefs_name_length(const char* name) {
+    u32 length = 0;
+    while (name[length]) {
+        if (name[length] == '/' || length == SIMPLEFS_NAME_MAX) return 0;
+        length++;
+    }
+    return length;
+}
+
+// Inode de um nó deste sistema de arquivos (NULL para outros nós)
+// Nós registrados por outros subsistemas usam impl livremente: só vale o
+// nó que é o vnode do próprio inode
+static simplefs_inode_t* simplefs_inode(fs_node_t* node) {
+    if (!node || node->impl >= inode_count) return NULL;
+    simplefs_inode_t* inode = inodes[node->impl];
+    if (!inode->vnode || &inode->vnode->node != node) return NULL;
+    return inode;
+}
+
+// Cria um inode vazio; retorna o número dele (SIMPLEFS_NO_INODE se faltar memória)
+static u32 simplefs_inode_create(fs_node_type_t type, u32 permissions, u32 parent) {
+    if (inode_count == inode_capacity) {
+        u32 capacity = inode_capacity ? inode_capacity * 2 : 64;
+        simplefs_inode_t** table = (simplefs_inode_t**)krealloc(inodes, capacity * sizeof(simplefs_inode_t*));
+        if (!table) return SIMPLEFS_NO_INODE;
+        inodes = table;
+        inode_capacity = capacity;
+    }
+    
+    simplefs_inode_t* inode = (simplefs_inode_t*)kmalloc(sizeof(simplefs_inode_t));
+    if (!inode) return SIMPLEFS_NO_INODE;
+    inode->type = type;
+    inode->permissions = permissions;
+    inode->parent = parent;
+    inode->size = 0;
+    inode->leaves = NULL;
+    inode->leaf_slots = 0;
+    inode->dir = NULL;
+    inode->name = NULL;
+    inode->vnode = NULL;
+    inode->node = NULL;
+    
+    // Um diretório começa com a tabela de hash vazia
+    if (type == FS_DIRECTORY) {
+        simplefs_dir_t* dir = (simplefs_dir_t*)kmalloc(sizeof(simplefs_dir_t));
+        u32* slots = (u32*)kmalloc(SIMPLEFS_DIR_SLOTS * sizeof(u32));
+        if (!dir || !slots) {
+            if (dir) kfree(dir);
+            if (slots) kfree(slots);
+            kfree(inode);
+            return SIMPLEFS_NO_INODE;
+        }
+        kmemset(slots, 0, SIMPLEFS_DIR_SLOTS * sizeof(u32));
+        dir->entries = NULL;
+        dir->count = 0;
+        dir->capacity = 0;
+        dir->slots = slots;
+        dir->slot_mask = SIMPLEFS_DIR_SLOTS - 1;
+        inode->dir = dir;
+    }
+    
+    inodes[inode_count] = inode;
+    return inode_count++;
+}
+
+// Desfaz a criação do último inode, que não chegou a entrar em um diretório
+static void simplefs_inode_discard(u32 number) {
+    simplefs_inode_t* inode = inodes[number];
+    if (inode->dir) {
+        kfree(inode->dir->slots);
+        kfree(inode->dir);
+    }
+    kfree(inode);
+    inode_count = number;
+}
+
+// Procura um nome em um diretório; retorna o índice da entrada ou -1
+// Uma comparação de hash descarta quase todas as colisões antes de
+// comparar os nomes; a tabela fica no máximo 3/4 cheia
+static int simplefs_dir_find(simplefs_dir_t* dir, const char* name, u32 hash) {
+    u32 slot = hash & dir->slot_mask;
+    while (dir->slots[slot]) {
+        simplefs_dirent_t* entry = &dir->entries[dir->slots[slot] - 1];
+        if (entry->hash == hash && simplefs_name_equal(entry->name, name)) {
+            return (int)(dir->slots[slot] - 1);
+        }
+        slot = (slot + 1) & dir->slot_mask;
+    }
+    return -1;
+}
+
+// Coloca a entrada index na tabela de hash (há posição livre)
+static void simplefs_dir_place(simplefs_dir_t* dir, u32 index) {
+    u32 slot = dir->entries[index].hash & dir->slot_mask;
+    while (dir->slots[slot]) {
+        slot = (slot + 1) & dir->slot_mask;
+    }
+    dir->slots[slot] = index + 1;
+}
+
+// Acrescenta uma entrada a um diretório (o nome ainda não existe nele)
+static u32 simplefs_dir_add(simplefs_dir_t* dir, const char* name, u32 hash, u32 inode) {
+    // Vetor de entradas cheio: dobra
+    if (dir->count == dir->capacity) {
+        u32 capacity = dir->capacity ? dir->capacity * 2 : 8;
+        simplefs_dirent_t* entries = (simplefs_dirent_t*)krealloc(dir->entries, capacity * sizeof(simplefs_dirent_t));
+        if (!entries) return 0;
+        dir->entries = entries;
+        dir->capacity = capacity;
     }
     
-    // Cria o nó raiz
-    fs_root = (fs_node_t*)kmalloc(sizeof(fs_node_t));
-    if (!fs_root) return;
+    // Tabela passaria de 3/4: dobra e recoloca as entradas pelos hashes guardados
+    u32 slot_count = dir->slot_mask + 1;
+    if ((dir->count + 1) * 4 > slot_count * 3) {
+        u32* slots = (u32*)kmalloc(slot_count * 2 * sizeof(u32));
+        if (!slots) return 0;
+        kmemset(slots, 0, slot_count * 2 * sizeof(u32));
+        kfree(dir->slots);
+        dir->slots = slots;
+        dir->slot_mask = slot_count * 2 - 1;
+        for (u32 i = 0; i < dir->count; i++) {
+            simplefs_dir_place(dir, i);
+        }
+    }
     
-    // Inicializa o nó raiz
-    for (int i = 0; i < 127; i++) {
-        fs_root->name[i] = '/';
-        fs_root->name[i+1] = '\0';
+    // Copia o nome
+    u32 length = simplefs_name_length(name);
+    char* copy = (char*)kmalloc(length + 1);
+    if (!copy) return 0;
+    for (u32 i = 0; i <= length; i++) {
+        copy[i] = name[i];
     }
-    fs_root->type = FS_DIRECTORY;
-    fs_root->permissions = 0755; // rwxr-xr-x
-    fs_root->uid = 0;
-    fs_root->gid = 0;
-    fs_root->size = 0;
-    fs_root->inode = 0;
-    fs_root->impl = 0;
+    
+    simplefs_dirent_t* entry = &dir->entries[dir->count];
+    entry->hash = hash;
+    entry->inode = inode;
+    entry->name = copy;
+    inodes[inode]->name = copy;
+    simplefs_dir_place(dir, dir->count);
+    dir->count++;
+    return 1;
+}
+
+// Tira um nó da lista LRU
+static void simplefs_lru_remove(simplefs_vnode_t* vnode) {
+    if (vnode->lru_prev) vnode->lru_prev->lru_next = vnode->lru_next;
+    else lru_head = vnode->lru_next;
+    if (vnode->lru_next) vnode->lru_next->lru_prev = vnode->lru_prev;
+    else lru_tail = vnode->lru_prev;
+    vnode->lru_prev = vnode->lru_next = NULL;
+    lru_count--;
+}
+
+// Libera o nó sem referências usado há mais tempo
+// Retorna 0 se a lista estiver vazia
+static u32 simplefs_lru_evict() {
+    simplefs_vnode_t* vnode = lru_tail;
+    if (!vnode) return 0;
+    simplefs_lru_remove(vnode);
+    inodes[vnode->node.inode]->vnode = NULL;
+    kmem_cache_free(node_cache, vnode);
+    return 1;
+}
+
+// Entrega o nó de um inode, com uma referência nova (simplefs_lock travado)
+// Se o inode já tiver um nó em cache, ele é reaproveitado; nós registrados
+// por outros subsistemas são entregues como estão
+static fs_node_t* simplefs_make_node(u32 number) {
+    simplefs_inode_t* inode = inodes[number];
+    if (inode->node) return inode->node;
+    
+    // Acerto no cache: nenhuma alocação
+    simplefs_vnode_t* vnode = inode->vnode;
+    if (vnode) {
+        if (!vnode->refs) simplefs_lru_remove(vnode);
+        vnode->refs++;
+        return &vnode->node;
+    }
+    
+    // Sem memória, libera os nós sem referências antes de desistir
+    vnode = (simplefs_vnode_t*)kmem_cache_alloc(node_cache);
+    while (!vnode && simplefs_lru_evict()) {
+        vnode = (simplefs_vnode_t*)kmem_cache_alloc(node_cache);
+    }
+    if (!vnode) return NULL;
+    vnode->refs = 1;
+    vnode->lru_prev = vnode->lru_next = NULL;
+    inode->vnode = vnode;
+    
+    // Inicializa o nó
+    fs_node_t* node = &vnode->node;
+    const char* name = inode->name;
+    u32 i;
+    for (i = 0; i < SIMPLEFS_NAME_MAX && name[i]; i++) {
+        node->name[i] = name[i];
+    }
+    node->name[i] = '\0';
+    node->type = inode->type;
+    node->permissions = inode->permissions;
+    node->uid = 0;
+    node->gid = 0;
+    node->size = inode->size;
+    node->inode = number;
+    node->impl = number;
     
     // Configura as funções de operação
-    fs_root->read = NULL;
-    fs_root->write = NULL;
-    fs_root->open = NULL;
-    fs_root->close = NULL;
-    fs_root->readdir = simplefs_readdir;
-    fs_root->finddir = simplefs_finddir;
+    if (inode->type == FS_DIRECTORY) {
+        node->read = NULL;
+        node->write = NULL;
+        node->readdir = simplefs_readdir;
+        node->finddir = simplefs_finddir;
+    } else {
+        node->read = simplefs_read;
+        node->write = simplefs_write;
+        node->readdir = NULL;
+        node->finddir = NULL;
+    }
+    node->open = NULL;
+    node->close = NULL;
+    
+    return node;
+}
+
+// Inicializa o sistema de arquivos
+void fs_init() {
+    // Cria o cache de nós
+    if (!node_cache) {
+        node_cache = kmem_cache_create("fs_node_t", sizeof(simplefs_vnode_t), 4, NULL);
+    }
+    
+    // Cria o inode da raiz (número 0) e o nó raiz
+    u32 flags = spin_lock_irqsave(&simplefs_lock);
+    if (simplefs_inode_create(FS_DIRECTORY, 0755, 0) == 0) { // rwxr-xr-x
+        inodes[0]->name = "/";
+        fs_root = simplefs_make_node(0);
+    }
+    spin_unlock_irqrestore(&simplefs_lock, flags);
+}
+
+// Bloco index de um arquivo (NULL: buraco)
+static u8* simplefs_block(simplefs_inode_t* inode, u32 index) {
+    u32 leaf = index / SIMPLEFS_LEAF_BLOCKS;
+    if (leaf >= inode->leaf_slots || !inode->leaves[leaf]) return NULL;
+    return inode->leaves[leaf][index % SIMPLEFS_LEAF_BLOCKS];
 }
 
 // Lê um arquivo
-u32 simplefs_read(fs_node_t* node, u32 offset, u32 size, u8* buffer) {
+// Blocos nunca escritos (buracos) são lidos como zeros
+static u32 simplefs_read_locked(fs_node_t* node, u32 offset, u32 size, u8* buffer) {
     // Verifica se o nó é válido
-    if (!node || node->type != FS_FILE) return 0;
-    
-    // Obtém o índice do arquivo
-    u32 index = node->impl;
-    if (index >= MAX_FILES || !files[index].data) return 0;
+    simplefs_inode_t* inode = simplefs_inode(node);
+    if (!inode || inode->type != FS_FILE) return 0;
     
     // Verifica os limites
-    if (offset >= files[index].size) return 0;
-    if (offset + size > files[index].size) {
-        size = files[index].size - offset;
+    if (offset >= inode->size) return 0;
+    if (size > inode->size - offset) {
+        size = inode->size - offset;
     }
     
-    // Copia os dados
-    for (u32 i = 0; i < size; i++) {
-        buffer[i] = files[index].data[offset + i];
+    // Copia os dados, um bloco por vez
+    u32 done = 0;
+    while (done < size) {
+        u32 position = offset + done;
+        u32 start = position % SIMPLEFS_BLOCK_SIZE;
+        u32 chunk = SIMPLEFS_BLOCK_SIZE - start;
+        if (chunk > size - done) chunk = size - done;
+        
+        u8* block = simplefs_block(inode, position / SIMPLEFS_BLOCK_SIZE);
+        if (block) {
+            kmemcpy(buffer + done, block + start, chunk);
+        } else {
+            kmemset(buffer + done, 0, chunk);
+        }
+        done += chunk;
     }
     
     return size;
 }
 
+static u32 simplefs_read(fs_node_t* node, u32 offset, u32 size, u8* buffer) {
+    u32 flags = spin_lock_irqsave(&simplefs_lock);
+    u32 done = simplefs_read_locked(node, offset, size, buffer);
+    spin_unlock_irqrestore(&simplefs_lock, flags);
+    return done;
+}
+
+// Posição do bloco index no mapa, criando o que faltar no caminho
+// O mapa tem dois níveis: um buraco sem nenhum bloco escrito não aloca a
+// sua folha, e o vetor de folhas cresce dobrando só até a última usada
+// Retorna NULL se faltar memória
+static u8** simplefs_block_slot(simplefs_inode_t* inode, u32 index) {
+    u32 leaf = index / SIMPLEFS_LEAF_BLOCKS;
+    if (leaf >= inode->leaf_slots) {
+        u32 slots = inode->leaf_slots ? inode->leaf_slots : 4;
+        while (slots <= leaf) {
+            slots *= 2;
+        }
+        u8*** leaves = (u8***)krealloc(inode->leaves, slots * sizeof(u8**));
+        if (!leaves) return NULL;
+        for (u32 i = inode->leaf_slots; i < slots; i++) {
+            leaves[i] = NULL;
+        }
+        inode->leaves = leaves;
+        inode->leaf_slots = slots;
+    }
+    
+    if (!inode->leaves[leaf]) {
+        u8** blocks = (u8**)kmalloc(SIMPLEFS_LEAF_BLOCKS * sizeof(u8*));
+        if (!blocks) return NULL;
+        kmemset(blocks, 0, SIMPLEFS_LEAF_BLOCKS * sizeof(u8*));
+        inode->leaves[leaf] = blocks;
+    }
+    return &inode->leaves[leaf][index % SIMPLEFS_LEAF_BLOCKS];
+}
+
 // Escreve em um arquivo
-u32 simplefs_write(fs_node_t* node, u32 offset, u32 size, u8* buffer) {
+// Só os blocos tocados pela escrita (e as folhas do mapa que os apontam)
+// são alocados: um buraco entre o fim atual e offset não ocupa memória
+static u32 simplefs_write_locked(fs_node_t* node, u32 offset, u32 size, u8* buffer) {
     // Verifica se o nó é válido
-    if (!node || node->type != FS_FILE) return 0;
-    
-    // Obtém o índice do arquivo
-    u32 index = node->impl;
-    if (index >= MAX_FILES) return 0;
-    
-    // Se o arquivo não existe, cria-o
-    if (!files[index].data) {
-        files[index].capacity = offset + size;
-        files[index].data = (u8*)kmalloc(files[index].capacity);
-        if (!files[index].data) return 0;
-        files[index].size = 0;
+    simplefs_inode_t* inode = simplefs_inode(node);
+    if (!inode || inode->type != FS_FILE) return 0;
+    
+    // O tamanho do arquivo cabe em 32 bits
+    if (size > 0xFFFFFFFF - offset) {
+        size = 0xFFFFFFFF - offset;
     }
+    if (!size) return 0;
     
-    // Se o offset + size excede a capacidade, realoca
-    if (offset + size > files[index].capacity) {
-        u32 new_capacity = offset + size;
-        u8* new_data = (u8*)kmalloc(new_capacity);
-        if (!new_data) return 0;
+    // Copia os dados, um bloco por vez
+    u32 done = 0;
+    while (done < size) {
+        u32 position = offset + done;
+        u32 start = position % SIMPLEFS_BLOCK_SIZE;
+        u32 chunk = SIMPLEFS_BLOCK_SIZE - start;
+        if (chunk > size - done) chunk = size - done;
         
-        // Copia os dados existentes
-        for (u32 i = 0; i < files[index].size; i++) {
-            new_data[i] = files[index].data[i];
+        // Bloco novo: começa zerado (a parte não escrita é lida como zeros)
+        u8** slot = simplefs_block_slot(inode, position / SIMPLEFS_BLOCK_SIZE);
+        if (!slot) break;
+        if (!*slot) {
+            u8* block = (u8*)kmalloc(SIMPLEFS_BLOCK_SIZE);
+            if (!block) break;
+            kmemset(block, 0, SIMPLEFS_BLOCK_SIZE);
+            *slot = block;
         }
         
-        // Libera o buffer antigo
-        kfree(files[index].data);
-        
-        // Atualiza o arquivo
-        files[index].data = new_data;
-        files[index].capacity = new_capacity;
-    }
-    
-    // Copia os dados
-    for (u32 i = 0; i < size; i++) {
-        files[index].data[offset + i] = buffer[i];
+        kmemcpy(*slot + start, buffer + done, chunk);
+        done += chunk;
     }
     
-    // Atualiza o tamanho se necessário
-    if (offset + size > files[index].size) {
-        files[index].size = offset + size;
-        node->size = files[index].size;
+    // Atualiza o tamanho se necessário (sem memória, só o que foi escrito conta)
+    if (done && offset + done > inode->size) {
+        inode->size = offset + done;
     }
+    node->size = inode->size;
     
-    return size;
+    return done;
 }
 
-// Abre um arquivo
-void simplefs_open(fs_node_t* node) {
-    // Nada a fazer nesta implementação simples
+static u32 simplefs_write(fs_node_t* node, u32 offset, u32 size, u8* buffer) {
+    u32 flags = spin_lock_irqsave(&simplefs_lock);
+    u32 done = simplefs_write_locked(node, offset, size, buffer);
+    spin_unlock_irqrestore(&simplefs_lock, flags);
+    return done;
 }
 
-// Fecha um arquivo
-void simplefs_close(fs_node_t* node) {
-    // Nada a fazer nesta implementação simples
-}
-
-// Lê um diretório
-fs_node_t* simplefs_readdir(fs_node_t* node, u32 index) {
+// Lê a entrada index de um diretório, na ordem de criação
+static fs_node_t* simplefs_readdir_locked(fs_node_t* node, u32 index) {
     // Verifica se o nó é um diretório
-    if (!node || node->type != FS_DIRECTORY) return NULL;
+    simplefs_inode_t* inode = simplefs_inode(node);
+    if (!inode || !inode->dir) return NULL;
     
     // Verifica se o índice é válido
-    if (index >= file_count) return NULL;
+    if (index >= inode->dir->count) return NULL;
     
-    // Cria um nó para o arquivo
-    fs_node_t* file_node = (fs_node_t*)kmalloc(sizeof(fs_node_t));
-    if (!file_node) return NULL;
+    return simplefs_make_node(inode->dir->entries[index].inode);
+}
+
+static fs_node_t* simplefs_readdir(fs_node_t* node, u32 index) {
+    u32 flags = spin_lock_irqsave(&simplefs_lock);
+    fs_node_t* entry = simplefs_readdir_locked(node, index);
+    spin_unlock_irqrestore(&simplefs_lock, flags);
+    return entry;
+}
+
+// Encontra um nome em um diretório, em O(1)
+// "." e ".." levam ao próprio diretório e ao pai
+static fs_node_t* simplefs_finddir_locked(fs_node_t* node, char* name) {
+    // Verifica se o nó é um diretório
+    simplefs_inode_t* inode = simplefs_inode(node);
+    if (!inode || !inode->dir || !name) return NULL;
     
-    // Inicializa o nó
-    for (int i = 0; i < 127 && files[index].name[i]; i++) {
-        file_node->name[i] = files[index].name[i];
-        file_node->name[i+1] = '\0';
+    if (name[0] == '.' && !name[1]) {
+        return simplefs_make_node(node->impl);
+    }
+    if (name[0] == '.' && name[1] == '.' && !name[2]) {
+        return simplefs_make_node(inode->parent);
     }
-    file_node->type = FS_FILE;
-    file_node->permissions = 0644; // rw-r--r--
-    file_node->uid = 0;
-    file_node->gid = 0;
-    file_node->size = files[index].size;
-    file_node->inode = index + 1;
-    file_node->impl = index;
     
-    // Configura as funções de operação
-    file_node->read = simplefs_read;
-    file_node->write = simplefs_write;
-    file_node->open = simplefs_open;
-    file_node->close = simplefs_close;
-    file_node->readdir = NULL;
-    file_node->finddir = NULL;
+    int index = simplefs_dir_find(inode->dir, name, simplefs_hash(name));
+    if (index < 0) return NULL;
     
-    return file_node;
+    return simplefs_make_node(inode->dir->entries[index].inode);
 }
 
-// Encontra um arquivo em um diretório
-fs_node_t* simplefs_finddir(fs_node_t* node, char* name) {
-    // Verifica se o nó é um diretório
-    if (!node || node->type != FS_DIRECTORY) return NULL;
-    
-    // Procura o arquivo pelo nome
-    for (u32 i = 0; i < file_count; i++) {
-        // Compara os nomes
-        int j;
-        for (j = 0; name[j] && files[i].name[j]; j++) {
-            if (name[j] != files[i].name[j]) break;
-        }
-        
-        // Se os nomes são iguais
-        if (!name[j] && !files[i].name[j]) {
-            // Cria um nó para o arquivo (mesmo código de readdir)
-            fs_node_t* file_node = (fs_node_t*)kmalloc(sizeof(fs_node_t));
-            if (!file_node) return NULL;
-            
-            // Inicializa o nó
-            for (int k = 0; k < 127 && files[i].name[k]; k++) {
-                file_node->name[k] = files[i].name[k];
-                file_node->name[k+1] = '\0';
-            }
-            file_node->type = FS_FILE;
-            file_node->permissions = 0644; // rw-r--r--
-            file_node->uid = 0;
-            file_node->gid = 0;
-            file_node->size = files[i].size;
-            file_node->inode = i + 1;
-            file_node->impl = i;
-            
-            // Configura as funções de operação
-            file_node->read = simplefs_read;
-            file_node->write = simplefs_write;
-            file_node->open = simplefs_open;
-            file_node->close = simplefs_close;
-            file_node->readdir = NULL;
-            file_node->finddir = NULL;
-            
-            return file_node;
-        }
-    }
-    
-    return NULL;
+static fs_node_t* simplefs_finddir(fs_node_t* node, char* name) {
+    u32 flags = spin_lock_irqsave(&simplefs_lock);
+    fs_node_t* entry = simplefs_finddir_locked(node, name);
+    spin_unlock_irqrestore(&simplefs_lock, flags);
+    return entry;
 }
 
-// Cria um novo arquivo
-fs_node_t* simplefs_create(const char* name) {
-    // Verifica se já existe um arquivo com esse nome
-    for (u32 i = 0; i < file_count; i++) {
-        // Compara os nomes
-        int j;
-        for (j = 0; name[j] && files[i].name[j]; j++) {
-            if (name[j] != files[i].name[j]) break;
-        }
-        
-        // Se os nomes são iguais
-        if (!name[j] && !files[i].name[j]) {
-            return NULL; // Arquivo já existe
-        }
-    }
+// Cria um arquivo ou diretório
+static fs_node_t* fs_create_locked(fs_node_t* dir, const char* name, fs_node_type_t type) {
+    simplefs_inode_t* parent = simplefs_inode(dir);
+    if (!parent || !parent->dir || !name) return NULL;
+    if (type != FS_FILE && type != FS_DIRECTORY) return NULL;
     
-    // Verifica se há espaço para um novo arquivo
-    if (file_count >= MAX_FILES) return NULL;
+    // Nomes vazios, longos demais, com '/' ou reservados não são aceitos
+    if (!simplefs_name_length(name)) return NULL;
+    if (name[0] == '.' && (!name[1] || (name[1] == '.' && !name[2]))) return NULL;
     
-    // Cria o novo arquivo
-    u32 index = file_count++;
+    // Verifica se já existe uma entrada com esse nome
+    u32 hash = simplefs_hash(name);
+    if (simplefs_dir_find(parent->dir, name, hash) >= 0) return NULL;
     
-    // Copia o nome
-    for (int i = 0; i < 127 && name[i]; i++) {
-        files[index].name[i] = name[i];
-        files[index].name[i+1] = '\0';
+    // Cria o inode e a entrada no diretório
+    u32 permissions = type == FS_DIRECTORY ? 0755 : 0644; // rwxr-xr-x, rw-r--r--
+    u32 number = simplefs_inode_create(type, permissions, dir->impl);
+    if (number == SIMPLEFS_NO_INODE) return NULL;
+    if (!simplefs_dir_add(parent->dir, name, hash, number)) {
+        simplefs_inode_discard(number);
+        return NULL;
     }
     
-    // Inicializa o arquivo
-    files[index].data = NULL;
-    files[index].size = 0;
-    files[index].capacity = 0;
+    return simplefs_make_node(number);
+}
+
+fs_node_t* fs_create(fs_node_t* dir, const char* name, fs_node_type_t type) {
+    u32 flags = spin_lock_irqsave(&simplefs_lock);
+    fs_node_t* node = fs_create_locked(dir, name, type);
+    spin_unlock_irqrestore(&simplefs_lock, flags);
+    return node;
+}
+
+// Acrescenta um nó à raiz
+static u32 fs_register_node_locked(fs_node_t* node) {
+    simplefs_inode_t* root = simplefs_inode(fs_root);
+    if (!root || !node || !simplefs_name_length(node->name)) return 0;
+    
+    u32 hash = simplefs_hash(node->name);
+    if (simplefs_dir_find(root->dir, node->name, hash) >= 0) return 0;
     
-    // Cria um nó para o arquivo
-    fs_node_t* file_node = (fs_node_t*)kmalloc(sizeof(fs_node_t));
-    if (!file_node) {
-        file_count--; // Reverte a criação
-        return NULL;
+    u32 number = simplefs_inode_create(node->type, node->permissions, 0);
+    if (number == SIMPLEFS_NO_INODE) return 0;
+    inodes[number]->node = node;
+    if (!simplefs_dir_add(root->dir, node->name, hash, number)) {
+        simplefs_inode_discard(number);
+        return 0;
     }
     
-    // Inicializa o nó
-    for (int i = 0; i < 127 && name[i]; i++) {
-        file_node->name[i] = name[i];
-        file_node->name[i+1] = '\0';
+    node->inode = number;
+    return 1;
+}
+
+u32 fs_register_node(fs_node_t* node) {
+    u32 flags = spin_lock_irqsave(&simplefs_lock);
+    u32 ok = fs_register_node_locked(node);
+    spin_unlock_irqrestore(&simplefs_lock, flags);
+    return ok;
+}
+
+// Devolve a referência a um nó obtido de readdir, finddir, fs_create ou fs_lookup_path
+// Sem referências, o nó vai para o início da lista LRU; passando de
+// SIMPLEFS_LRU_MAX nós, o mais antigo é liberado
+void fs_release(fs_node_t* node) {
+    // A raiz fica sempre em cache
+    if (!node || node == fs_root) return;
+    
+    u32 flags = spin_lock_irqsave(&simplefs_lock);
+    
+    // Nós registrados não são contados (node->inode é o inode; impl é do seu dono)
+    simplefs_inode_t* inode = node->inode < inode_count ? inodes[node->inode] : NULL;
+    simplefs_vnode_t* vnode = inode ? inode->vnode : NULL;
+    if (vnode && &vnode->node == node && vnode->refs && !--vnode->refs) {
+        vnode->lru_next = lru_head;
+        if (lru_head) lru_head->lru_prev = vnode;
+        else lru_tail = vnode;
+        lru_head = vnode;
+        lru_count++;
+        if (lru_count > SIMPLEFS_LRU_MAX) {
+            simplefs_lru_evict();
+        }
     }
-    file_node->type = FS_FILE;
-    file_node->permissions = 0644; // rw-r--r--
-    file_node->uid = 0;
-    file_node->gid = 0;
-    file_node->size = 0;
-    file_node->inode = index + 1;
-    file_node->impl = index;
     
-    // Configura as funções de operação
-    file_node->read = simplefs_read;
-    file_node->write = simplefs_write;
-    file_node->open = simplefs_open;
-    file_node->close = simplefs_close;
-    file_node->readdir = NULL;
-    file_node->finddir = NULL;
+    spin_unlock_irqrestore(&simplefs_lock, flags);
+}
+
+// Resolve um caminho absoluto
+// Cada componente é uma chamada a fs_finddir; os nós intermediários são devolvidos
+fs_node_t* fs_lookup_path(const char* path) {
+    if (!path || *path != '/' || !fs_root) return NULL;
     
-    return file_node;
+    fs_node_t* node = fs_root;
+    char component[SIMPLEFS_NAME_MAX + 1];
+    while (1) {
+        // Pula as barras; o fim do caminho encerra a busca
+        while (*path == '/') path++;
+        if (!*path) return node;
+        
+        u32 length = 0;
+        while (path[length] && path[length] != '/') {
+            if (length == SIMPLEFS_NAME_MAX) {
+                fs_release(node);
+                return NULL;
+            }
+            component[length] = path[length];
+            length++;
+        }
+        component[length] = '\0';
+        path += length;
+        
+        fs_node_t* next = fs_finddir(node, component);
+        fs_release(node);
+        if (!next) return NULL;
+        node = next;
+    }
 }
 
 // Funções de wrapper para o sistema de arquivos
@@ -298,9 +651,11 @@ void fs_open(fs_node_t* node) {
     node->open(node);
 }
 
+// Fecha o nó e devolve a referência de quem o obteve
 void fs_close(fs_node_t* node) {
-    if (!node || !node->close) return;
-    node->close(node);
+    if (!node) return;
+    if (node->close) node->close(node);
+    fs_release(node);
 }
 
 fs_node_t* fs_readdir(fs_node_t* node, u32 index) {
@@ -0,0 +1,43 @@
+#ifndef APIC_H
+#define APIC_H
+
+#include <stdint.h>
+
+// Definição de tipos
+typedef uint8_t u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef uint64_t u64;
+
+// Endereço padrão dos registradores do APIC local
+#define LAPIC_DEFAULT_BASE 0xFEE00000
+
+// Mapeia os registradores do APIC local e habilita o da CPU atual
+void lapic_init(u32 base);
+
+// Habilita o APIC local da CPU atual (CPUs secundárias)
+void lapic_init_cpu();
+
+// ID do APIC local da CPU atual
+u32 lapic_get_id();
+
+// Sinaliza o fim do tratamento de uma interrupção entregue pelo APIC local
+void lapic_eoi();
+
+// Envia INIT e os dois SIPIs que fazem uma AP começar a executar em
+// modo real no endereço físico trampoline (alinhado a 4KB, abaixo de 1MB)
+void lapic_start_ap(u32 apic_id, u32 trampoline);
+
+// Envia uma interrupção (IPI) a outra CPU
+void lapic_send_ipi(u32 apic_id, u8 vector);
+
+// Mede a frequência do timer do APIC local contra o PIT (BSP)
+void lapic_timer_calibrate();
+
+// Liga o timer do APIC local no modo periódico, com frequency ticks por segundo
+void lapic_timer_start(u32 frequency);
+
+// Para o timer do APIC local
+void lapic_timer_stop();
+
+#endif // APIC_H
@@ -0,0 +1,22 @@
+#ifndef ATA_H
+#define ATA_H
+
+#include "block.h"
+
+// Procura os discos dos dois canais IDE (portas legadas, IRQ14 e IRQ15) e
+// registra cada um como dispositivo de blocos: hda e hdb no canal primário,
+// hdc e hdd no secundário
+// Usa DMA (bus master) quando a controladora PCI e o disco permitem; senão,
+// PIO com vários setores por interrupção (READ/WRITE MULTIPLE)
+// Chamada depois de workqueue_init (comandos que falham ao começar terminam
+// pela fila de trabalho); as esperas da identificação contam voltas, não ticks
+void ata_init();
+
+// Liga ou desliga o DMA de um disco; retorna 0 se ele não suportar DMA
+// Vale a partir do próximo comando
+u32 ata_set_dma(block_device_t* device, u32 enable);
+
+// 1 se o disco está usando DMA
+u32 ata_get_dma(block_device_t* device);
+
+#endif // ATA_H
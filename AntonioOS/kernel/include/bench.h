@@ -0,0 +1,28 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+// Benchmarks executados no boot quando o kernel é compilado com
+// make BENCH=1 (-DKERNEL_BENCH); os resultados vão para a tela
+
+// Ciclos por troca de contexto: rotina antiga, rotina atual e o custo do
+// fxsave/fxrstor que a troca preguiçosa da FPU evita
+void bench_context_switch();
+
+// Ciclos por ida e volta de uma mensagem entre dois processos: só a parte
+// pequena, com 1 página movida e com 16 páginas movidas
+void bench_ipc();
+
+// Carga de tempo real: conjuntos de tarefas EDF com utilização conhecida
+// contra processos Round Robin, conferindo que nenhum prazo é perdido, e o
+// controle de admissão (tarefas de 50% até a primeira recusa)
+void bench_edf();
+
+// Vazão de kmemcpy e kmemset de 16 bytes a 1MB, em bytes por ciclo, com o
+// laço byte a byte, rep movsd/stosd e SSE2
+void bench_string();
+
+// Disco hda: 1MB em pedidos de 4KB fora de ordem, um por vez e em lote
+// (fundidos e ordenados pelo elevador), com PIO e com DMA; confere a leitura
+void bench_block();
+
+#endif // BENCH_H
@@ -0,0 +1,103 @@
+#ifndef BLOCK_H
+#define BLOCK_H
+
+#include "process.h"
+#include "spinlock.h"
+#include "wait.h"
+
+// Camada de blocos: cada disco é um block_device_t com uma fila de pedidos
+// assíncronos; pedidos vizinhos são fundidos em um só comando e o elevador
+// (C-LOOK) os envia ao driver em ordem crescente de setor
+#define BLOCK_SECTOR_SIZE 512
+
+// Estado de um pedido terminado
+#define BLOCK_OK 0
+#define BLOCK_ERROR 1
+
+// Pedido de leitura ou escrita de setores inteiros
+// O buffer fica no espaço do kernel (heap ou dados estáticos), alinhado a 2 bytes
+typedef struct block_request {
+    u32 lba;                      // Primeiro setor
+    u32 count;                    // Número de setores
+    void* buffer;                 // count * BLOCK_SECTOR_SIZE bytes
+    u8 write;                     // 1: escrita, 0: leitura
+    volatile u8 done;             // 1 depois do término (status válido)
+    u8 status;                    // BLOCK_OK ou BLOCK_ERROR
+    void (*complete)(struct block_request* request); // Chamada no término (manipulador de interrupção), pode ser NULL
+    void* private;                // Livre para quem submeteu
+
+    // Usados pela camada de blocos
+    u32 seq;                      // Ordem de submissão (a menor entre os fundidos)
+    u32 total;                    // Setores deste pedido e dos fundidos a ele (só no primeiro)
+    struct block_request* merged; // Próximo pedido do mesmo comando, em ordem de setor
+    struct block_request* merged_tail; // Último pedido fundido (só no primeiro)
+    struct block_request* queue_next; // Próximo na fila, em ordem de setor
+    struct block_request* queue_prev; // Anterior na fila
+} block_request_t;
+
+// Dispositivo de blocos
+typedef struct block_device {
+    char name[8];                 // Nome do dispositivo ("hda")
+    u32 sector_count;             // Setores do dispositivo
+    u32 max_sectors;              // Setores por comando (limite da fusão)
+    // Driver: inicia o comando de um pedido e dos fundidos a ele e chama
+    // block_complete ao terminar; retorna 0 se o dispositivo estiver ocupado
+    // (a fila tenta de novo no próximo block_run_queue)
+    u32 (*start)(struct block_device* device, block_request_t* request);
+    void* driver_data;            // Estado do driver
+
+    spinlock_t lock;              // Protege a fila e o pedido em andamento
+    block_request_t* queue;       // Pedidos esperando, em ordem de setor
+    block_request_t* active;      // Pedido em andamento no dispositivo
+    u32 position;                 // Setor seguinte ao último comando (C-LOOK)
+    u32 plugged;                  // > 0: os pedidos se acumulam sem ir ao driver
+    u32 next_seq;                 // Número de submissão do próximo pedido
+    wait_queue_t wait;            // Processos esperando algum pedido terminar
+
+    u32 submitted;                // Pedidos recebidos
+    u32 merges;                   // Pedidos fundidos a outro
+    u32 dispatches;               // Comandos enviados ao driver
+    u32 errors;                   // Comandos que falharam
+    struct block_device* next;    // Próximo dispositivo registrado
+} block_device_t;
+
+// Registra um dispositivo preenchido pelo driver (name, sector_count,
+// max_sectors, start, driver_data); os demais campos são inicializados aqui
+void block_register(block_device_t* device);
+
+// Procura um dispositivo pelo nome (NULL se não existir)
+block_device_t* block_find(const char* name);
+
+// Primeiro dispositivo registrado (os demais seguem por next)
+block_device_t* block_get_devices();
+
+// Prepara um pedido
+void block_request_init(block_request_t* request, u32 lba, u32 count, void* buffer, u8 write);
+
+// Coloca um pedido na fila e retorna sem esperar; retorna 0 se ele não couber
+// no dispositivo ou passar de max_sectors
+// As páginas do buffer são tocadas aqui, para que o driver as encontre mapeadas
+u32 block_submit(block_device_t* device, block_request_t* request);
+
+// Enquanto houver um block_plug sem o block_unplug correspondente, os pedidos
+// só se acumulam (e se fundem); o último block_unplug os envia ao driver
+void block_plug(block_device_t* device);
+void block_unplug(block_device_t* device);
+
+// Bloqueia até o pedido terminar e retorna o seu status
+// Não pode ser usada pelo processo idle
+u32 block_wait(block_device_t* device, block_request_t* request);
+
+// Leitura e escrita síncronas de count setores (divididas em comandos de até
+// max_sectors, enviados de uma vez); retornam 1 se tudo deu certo
+u32 block_read(block_device_t* device, u32 lba, u32 count, void* buffer);
+u32 block_write(block_device_t* device, u32 lba, u32 count, void* buffer);
+
+// Chamada pelo driver quando o pedido em andamento termina (pode ser em um
+// manipulador de interrupção); envia o próximo e completa os pedidos do comando
+void block_complete(block_device_t* device, u8 status);
+
+// Envia o próximo pedido da fila se o dispositivo estiver livre
+void block_run_queue(block_device_t* device);
+
+#endif // BLOCK_H
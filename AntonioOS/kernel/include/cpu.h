@@ -0,0 +1,169 @@
+#ifndef CPU_H
+#define CPU_H
+
+#include <stdint.h>
+
+// Definição de tipos
+typedef uint8_t u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef uint64_t u64;
+
+// Retorna o índice do bit menos significativo ligado (valor deve ser != 0)
+static inline u32 cpu_bsf(u32 value) {
+    u32 index;
+    asm("bsf %1, %0" : "=r"(index) : "rm"(value));
+    return index;
+}
+
+// Retorna o índice do bit mais significativo ligado (valor deve ser != 0)
+static inline u32 cpu_bsr(u32 value) {
+    u32 index;
+    asm("bsr %1, %0" : "=r"(index) : "rm"(value));
+    return index;
+}
+
+// Troca *address por value atomicamente e devolve o valor anterior
+// (xchg com memória tem lock implícito)
+static inline u32 cpu_xchg(volatile u32* address, u32 value) {
+    asm volatile("xchg %0, %1" : "+r"(value), "+m"(*address) : : "memory");
+    return value;
+}
+
+// Grava value em *address se ele ainda valer expected (lock cmpxchg)
+// Devolve o valor encontrado: igual a expected se a troca aconteceu
+static inline u32 cpu_cmpxchg(volatile u32* address, u32 expected, u32 value) {
+    u32 previous;
+    asm volatile("lock cmpxchg %2, %1"
+                 : "=a"(previous), "+m"(*address)
+                 : "r"(value), "0"(expected)
+                 : "memory");
+    return previous;
+}
+
+// Soma value a *address atomicamente e devolve o valor anterior (lock xadd)
+static inline u32 cpu_xadd(volatile u32* address, u32 value) {
+    asm volatile("lock xadd %0, %1" : "+r"(value), "+m"(*address) : : "memory");
+    return value;
+}
+
+// Dica para laços de espera ativa (libera recursos do outro hyperthread)
+static inline void cpu_pause() {
+    asm volatile("pause" : : : "memory");
+}
+
+#ifdef HOST_BENCH
+// Benchmark no espaço de usuário do host (make bench-host): não há paginação
+// nem interrupções, então as instruções privilegiadas não fazem nada
+static inline void cpu_invlpg(void* address) { (void)address; }
+static inline u32 cpu_irq_save() { return 0; }
+static inline void cpu_irq_restore(u32 flags) { (void)flags; }
+static inline u32 cpu_read_cr0() { return 0; }
+static inline void cpu_write_cr0(u32 value) { (void)value; }
+static inline u32 cpu_read_cr2() { return 0; }
+static inline u32 cpu_read_cr3() { return 0; }
+static inline void cpu_write_cr3(u32 value) { (void)value; }
+static inline u32 cpu_read_cr4() { return 0; }
+static inline void cpu_write_cr4(u32 value) { (void)value; }
+static inline void cpu_halt() { __builtin_trap(); }
+#else
+// Invalida a entrada do TLB de uma página
+static inline void cpu_invlpg(void* address) {
+    asm volatile("invlpg (%0)" : : "r"(address) : "memory");
+}
+
+// Desliga as interrupções e devolve o EFLAGS anterior
+static inline u32 cpu_irq_save() {
+    u32 flags;
+    asm volatile("pushf; pop %0; cli" : "=r"(flags) : : "memory");
+    return flags;
+}
+
+// Restaura o estado das interrupções salvo por cpu_irq_save
+static inline void cpu_irq_restore(u32 flags) {
+    asm volatile("push %0; popf" : : "r"(flags) : "memory", "cc");
+}
+
+// Registradores de controle
+static inline u32 cpu_read_cr0() {
+    u32 value;
+    asm volatile("mov %%cr0, %0" : "=r"(value));
+    return value;
+}
+
+static inline void cpu_write_cr0(u32 value) {
+    asm volatile("mov %0, %%cr0" : : "r"(value) : "memory");
+}
+
+static inline u32 cpu_read_cr2() {
+    u32 value;
+    asm volatile("mov %%cr2, %0" : "=r"(value));
+    return value;
+}
+
+static inline u32 cpu_read_cr3() {
+    u32 value;
+    asm volatile("mov %%cr3, %0" : "=r"(value));
+    return value;
+}
+
+static inline void cpu_write_cr3(u32 value) {
+    asm volatile("mov %0, %%cr3" : : "r"(value) : "memory");
+}
+
+static inline u32 cpu_read_cr4() {
+    u32 value;
+    asm volatile("mov %%cr4, %0" : "=r"(value));
+    return value;
+}
+
+static inline void cpu_write_cr4(u32 value) {
+    asm volatile("mov %0, %%cr4" : : "r"(value) : "memory");
+}
+
+// Para a CPU de vez (erro fatal)
+static inline void cpu_halt() {
+    while (1) {
+        asm volatile("cli; hlt");
+    }
+}
+#endif
+
+// Bits de CR0
+#define CR0_MP 0x2                    // wait/fwait respeitam CR0.TS
+#define CR0_EM 0x4                    // Sem FPU (instruções x87 geram #NM)
+#define CR0_TS 0x8                    // Tarefa trocada: a próxima instrução de FPU gera #NM
+#define CR0_WP 0x10000                // Páginas somente leitura valem também no anel 0
+#define CR0_PG 0x80000000             // Paginação
+
+// Bits de CR4
+#define CR4_PSE 0x10                  // Páginas de 4MB
+#define CR4_PGE 0x80                  // Páginas globais
+#define CR4_OSFXSR 0x200              // fxsave/fxrstor e instruções SSE
+#define CR4_OSXMMEXCPT 0x400          // Exceções SIMD (#XM)
+
+// Contador de ciclos desde o reset
+static inline u64 cpu_rdtsc() {
+    u32 low, high;
+    asm volatile("rdtsc" : "=a"(low), "=d"(high));
+    return ((u64)high << 32) | low;
+}
+
+// Limpa CR0.TS (FPU liberada para o processo atual)
+static inline void cpu_clts() {
+    asm volatile("clts");
+}
+
+// Executa a instrução CPUID
+static inline void cpu_cpuid(u32 leaf, u32* eax, u32* ebx, u32* ecx, u32* edx) {
+    asm volatile("cpuid" : "=a"(*eax), "=b"(*ebx), "=c"(*ecx), "=d"(*edx) : "a"(leaf), "c"(0));
+}
+
+// Bits de CPUID.1:EDX
+#define CPUID_EDX_PSE (1 << 3)
+#define CPUID_EDX_PGE (1 << 13)
+#define CPUID_EDX_FXSR (1 << 24)
+#define CPUID_EDX_SSE (1 << 25)
+#define CPUID_EDX_SSE2 (1 << 26)
+
+#endif // CPU_H
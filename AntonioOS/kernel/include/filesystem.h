@@ -43,6 +43,9 @@ typedef struct fs_node {
 void fs_init();
 
 // Funções de operação de arquivos
+// Os nós entregues por fs_readdir, fs_finddir, fs_create e fs_lookup_path
+// são compartilhados (um por inode) e trazem uma referência, devolvida
+// por fs_close
 u32 fs_read(fs_node_t* node, u32 offset, u32 size, u8* buffer);
 u32 fs_write(fs_node_t* node, u32 offset, u32 size, u8* buffer);
 void fs_open(fs_node_t* node);
@@ -50,6 +53,23 @@ void fs_close(fs_node_t* node);
 fs_node_t* fs_readdir(fs_node_t* node, u32 index);
 fs_node_t* fs_finddir(fs_node_t* node, char* name);
 
+// Cria um arquivo (FS_FILE) ou diretório (FS_DIRECTORY) em dir
+// Retorna NULL se o nome já existir, for inválido ou faltar memória
+fs_node_t* fs_create(fs_node_t* dir, const char* name, fs_node_type_t type);
+
+// Resolve um caminho absoluto ("/a/b/c"), um fs_finddir por componente
+// (O(1) em cada diretório, qualquer que seja o número de entradas)
+fs_node_t* fs_lookup_path(const char* path);
+
+// Devolve a referência a um nó sem fechá-lo (ex: diretório só atravessado)
+// O nó sem referências continua em cache (os 128 mais recentes)
+void fs_release(fs_node_t* node);
+
+// Acrescenta à raiz um nó mantido por outro subsistema (ex: /schedstat)
+// O nó não é copiado: readdir e finddir devolvem o próprio nó
+// Retorna 0 se não houver mais espaço
+u32 fs_register_node(fs_node_t* node);
+
 // Sistema de arquivos raiz
 extern fs_node_t* fs_root;
 
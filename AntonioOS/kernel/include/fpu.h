@@ -0,0 +1,32 @@
+#ifndef FPU_H
+#define FPU_H
+
+#include "process.h"
+
+// Tamanho da área salva por fxsave (também comporta os 108 bytes do fnsave)
+#define FPU_STATE_SIZE 512
+
+// Configura a FPU/SSE e o tratamento preguiçoso do seu estado (#NM)
+void fpu_init();
+
+// Configura a FPU/SSE da CPU atual (chamada por cada AP ao partir)
+void fpu_init_cpu();
+
+// Chamado antes de cada troca de contexto: liga CR0.TS, a menos que o
+// próximo processo já seja o dono do estado carregado na FPU
+void fpu_switch(process_t* next);
+
+// Libera a área de estado de um processo que está terminando
+void fpu_release(process_t* process);
+
+// Libera os registradores SSE para o próprio kernel (kmemcpy/kmemset)
+// O estado do dono atual é salvo; as interrupções ficam desligadas até
+// fpu_kernel_end, que recebe o valor devolvido aqui
+// Uma falha de página dentro da seção pode abrir outra (zerar ou copiar um
+// frame): até FPU_KERNEL_NEST níveis, cada um preserva os registradores do
+// anterior
+#define FPU_KERNEL_NEST 2
+u32 fpu_kernel_begin();
+void fpu_kernel_end(u32 flags);
+
+#endif // FPU_H
@@ -0,0 +1,24 @@
+#ifndef GDT_H
+#define GDT_H
+
+#include "smp.h"
+
+// Seletores do kernel
+#define GDT_KERNEL_CODE 0x08
+#define GDT_KERNEL_DATA 0x10
+
+// Um descritor de dados por CPU, com base no seu cpu_t (carregado em %gs)
+#define GDT_CPU_FIRST 3
+#define GDT_ENTRIES (GDT_CPU_FIRST + SMP_MAX_CPUS)
+#define GDT_CPU_SELECTOR(id) ((GDT_CPU_FIRST + (id)) * 8)
+
+// Monta a GDT e a carrega na BSP
+void gdt_init();
+
+// Carrega a GDT já montada (CPUs secundárias)
+void gdt_load();
+
+// Configura um descritor da GDT
+void gdt_set_gate(int num, u32 base, u32 limit, u8 access, u8 gran);
+
+#endif // GDT_H
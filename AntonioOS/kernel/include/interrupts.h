@@ -0,0 +1,56 @@
+#ifndef INTERRUPTS_H
+#define INTERRUPTS_H
+
+#include <stdint.h>
+
+// Definição de tipos
+typedef uint8_t u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef uint64_t u64;
+
+// Vetores das exceções e das IRQs remapeadas pelo PIC
+#define INT_DEVICE_NOT_AVAILABLE 7
+#define INT_PAGE_FAULT 14
+#define IRQ_BASE 0x20
+#define IRQ_COUNT 16
+#define IRQ_TIMER 0
+#define IRQ_ATA_PRIMARY 14
+#define IRQ_ATA_SECONDARY 15
+
+// Vetores entregues pelo APIC local (não passam pelo PIC)
+#define INT_APIC_BASE 0x30
+#define INT_APIC_TIMER 0x30           // Timer do APIC local (quantum das APs)
+#define INT_APIC_RESCHEDULE 0x31      // IPI: acorda uma CPU ociosa
+#define INT_APIC_SPURIOUS 0x3F        // Interrupção espúria (sem EOI)
+#define INT_STUB_COUNT 0x40           // Vetores com stub em interrupts.asm
+
+// Estado salvo pelos stubs de interrupção (kernel/arch/interrupts.asm)
+typedef struct {
+    u32 edi, esi, ebp, esp, ebx, edx, ecx, eax; // Salvos por pusha
+    u32 int_no, err_code;                       // Vetor e código de erro
+    u32 eip, cs, eflags;                        // Empilhados pela CPU
+} interrupt_frame_t;
+
+// Manipulador de interrupção
+typedef void (*interrupt_handler_t)(interrupt_frame_t* frame);
+
+// Registra o manipulador de um vetor
+void interrupt_register_handler(u8 vector, interrupt_handler_t handler);
+
+// Chamado pelos stubs em assembly
+void interrupt_dispatch(interrupt_frame_t* frame);
+
+// Configura uma entrada da IDT
+void idt_set_gate(u8 num, u32 base, u16 sel, u8 flags);
+
+// Carrega a IDT já configurada (CPUs secundárias)
+void idt_reload();
+
+// Libera uma IRQ no PIC (todas começam mascaradas, exceto o teclado)
+void pic_unmask_irq(u8 irq);
+
+// Sinaliza o fim do tratamento de uma IRQ ao PIC
+void pic_send_eoi(u8 irq);
+
+#endif // INTERRUPTS_H
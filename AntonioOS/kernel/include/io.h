@@ -0,0 +1,53 @@
+#ifndef IO_H
+#define IO_H
+
+#include <stdint.h>
+
+// Definição de tipos
+typedef uint8_t u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef uint64_t u64;
+
+// Funções de E/S
+static inline void outb(u16 port, u8 value) {
+    asm volatile ("outb %0, %1" : : "a"(value), "Nd"(port));
+}
+
+static inline u8 inb(u16 port) {
+    u8 ret;
+    asm volatile ("inb %1, %0" : "=a"(ret) : "Nd"(port));
+    return ret;
+}
+
+static inline void outw(u16 port, u16 value) {
+    asm volatile ("outw %0, %1" : : "a"(value), "Nd"(port));
+}
+
+static inline u16 inw(u16 port) {
+    u16 ret;
+    asm volatile ("inw %1, %0" : "=a"(ret) : "Nd"(port));
+    return ret;
+}
+
+static inline void outl(u16 port, u32 value) {
+    asm volatile ("outl %0, %1" : : "a"(value), "Nd"(port));
+}
+
+static inline u32 inl(u16 port) {
+    u32 ret;
+    asm volatile ("inl %1, %0" : "=a"(ret) : "Nd"(port));
+    return ret;
+}
+
+// Lê count palavras de 16 bits da porta para buffer (rep insw)
+static inline void insw(u16 port, void* buffer, u32 count) {
+    asm volatile ("rep insw" : "+D"(buffer), "+c"(count) : "d"(port) : "memory");
+}
+
+// Escreve count palavras de 16 bits de buffer na porta (rep outsw)
+static inline void outsw(u16 port, const void* buffer, u32 count) {
+    asm volatile ("rep outsw" : "+S"(buffer), "+c"(count) : "d"(port) : "memory");
+}
+
+#endif // IO_H
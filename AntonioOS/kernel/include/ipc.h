@@ -0,0 +1,78 @@
+#ifndef IPC_H
+#define IPC_H
+
+#include "process.h"
+#include "spinlock.h"
+#include "wait.h"
+
+// Troca de mensagens entre processos por portas
+// Mensagens pequenas são copiadas para um anel de tamanho fixo da porta;
+// páginas inteiras mudam de espaço de endereçamento sem cópia: o frame sai
+// do espaço de quem envia e é mapeado no espaço de quem recebe
+
+#define IPC_RING_SIZE 16              // Mensagens por porta (potência de 2)
+#define IPC_INLINE_MAX 64             // Bytes copiados em cada mensagem
+#define IPC_MAX_PAGES 16              // Páginas movidas em cada mensagem
+
+// Códigos de retorno
+#define IPC_OK 0
+#define IPC_ERROR_INVALID 1           // Argumento fora dos limites
+#define IPC_ERROR_CLOSED 2            // A porta foi fechada
+#define IPC_ERROR_NO_MEMORY 3         // Sem memória para mapear as páginas (a mensagem fica na porta)
+
+// Mensagem entregue a quem recebe
+typedef struct {
+    u32 sender;                   // PID de quem enviou
+    u32 length;                   // Bytes válidos em data
+    u32 page_count;               // Páginas mapeadas a partir do endereço de destino
+    u8 data[IPC_INLINE_MAX];      // Cópia da parte pequena
+} ipc_message_t;
+
+// Mensagem dentro do anel: as páginas viajam como frames físicos
+typedef struct {
+    u32 sender;
+    u32 length;
+    u32 page_count;
+    u32 frames[IPC_MAX_PAGES];
+    u8 data[IPC_INLINE_MAX];
+} ipc_slot_t;
+
+// Porta de mensagens
+typedef struct ipc_port {
+    spinlock_t lock;              // Protege o anel e closed
+    ipc_slot_t ring[IPC_RING_SIZE];
+    u32 head;                     // Próxima mensagem a receber
+    u32 tail;                     // Próxima posição livre (head == tail: vazio)
+    u32 closed;                   // 1 depois de ipc_port_close
+    wait_queue_t receivers;       // Processos esperando mensagem
+    wait_queue_t senders;         // Processos esperando espaço no anel
+    u32 handoffs;                 // Envios que passaram a CPU direto a quem recebe
+} ipc_port_t;
+
+// Cria uma porta
+ipc_port_t* ipc_port_create();
+
+// Fecha a porta, acorda quem espera e libera as páginas ainda em trânsito
+// Quem espera recebe IPC_ERROR_CLOSED
+void ipc_port_close(ipc_port_t* port);
+
+// Fecha e libera a porta (só quando nenhum processo a usa mais)
+void ipc_port_destroy(ipc_port_t* port);
+
+// Envia length bytes de data (até IPC_INLINE_MAX), esperando se o anel
+// estiver cheio; se alguém espera a mensagem, a CPU passa direto a ele
+u32 ipc_send(ipc_port_t* port, const void* data, u32 length);
+
+// Envia pages páginas a partir de address (alinhado a 4KB, na parte privada
+// do espaço ativo) junto com length bytes de data
+// As páginas saem do espaço de quem envia: um novo acesso ao endereço
+// encontra a página desmapeada (ou uma página zerada, em faixa sob demanda)
+u32 ipc_send_pages(ipc_port_t* port, const void* data, u32 length, void* address, u32 pages);
+
+// Recebe uma mensagem, esperando se a porta estiver vazia
+// As páginas da mensagem, se houver, são mapeadas a partir de map_address,
+// que deve ter IPC_MAX_PAGES páginas livres na parte privada do espaço ativo
+// (map_address pode ser NULL para quem só recebe mensagens pequenas)
+u32 ipc_receive(ipc_port_t* port, ipc_message_t* message, void* map_address);
+
+#endif // IPC_H
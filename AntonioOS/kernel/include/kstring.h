@@ -0,0 +1,37 @@
+#ifndef KSTRING_H
+#define KSTRING_H
+
+#include <stdint.h>
+
+// Definição de tipos
+typedef uint8_t u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef uint64_t u64;
+
+// Implementações de kmemcpy/kmemset, escolhidas no boot por string_init
+typedef enum {
+    STRING_BYTES = 0,   // Laço byte a byte (referência do benchmark)
+    STRING_REP = 1,     // rep movsd/rep stosd, com cabeça e cauda em bytes
+    STRING_SSE2 = 2     // Blocos de 64 bytes em registradores XMM
+} string_mode_t;
+
+// Escolhe a implementação pelo CPUID (depois de fpu_init)
+void string_init();
+
+// Troca a implementação em uso; retorna 0 se a CPU não a suportar
+u32 string_select(string_mode_t mode);
+
+// Implementação em uso
+string_mode_t string_get_mode();
+
+// Copia size bytes; as regiões não podem se sobrepor
+void* kmemcpy(void* destination, const void* source, u32 size);
+
+// Copia size bytes; as regiões podem se sobrepor
+void* kmemmove(void* destination, const void* source, u32 size);
+
+// Preenche size bytes com value
+void* kmemset(void* destination, u8 value, u32 size);
+
+#endif // KSTRING_H
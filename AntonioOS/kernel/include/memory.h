@@ -22,35 +22,188 @@ typedef struct {
     u32* bitmap;
     u32 total_frames;
     u32 used_frames;
+    u32 bitmap_words;             // Número de palavras de 32 bits do bitmap
+    u32* summary;                 // 1 bit por palavra do bitmap totalmente ocupada
+    u32 summary_words;            // Número de palavras do resumo
+    u32 hint;                     // Palavra do bitmap onde a próxima busca começa (next-fit)
+    u16* frame_refs;              // Referências extras de cada frame (páginas compartilhadas)
 } physical_memory_manager_t;
 
+// Reserva de frames já zerados, reabastecida pelo processo idle
+#define PMM_ZERO_POOL_SIZE 64
+
+typedef struct {
+    u32 frames[PMM_ZERO_POOL_SIZE];  // Endereços físicos dos frames zerados
+    u32 count;                    // Frames disponíveis na reserva
+    u32 hits;                     // Pedidos atendidos pela reserva
+    u32 misses;                   // Pedidos que precisaram zerar na hora
+} pmm_zero_pool_t;
+
+// Alocador buddy para faixas físicas contíguas
+#define BUDDY_MAX_ORDER 10            // Maior bloco: 2^10 frames (4MB)
+#define BUDDY_NO_PAGE 0xFFFFFFFF
+
+// Metadados de cada frame da zona buddy
+typedef struct {
+    u32 next;                     // Próximo bloco livre da mesma ordem
+    u32 prev;                     // Bloco livre anterior da mesma ordem
+    u8 order;                     // Ordem do bloco que começa neste frame
+    u8 is_free;                   // 1 se o bloco está em uma lista livre
+} buddy_page_t;
+
+typedef struct {
+    u32 base;                     // Endereço físico do início da zona
+    u32 frames;                   // Número de frames da zona
+    u32 free_frames;              // Frames livres na zona
+    u32 free_list[BUDDY_MAX_ORDER + 1]; // Primeiro bloco livre de cada ordem
+    buddy_page_t* pages;          // Metadados por frame
+} buddy_allocator_t;
+
 // Inicializa o gerenciador de memória física
-void pmm_init(u32 mem_upper);
+void pmm_init(u32 mem_upper, memory_map_entry_t* mmap, u32 mmap_length);
 
 // Aloca um frame de memória física
 void* pmm_alloc_frame();
 
+// Aloca até count frames de uma vez; retorna quantos foram alocados
+u32 pmm_alloc_frames(u32 count, void** frames);
+
+// Aloca um frame zerado, da reserva se possível (zera na hora se estiver vazia)
+void* pmm_alloc_zeroed_frame();
+
+// Completa a reserva de frames zerados (chamada pelo processo idle)
+void pmm_refill_zero_pool();
+
+// Pedidos a pmm_alloc_zeroed_frame atendidos e não atendidos pela reserva
+void pmm_get_zero_pool_stats(u32* hits, u32* misses);
+
+// Número total de frames e de frames em uso
+u32 pmm_get_total_frames();
+u32 pmm_get_used_frames();
+
 // Libera um frame de memória física
 void pmm_free_frame(void* frame);
 
+// Registra mais um mapeamento compartilhando o frame
+void pmm_ref_frame(void* frame);
+
+// Remove um mapeamento do frame; o frame é liberado ao perder o último
+void pmm_unref_frame(void* frame);
+
+// Aloca 2^order frames contíguos e alinhados ao próprio tamanho
+void* pmm_alloc_order(u32 order);
+
+// Libera um bloco obtido com pmm_alloc_order
+void pmm_free_order(void* addr, u32 order);
+
+// Flags das entradas de paginação
+#define PAGE_PRESENT 0x1
+#define PAGE_WRITE 0x2
+#define PAGE_USER 0x4
+#define PAGE_NOCACHE 0x10             // Cache desligado (registradores de dispositivos)
+#define PAGE_LARGE 0x80               // Entrada do diretório mapeia 4MB diretamente (PSE)
+#define PAGE_GLOBAL 0x100             // Entrada mantida no TLB ao recarregar CR3 (PGE)
+#define PAGE_COW 0x200                // Bit livre: página somente leitura compartilhada (copy-on-write)
+
+#define LARGE_PAGE_SIZE 0x400000
+
+// Mapeamento recursivo: a última entrada do diretório aponta para ele mesmo,
+// tornando o diretório e as tabelas do espaço ativo sempre acessíveis
+#define PAGE_DIRECTORY_VADDR 0xFFFFF000
+#define PAGE_TABLES_VADDR 0xFFC00000
+
+// Parte privada de cada espaço de endereçamento; fora dela, as entradas são
+// do kernel e compartilhadas por todos os espaços
+#define USER_SPACE_START 0x01000000
+#define USER_SPACE_END 0xC0000000
+
+// Espaço de endereçamento registrado (para propagar entradas do kernel)
+typedef struct vmm_space {
+    u32 page_directory;           // Endereço físico do diretório
+    struct vmm_space* next;       // Próximo espaço registrado
+} vmm_space_t;
+
 // Gerenciador de memória virtual
 typedef struct {
-    u32* page_directory;
+    u32* page_directory;          // Diretório ativo, visto pelo mapeamento recursivo
+    u32 current_directory;        // Último diretório ativado (no kernel, cada CPU consulta o próprio CR3)
+    u32 kernel_directory;         // Endereço físico do diretório do kernel
+    vmm_space_t* spaces;          // Todos os espaços de endereçamento
+    u8 large_pages;               // 1 se a CPU suporta páginas de 4MB (PSE)
+    u32 kernel_flags;             // Flags extras dos mapeamentos do kernel (PAGE_GLOBAL)
 } virtual_memory_manager_t;
 
-// Inicializa o gerenciador de memória virtual
+// Inicializa o gerenciador de memória virtual e ativa a paginação
 void vmm_init();
 
+// Cria um espaço de endereçamento que compartilha as entradas do kernel
+// Retorna o endereço físico do novo diretório de páginas
+u32* vmm_create_address_space();
+
+// Destrói um espaço de endereçamento e libera a sua parte de usuário
+void vmm_destroy_address_space(u32* page_directory);
+
+// Ativa um espaço de endereçamento (recarrega CR3 apenas se mudar)
+void vmm_switch_address_space(u32* page_directory);
+
+// Obtém o endereço físico do diretório do kernel
+u32* vmm_get_kernel_directory();
+
 // Mapeia uma página virtual para um endereço físico
-void vmm_map_page(void* physical, void* virtual, u32 flags);
+// Retorna 0 se faltar memória para a tabela de páginas
+u32 vmm_map_page(void* physical, void* virtual, u32 flags);
 
 // Desmapeia uma página virtual
 void vmm_unmap_page(void* virtual);
 
+// Mapeia uma faixa física contígua, usando páginas de 4MB onde o alinhamento
+// permitir, e invalida o TLB uma única vez ao final
+void vmm_map_range(void* physical, void* virtual, u32 size, u32 flags);
+
+// Desmapeia uma faixa de endereços virtuais
+void vmm_unmap_range(void* virtual, u32 size);
+
+// Flags extras para mapeamentos do kernel (PAGE_GLOBAL, se disponível)
+u32 vmm_kernel_flags();
+
+// Reserva uma faixa virtual sem alocar memória: cada página recebe um frame
+// zerado no primeiro acesso, pelo tratador de falha de página
+// Faixas do kernel valem para todos os espaços; as demais, só para o espaço ativo
+void vmm_reserve_lazy(void* virtual, u32 size, u32 flags);
+
+// Cria uma cópia do espaço ativo em que as páginas de usuário são
+// compartilhadas como copy-on-write
+u32* vmm_clone_address_space();
+
+// Obtém o endereço físico mapeado em um endereço virtual (0 se não mapeado)
+u32 vmm_get_physical(void* virtual);
+
+// Estado do heap do kernel
+typedef struct {
+    u32 heap_size;                // Bytes entre o início e o fim atual do heap
+    u32 used_bytes;               // Bytes em blocos ocupados (com cabeçalhos)
+    u32 free_bytes;               // Bytes em blocos livres
+    u32 largest_free;             // Maior bloco livre
+    u32 used_blocks;
+    u32 free_blocks;
+} heap_stats_t;
+
+// Inicializa o heap do kernel
+void heap_init();
+
 // Aloca memória no heap do kernel
 void* kmalloc(u32 size);
 
+// Aloca memória no heap do kernel com o endereço alinhado a align (potência de 2)
+void* kmalloc_aligned(u32 size, u32 align);
+
+// Redimensiona um bloco do heap do kernel, preservando o conteúdo
+void* krealloc(void* ptr, u32 size);
+
 // Libera memória no heap do kernel
 void kfree(void* ptr);
 
+// Percorre o heap e preenche stats (custo proporcional ao número de blocos)
+void heap_get_stats(heap_stats_t* stats);
+
 #endif // MEMORY_H
@@ -0,0 +1,41 @@
+#ifndef PCI_H
+#define PCI_H
+
+#include <stdint.h>
+
+// Definição de tipos
+typedef uint8_t u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef uint64_t u64;
+
+// Registradores do espaço de configuração
+#define PCI_VENDOR_ID 0x00
+#define PCI_COMMAND 0x04
+#define PCI_CLASS 0x08                // Revisão, prog-if, subclasse e classe
+#define PCI_BAR0 0x10
+#define PCI_BAR4 0x20
+#define PCI_INTERRUPT_LINE 0x3C
+
+// Bits do registrador de comando
+#define PCI_COMMAND_IO 0x1            // Responde a portas de E/S
+#define PCI_COMMAND_MASTER 0x4        // Pode iniciar DMA (bus master)
+
+#define PCI_NO_VENDOR 0xFFFF
+
+// Endereço de uma função PCI
+typedef struct {
+    u8 bus;
+    u8 device;
+    u8 function;
+} pci_address_t;
+
+// Lê e escreve uma palavra de 32 bits do espaço de configuração (mecanismo 1)
+u32 pci_read_config(pci_address_t* address, u8 offset);
+void pci_write_config(pci_address_t* address, u8 offset, u32 value);
+
+// Procura a primeira função com a classe e a subclasse pedidas
+// Retorna 0 se não houver nenhuma
+u32 pci_find_class(u8 class_code, u8 subclass, pci_address_t* address);
+
+#endif // PCI_H
@@ -17,56 +17,218 @@ typedef enum {
     PROCESS_STATE_TERMINATED
 } process_state_t;
 
-// Estrutura para armazenar o estado da CPU
+// Prioridades: 0 é a mais alta
+#define PROCESS_PRIORITY_LEVELS 32
+#define PROCESS_PRIORITY_DEFAULT 16
+#define PROCESS_PRIORITY_IDLE (PROCESS_PRIORITY_LEVELS - 1)
+
+// Tamanho da pilha do kernel de cada processo
+#define KERNEL_STACK_SIZE 4096
+
+// Tabela de processos: o PID traz o índice da entrada nos bits baixos e,
+// acima deles, a geração da entrada, que muda a cada reuso; um PID antigo
+// nunca encontra o processo que ocupou a entrada depois
+#define PROCESS_TABLE_BITS 8
+#define PROCESS_TABLE_SIZE (1 << PROCESS_TABLE_BITS)
+#define PROCESS_PID_SLOT(pid) ((pid) & (PROCESS_TABLE_SIZE - 1))
+
+// Histograma da espera nas filas de prontos, em ciclos (rdtsc): a faixa 0
+// conta esperas de menos de 2^12 ciclos, a faixa i, de 2^(11+i) até
+// 2^(12+i), e a última também todas as maiores
+#define SCHED_WAIT_BUCKETS 16
+#define SCHED_WAIT_SHIFT 12
+
+// Classe de tempo real EDF (earliest deadline first)
+// Um processo EDF declara quanto roda (runtime) a cada período (period) e o
+// prazo de cada execução (deadline), contado do início do período
+// Os processos EDF de uma CPU rodam antes de qualquer processo Round Robin,
+// o de prazo mais próximo primeiro, e não migram de CPU
+#define EDF_UTILIZATION_ONE (1 << 16) // Utilização 1.0 em ponto fixo
+#define EDF_MAX_PERIOD 65535          // Período máximo, em ticks
+
+// Parâmetros de um processo EDF, em milissegundos
+// runtime <= deadline <= period
 typedef struct {
-    u32 eax, ebx, ecx, edx;
-    u32 esi, edi, ebp, esp;
-    u32 eip, eflags;
-    u32 cs, ds, es, fs, gs, ss;
-} cpu_state_t;
+    u32 runtime;
+    u32 deadline;
+    u32 period;
+} edf_params_t;
+
+struct wait_queue;
 
 // Estrutura de processo
 typedef struct process {
     u32 pid;                      // ID do processo
     char name[32];                // Nome do processo
     process_state_t state;        // Estado atual
+    u32 priority;                 // Prioridade (0 = mais alta)
     u32* page_directory;          // Diretório de páginas
     void* kernel_stack;           // Pilha do kernel
-    cpu_state_t* cpu_state;       // Estado da CPU salvo
-    struct process* next;         // Próximo processo na lista
+    u32 kernel_esp;               // esp salvo por context_switch (registradores na pilha)
+    void* fpu_state;              // Área de 512 bytes do fxsave, criada no primeiro uso da FPU
+    struct process* next;         // Próximo processo na lista (ou na lista de zumbis)
+    struct process* prev;         // Processo anterior na lista
+    struct process* rq_next;      // Próximo na fila de prontos da sua prioridade
+    struct process* rq_prev;      // Anterior na fila de prontos da sua prioridade
+    u32 cpu;                      // CPU em cuja fila o processo entra (a última em que rodou)
+    volatile u32 on_cpu;          // 1 desde que uma CPU o escolheu até ele sair dela
+    u32 time_slice;               // Ticks restantes do quantum atual
+    u64 wake_tick;                // Tick em que um processo dormindo acorda
+    struct process* sleep_next;   // Próximo na lista de processos dormindo
+    struct process* sleep_prev;   // Anterior na lista de processos dormindo
+    struct wait_queue* wait_queue; // Fila de espera em que o processo está (ou NULL)
+    struct process* wait_next;    // Próximo na fila de espera
+    struct process* wait_prev;    // Anterior na fila de espera
+    u64 run_start;                // rdtsc ao ganhar a CPU
+    u64 ready_since;              // rdtsc ao entrar nas filas de prontos
+    u64 runtime;                  // Ciclos em execução
+    u32 voluntary_switches;       // Saídas da CPU por bloqueio ou término
+    u32 involuntary_switches;     // Saídas da CPU ainda pronto (quantum, preempção, yield)
+    u32 wait_histogram[SCHED_WAIT_BUCKETS]; // Esperas nas filas de prontos
+    u32 edf_period;               // Período EDF em ticks (0: Round Robin)
+    u32 edf_runtime;              // Ticks de execução por período
+    u32 edf_deadline;             // Prazo relativo, em ticks
+    u32 edf_density;              // runtime / min(deadline, period), em ponto fixo
+    u64 edf_release;              // Tick em que o período atual começou
+    u64 edf_abs_deadline;         // Tick do prazo da execução atual
+    u32 edf_budget;               // Ticks que ainda pode rodar no período atual
+    u32 edf_waiting;              // 1 enquanto dorme até o próximo período
+    u32 edf_misses;               // Execuções terminadas depois do prazo
+    u32 edf_overruns;             // Períodos em que o orçamento acabou antes da execução
 } process_t;
 
+// Cópia da contabilidade de um processo (process_get_stats)
+typedef struct {
+    u32 pid;
+    char name[32];
+    process_state_t state;
+    u32 cpu;
+    u32 priority;
+    u64 runtime;
+    u32 voluntary_switches;
+    u32 involuntary_switches;
+    u32 wait_histogram[SCHED_WAIT_BUCKETS];
+} process_stats_t;
+
+// Quantum padrão, em milissegundos
+#define SCHEDULER_DEFAULT_QUANTUM_MS 10
+
+// Filas de prontos de uma CPU, uma FIFO por prioridade
+// Só processos no estado READY ficam nas filas; o processo em execução não
+typedef struct {
+    process_t* head[PROCESS_PRIORITY_LEVELS];
+    process_t* tail[PROCESS_PRIORITY_LEVELS];
+    u32 bitmap;                   // Bit p ligado se a fila da prioridade p não está vazia
+    process_t* edf_head;          // Processos EDF prontos, do prazo mais próximo ao mais distante
+    u32 count;                    // Processos prontos em todas as filas
+} run_queue_t;
+
 // Inicializa o sistema de processos
 void process_init();
 
 // Cria um novo processo
 process_t* process_create(const char* name, void* entry_point);
 
+// Cria uma thread do kernel: executa fn(arg) no espaço de endereçamento do
+// kernel, sem espaço de usuário próprio, e termina quando fn retorna
+process_t* kthread_create(void (*fn)(void*), void* arg);
+
+// kthread_create com um nome (para depuração)
+process_t* kthread_create_named(const char* name, void (*fn)(void*), void* arg);
+
+// Cria uma thread do kernel da classe EDF
+// Retorna NULL se nenhuma CPU comporta a utilização pedida (controle de
+// admissão: a soma de runtime / min(deadline, period) de cada CPU não passa de 1)
+process_t* kthread_create_edf(const char* name, void (*fn)(void*), void* arg, const edf_params_t* params);
+
+// Encerra a execução do período atual do processo EDF atual e dorme até o
+// início do próximo, quando recebe um novo orçamento e um novo prazo
+void process_wait_next_period();
+
 // Termina um processo
+// O processo vira zumbi e é liberado depois pelo reaper, quando nenhuma CPU
+// estiver mais usando a sua pilha
 void process_terminate(process_t* process);
 
+// Procura um processo pelo PID em O(1); NULL se não existir mais
+// O ponteiro só é seguro enquanto o processo não puder terminar
+process_t* process_find(u32 pid);
+
 // Bloqueia um processo
 void process_block(process_t* process);
 
 // Desbloqueia um processo
 void process_unblock(process_t* process);
 
+// Desfaz process_block no processo atual antes de ele deixar a CPU,
+// mesmo que alguém já o tenha acordado (ver wait_finish)
+void process_unblock_current();
+
+// Altera a prioridade de um processo
+void process_set_priority(process_t* process, u32 priority);
+
+// Bloqueia o processo atual por ms milissegundos
+void process_sleep(u32 ms);
+
+// Termina o processo atual (não retorna, exceto no idle)
+void process_exit();
+
 // Obtém o processo atual
 process_t* process_get_current();
 
-// Inicializa o escalonador
+// Copia a contabilidade de até max processos; retorna quantos foram copiados
+// Os contadores de processos em outras CPUs podem estar no meio de uma troca
+u32 process_get_stats(process_stats_t* stats, u32 max);
+
+struct cpu;
+
+// Inicializa o escalonador; o código atual passa a ser o idle da BSP
 void scheduler_init();
 
+// Prepara as filas de uma CPU secundária e cria o seu processo idle,
+// cuja pilha é a usada pela CPU ao partir
+process_t* scheduler_init_cpu(struct cpu* cpu);
+
 // Adiciona um processo ao escalonador
 void scheduler_add_process(process_t* process);
 
-// Remove um processo do escalonador
-void scheduler_remove_process(u32 pid);
+// Termina o processo com o PID especificado; retorna 0 se ele não existir
+u32 scheduler_remove_process(u32 pid);
+
+// Devolve um processo bloqueado às filas de prontos da sua CPU, em O(1)
+// Pode ser chamada por manipuladores de interrupção
+void scheduler_wake(process_t* process);
 
 // Realiza a troca de contexto
 void scheduler_schedule();
 
+// Cede a CPU diretamente a um processo pronto (em qualquer CPU), sem esperar
+// a vez dele; retorna 0 se ele não existe ou não pôde ser levado para esta CPU
+u32 scheduler_yield_to(u32 pid);
+
+// Define o quantum de cada processo, em milissegundos
+void scheduler_set_quantum(u32 ms);
+
+// 1 se o processo atual deve deixar a CPU já: foi terminado por outra CPU
+// ou há um processo EDF pronto com prazo mais próximo (interrupções desligadas)
+u32 scheduler_need_resched();
+
+// Chamado pelo timer de cada CPU: elapsed ticks se passaram desde a última
+// chamada; preempta o processo atual ao fim do quantum (ou do orçamento EDF)
+void scheduler_tick(u32 elapsed);
+
+// Acorda os processos cujo prazo venceu (chamado pelo timer da BSP)
+void scheduler_wake_sleepers();
+
+// Tick do próximo prazo (processo dormindo), ou TIMER_NO_DEADLINE
+u64 scheduler_next_deadline();
+
+// Número de processos prontos esperando a CPU atual
+u32 scheduler_ready_count();
+
 // Função externa para troca de contexto (implementada em assembly)
-extern void context_switch(cpu_state_t* old_state, cpu_state_t* new_state);
+// Salva os registradores preservados na pilha atual, grava esp em *old_esp
+// e continua a partir da pilha new_esp
+extern void context_switch(u32* old_esp, u32 new_esp);
 
 #endif // PROCESS_H
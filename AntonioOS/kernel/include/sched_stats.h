@@ -0,0 +1,30 @@
+#ifndef SCHED_STATS_H
+#define SCHED_STATS_H
+
+#include "process.h"
+
+// Rastro do escalonador: um anel de tamanho fixo com as últimas trocas de
+// contexto, gravado sem travas por todas as CPUs
+// O rastro e a contabilidade de cada processo (process_get_stats) aparecem
+// como texto em /schedtrace e /schedstat
+
+#define SCHED_TRACE_SIZE 256          // Eventos no anel (potência de 2)
+
+// Uma troca de contexto
+typedef struct {
+    volatile u32 sequence;        // Número do evento + 1, gravado por último (0: incompleto)
+    u32 cpu;                      // CPU em que a troca aconteceu
+    u32 prev_pid;                 // Processo que deixou a CPU
+    u32 prev_state;               // Estado dele ao sair (pronto: preemptado)
+    u32 next_pid;                 // Processo que ganhou a CPU
+    u32 wait;                     // Ciclos que ele esperou nas filas (saturado)
+    u64 tsc;                      // rdtsc no momento da troca
+} sched_trace_event_t;
+
+// Grava uma troca no anel (chamada pelo escalonador, interrupções desligadas)
+void sched_trace_record(u64 tsc, u32 cpu, process_t* prev, process_t* next, u64 wait);
+
+// Cria /schedstat e /schedtrace (depois de fs_init)
+void sched_stats_init();
+
+#endif // SCHED_STATS_H
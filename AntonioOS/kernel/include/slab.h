@@ -0,0 +1,45 @@
+#ifndef SLAB_H
+#define SLAB_H
+
+#include <stdint.h>
+#include "spinlock.h"
+
+// Definição de tipos
+typedef uint8_t u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef uint64_t u64;
+
+// Slab: bloco de memória dividido em objetos do mesmo tamanho
+typedef struct kmem_slab {
+    struct kmem_slab* next;       // Próximo slab do cache
+} kmem_slab_t;
+
+// Cache de objetos de tamanho fixo
+typedef struct kmem_cache {
+    char name[32];                // Nome do cache (para depuração)
+    u32 object_size;              // Tamanho pedido para cada objeto
+    u32 stride;                   // Distância entre objetos (objeto + ligação, alinhado)
+    u32 align;                    // Alinhamento dos objetos
+    u32 objects_per_slab;         // Objetos em cada slab
+    void (*ctor)(void*);          // Construtor opcional
+    void* free_list;              // Objetos livres (já construídos)
+    kmem_slab_t* slabs;           // Slabs pertencentes ao cache
+    u32 total_objects;            // Objetos existentes em todos os slabs
+    u32 active_objects;           // Objetos entregues e ainda não liberados
+    struct kmem_cache* next;      // Próximo cache registrado
+    spinlock_t lock;              // Protege a lista livre, os slabs e os contadores
+} kmem_cache_t;
+
+// Cria um cache de objetos
+// O construtor é chamado uma única vez por objeto, quando o slab é criado;
+// objetos liberados voltam ao cache no estado em que foram deixados
+kmem_cache_t* kmem_cache_create(const char* name, u32 size, u32 align, void (*ctor)(void*));
+
+// Aloca um objeto do cache
+void* kmem_cache_alloc(kmem_cache_t* cache);
+
+// Devolve um objeto ao cache
+void kmem_cache_free(kmem_cache_t* cache, void* object);
+
+#endif // SLAB_H
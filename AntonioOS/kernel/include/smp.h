@@ -0,0 +1,56 @@
+#ifndef SMP_H
+#define SMP_H
+
+#include "process.h"
+#include "spinlock.h"
+
+// Número máximo de CPUs (BSP + APs)
+#define SMP_MAX_CPUS 8
+
+// Endereço físico onde o código de partida das APs é copiado
+// O SIPI só aponta para páginas abaixo de 1MB (vetor = endereço >> 12)
+#define SMP_TRAMPOLINE 0x70000
+
+// Dados de cada CPU, acessados pelo segmento %gs da própria CPU
+typedef struct cpu {
+    struct cpu* self;             // Endereço deste cpu_t (lido em %gs:0)
+    u32 id;                       // Índice lógico (0 = BSP)
+    u32 apic_id;                  // ID do APIC local
+    volatile u32 online;          // 1 depois que a CPU entrou no escalonador
+    process_t* current;           // Processo em execução nesta CPU
+    process_t* idle;              // Processo idle desta CPU
+    process_t* prev;              // Processo que acabou de deixar a CPU (ver scheduler_finish_switch)
+    run_queue_t run_queue;        // Filas de prontos desta CPU
+    spinlock_t rq_lock;           // Protege run_queue e o estado dos processos nela
+    process_t* fpu_owner;         // Processo com o estado carregado na FPU desta CPU
+    u8 fpu_ts;                    // Cópia de CR0.TS, para evitar escritas em CR0
+    u8 fpu_kernel_depth;          // Seções fpu_kernel_begin abertas (uma falha de página aninha)
+    u32 steals;                   // Processos roubados de outras CPUs
+    u32 edf_utilization;          // Soma das densidades dos processos EDF (process_lock)
+} cpu_t;
+
+// Dados da CPU atual
+// Só é estável com as interrupções desligadas: o processo pode migrar de CPU
+static inline cpu_t* smp_this_cpu() {
+    cpu_t* cpu;
+    asm volatile("mov %%gs:0, %0" : "=r"(cpu));
+    return cpu;
+}
+
+// Prepara os dados da BSP e carrega o seu %gs (logo após gdt_init)
+void smp_init_bsp();
+
+// Procura as outras CPUs na tabela MP e as coloca no escalonador
+// Chamada com o timer já funcionando e as interrupções ligadas
+void smp_init();
+
+// Dados da CPU de índice id
+cpu_t* smp_get_cpu(u32 id);
+
+// Número de CPUs em funcionamento
+u32 smp_get_cpu_count();
+
+// Acorda uma CPU parada em hlt para que ela olhe as filas de prontos
+void smp_send_reschedule(cpu_t* cpu);
+
+#endif // SMP_H
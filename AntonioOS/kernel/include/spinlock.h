@@ -0,0 +1,45 @@
+#ifndef SPINLOCK_H
+#define SPINLOCK_H
+
+#include "cpu.h"
+
+// Trava de espera ativa para dados compartilhados entre CPUs
+typedef struct {
+    volatile u32 locked;          // 1 enquanto alguma CPU tem a trava
+} spinlock_t;
+
+#define SPINLOCK_INIT { 0 }
+
+static inline void spin_init(spinlock_t* lock) {
+    lock->locked = 0;
+}
+
+// Espera lendo a trava (sem escrever) até ela parecer livre, para não
+// disputar a linha de cache a cada volta
+static inline void spin_lock(spinlock_t* lock) {
+    while (cpu_xchg(&lock->locked, 1)) {
+        while (lock->locked) {
+            cpu_pause();
+        }
+    }
+}
+
+static inline void spin_unlock(spinlock_t* lock) {
+    asm volatile("" : : : "memory");
+    lock->locked = 0;
+}
+
+// Desliga as interrupções antes de travar: um manipulador nesta CPU que
+// tentasse a mesma trava esperaria para sempre
+static inline u32 spin_lock_irqsave(spinlock_t* lock) {
+    u32 flags = cpu_irq_save();
+    spin_lock(lock);
+    return flags;
+}
+
+static inline void spin_unlock_irqrestore(spinlock_t* lock, u32 flags) {
+    spin_unlock(lock);
+    cpu_irq_restore(flags);
+}
+
+#endif // SPINLOCK_H
@@ -0,0 +1,34 @@
+#ifndef TIMER_H
+#define TIMER_H
+
+#include <stdint.h>
+
+// Definição de tipos
+typedef uint8_t u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef uint64_t u64;
+
+// Frequência dos ticks periódicos (1 tick = 1ms)
+#define TIMER_HZ 1000
+
+// Sem prazo: o timer ocioso dorme o máximo que o PIT permite
+#define TIMER_NO_DEADLINE 0xFFFFFFFFFFFFFFFFULL
+
+// Inicializa o PIT no modo periódico e libera a IRQ0
+void timer_init(u32 frequency);
+
+// Ticks desde a inicialização (contando os períodos sem ticks do idle)
+u64 timer_get_ticks();
+
+// Espera ativa de pelo menos ms milissegundos (precisa da IRQ0 ligada)
+void timer_wait(u32 ms);
+
+// Converte milissegundos em ticks (arredonda para cima, mínimo 1)
+u32 timer_ms_to_ticks(u32 ms);
+
+// Chamado pelo processo idle da BSP: troca os ticks periódicos por um único disparo
+// no próximo prazo do escalonador e para a CPU até a próxima interrupção
+void timer_idle();
+
+#endif // TIMER_H
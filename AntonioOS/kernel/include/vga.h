@@ -0,0 +1,20 @@
+#ifndef VGA_H
+#define VGA_H
+
+#include <stdint.h>
+
+// Definição de tipos
+typedef uint8_t u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef uint64_t u64;
+
+// Funções de vídeo (modo texto), implementadas em kernel.c
+void vga_clear();
+void vga_set_color(u8 fg, u8 bg);
+void vga_putchar(char c);
+void vga_write(const char* str);
+void vga_write_dec(u32 value);
+void vga_write_hex(u32 value);
+
+#endif // VGA_H
@@ -0,0 +1,52 @@
+#ifndef WAIT_H
+#define WAIT_H
+
+#include "process.h"
+#include "spinlock.h"
+
+// Fila de espera: processos bloqueados até que alguém sinalize um evento
+// Os processos esperando ficam fora das filas de prontos e voltam a elas em O(1)
+typedef struct wait_queue {
+    spinlock_t lock;              // Protege a lista de processos esperando
+    process_t* head;              // Primeiro a esperar (o próximo a acordar)
+    process_t* tail;              // Último a esperar
+} wait_queue_t;
+
+#define WAIT_QUEUE_INIT { SPINLOCK_INIT, NULL, NULL }
+
+// Inicializa uma fila de espera vazia
+void wait_queue_init(wait_queue_t* queue);
+
+// Coloca o processo atual na fila e o marca como bloqueado; ele só deixa a
+// CPU no próximo scheduler_schedule, então a condição ainda pode ser conferida
+void wait_prepare(wait_queue_t* queue);
+
+// Tira o processo atual da fila (se ainda estiver nela) e o mantém em execução
+void wait_finish(wait_queue_t* queue);
+
+// Acorda o primeiro processo da fila; retorna o PID dele (0 se não havia
+// ninguém esperando)
+// Pode ser chamada por manipuladores de interrupção
+u32 wake_up_one(wait_queue_t* queue);
+
+// Acorda todos os processos da fila; retorna quantos foram acordados
+u32 wake_up_all(wait_queue_t* queue);
+
+// Remove um processo da fila em que está esperando (usada ao terminá-lo)
+void wait_queue_remove(process_t* process);
+
+// Bloqueia o processo atual até cond ser verdadeira
+// cond é avaliada depois de entrar na fila: um wake_up entre a avaliação e a
+// troca de contexto devolve o processo às filas de prontos, sem se perder
+// Não pode ser usada pelo processo idle nem com as interrupções desligadas
+#define wait_event(queue, cond)             \
+    do {                                    \
+        while (1) {                         \
+            wait_prepare(queue);            \
+            if (cond) break;                \
+            scheduler_schedule();           \
+        }                                   \
+        wait_finish(queue);                 \
+    } while (0)
+
+#endif // WAIT_H
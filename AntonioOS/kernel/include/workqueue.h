@@ -0,0 +1,55 @@
+#ifndef WORKQUEUE_H
+#define WORKQUEUE_H
+
+#include "process.h"
+#include "wait.h"
+
+// Trabalho adiado: um manipulador de interrupção enfileira a parte demorada
+// e retorna; uma thread do kernel da fila a executa depois, com as
+// interrupções ligadas
+// Um trabalho nunca executa em duas threads ao mesmo tempo: enfileirado
+// durante a própria execução, ele volta à fila só quando ela termina
+typedef struct work {
+    void (*fn)(struct work* work); // Função executada pela thread
+    struct work* next;            // Próximo trabalho enfileirado
+    volatile u32 state;           // WORK_PENDING e WORK_RUNNING
+} work_t;
+
+#define WORK_PENDING 0x1          // Enfileirado e ainda não iniciado (não entra duas vezes)
+#define WORK_RUNNING 0x2          // Em execução em alguma thread
+
+// Número máximo de threads de uma fila
+#define WORKQUEUE_MAX_WORKERS 8
+
+// Fila de trabalho
+// Os pedidos entram em uma pilha sem trava (cmpxchg); cada thread leva a
+// pilha inteira de uma vez e a executa na ordem de chegada
+typedef struct workqueue {
+    char name[16];                // Nome da fila (dado às threads)
+    work_t* volatile pending;     // Trabalhos enfileirados, o mais recente primeiro
+    wait_queue_t wait;            // Threads esperando trabalho
+    u32 worker_count;             // Threads da fila
+    process_t* workers[WORKQUEUE_MAX_WORKERS];
+    volatile u32 completed;       // Trabalhos executados
+} workqueue_t;
+
+// Prepara um trabalho que chama fn(work) (o trabalho costuma ficar dentro
+// da estrutura de quem o enfileira); a fila ainda usa o trabalho depois de
+// fn retornar, então fn não pode liberá-lo
+void work_init(work_t* work, void (*fn)(work_t* work));
+
+// Cria uma fila com workers threads do kernel (ao menos 1)
+workqueue_t* workqueue_create(const char* name, u32 workers);
+
+// Enfileira um trabalho e acorda uma thread; retorna 0 se ele já estava na fila
+// Não trava nada além da fila de espera: pode ser chamada por manipuladores
+// de interrupção, em qualquer CPU
+u32 queue_work(workqueue_t* queue, work_t* work);
+
+// Fila de uso geral, com uma thread por CPU (criada por workqueue_init)
+extern workqueue_t* system_workqueue;
+
+// Cria a fila de uso geral (depois de smp_init)
+void workqueue_init();
+
+#endif // WORKQUEUE_H
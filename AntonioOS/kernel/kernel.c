@@ -1,4 +1,20 @@
 #include <stdint.h>
+#include "include/interrupts.h"
+#include "include/vga.h"
+#include "include/memory.h"
+#include "include/io.h"
+#include "include/process.h"
+#include "include/timer.h"
+#include "include/fpu.h"
+#include "include/gdt.h"
+#include "include/smp.h"
+#include "include/apic.h"
+#include "include/workqueue.h"
+#include "include/filesystem.h"
+#include "include/sched_stats.h"
+#include "include/kstring.h"
+#include "include/ata.h"
+#include "include/bench.h"
 
 // Definição de tipos
 typedef uint8_t u8;
@@ -31,16 +47,9 @@ typedef struct {
     u16 vbe_interface_len;
 } multiboot_info_t;
 
-// Funções de E/S
-static inline void outb(u16 port, u8 value) {
-    asm volatile ("outb %0, %1" : : "a"(value), "Nd"(port));
-}
-
-static inline u8 inb(u16 port) {
-    u8 ret;
-    asm volatile ("inb %1, %0" : "=a"(ret) : "Nd"(port));
-    return ret;
-}
+// Bits de multiboot_info_t.flags
+#define MULTIBOOT_FLAG_MEM (1 << 0)   // mem_lower/mem_upper válidos
+#define MULTIBOOT_FLAG_MMAP (1 << 6)  // mmap_addr/mmap_length válidos
 
 // Funções de vídeo (modo texto)
 #define VGA_MEMORY 0xB8000
@@ -64,22 +73,21 @@ void vga_set_color(u8 fg, u8 bg) {
     vga_color = (bg << 4) | (fg & 0x0F);
 }
 
+// Sobe a tela uma linha e limpa a última
+static void vga_scroll() {
+    kmemmove(vga_buffer, vga_buffer + VGA_WIDTH, (VGA_HEIGHT - 1) * VGA_WIDTH * sizeof(u16));
+    for (int x = 0; x < VGA_WIDTH; x++) {
+        vga_buffer[(VGA_HEIGHT - 1) * VGA_WIDTH + x] = (u16)(' ' | (vga_color << 8));
+    }
+    cursor_y = VGA_HEIGHT - 1;
+}
+
 void vga_putchar(char c) {
     if (c == '\n') {
         cursor_x = 0;
         cursor_y++;
         if (cursor_y >= VGA_HEIGHT) {
-            // Scroll
-            for (int y = 0; y < VGA_HEIGHT - 1; y++) {
-                for (int x = 0; x < VGA_WIDTH; x++) {
-                    vga_buffer[y * VGA_WIDTH + x] = vga_buffer[(y + 1) * VGA_WIDTH + x];
-                }
-            }
-            // Limpa última linha
-            for (int x = 0; x < VGA_WIDTH; x++) {
-                vga_buffer[(VGA_HEIGHT - 1) * VGA_WIDTH + x] = (u16)(' ' | (vga_color << 8));
-            }
-            cursor_y = VGA_HEIGHT - 1;
+            vga_scroll();
         }
     } else if (c == '\r') {
         cursor_x = 0;
@@ -90,17 +98,7 @@ void vga_putchar(char c) {
             cursor_x = 0;
             cursor_y++;
             if (cursor_y >= VGA_HEIGHT) {
-                // Scroll (mesmo código de acima)
-                for (int y = 0; y < VGA_HEIGHT - 1; y++) {
-                    for (int x = 0; x < VGA_WIDTH; x++) {
-                        vga_buffer[y * VGA_WIDTH + x] = vga_buffer[(y + 1) * VGA_WIDTH + x];
-                    }
-                }
-                // Limpa última linha
-                for (int x = 0; x < VGA_WIDTH; x++) {
-                    vga_buffer[(VGA_HEIGHT - 1) * VGA_WIDTH + x] = (u16)(' ' | (vga_color << 8));
-                }
-                cursor_y = VGA_HEIGHT - 1;
+                vga_scroll();
             }
         }
     }
@@ -112,6 +110,27 @@ void vga_write(const char* str) {
     }
 }
 
+// Escreve um número em decimal
+void vga_write_dec(u32 value) {
+    char digits[10];
+    int count = 0;
+    do {
+        digits[count++] = '0' + value % 10;
+        value /= 10;
+    } while (value);
+    while (count) {
+        vga_putchar(digits[--count]);
+    }
+}
+
+// Escreve um número em hexadecimal (0x seguido de 8 dígitos)
+void vga_write_hex(u32 value) {
+    vga_write("0x");
+    for (int shift = 28; shift >= 0; shift -= 4) {
+        vga_putchar("0123456789ABCDEF"[(value >> shift) & 0xF]);
+    }
+}
+
 // GDT (Global Descriptor Table)
 struct gdt_entry {
     u16 limit_low;
@@ -127,7 +146,7 @@ struct gdt_ptr {
     u32 base;
 } __attribute__((packed));
 
-struct gdt_entry gdt[3];
+struct gdt_entry gdt[GDT_ENTRIES];
 struct gdt_ptr gp;
 
 extern void gdt_flush(u32);
@@ -144,7 +163,7 @@ void gdt_set_gate(int num, u32 base, u32 limit, u8 access, u8 gran) {
 }
 
 void gdt_init() {
-    gp.limit = (sizeof(struct gdt_entry) * 3) - 1;
+    gp.limit = (sizeof(struct gdt_entry) * GDT_ENTRIES) - 1;
     gp.base = (u32)&gdt;
     
     // Null descriptor
@@ -156,10 +175,20 @@ void gdt_init() {
     // Data segment
     gdt_set_gate(2, 0, 0xFFFFFFFF, 0x92, 0xCF);
     
+    // Os descritores por CPU são preenchidos por smp.c
+    for (int i = GDT_CPU_FIRST; i < GDT_ENTRIES; i++) {
+        gdt_set_gate(i, 0, 0, 0, 0);
+    }
+    
     // Flush GDT
     gdt_flush((u32)&gp);
 }
 
+// Carrega a GDT já montada (CPUs secundárias)
+void gdt_load() {
+    gdt_flush((u32)&gp);
+}
+
 // IDT (Interrupt Descriptor Table)
 struct idt_entry {
     u16 base_lo;
@@ -179,6 +208,12 @@ struct idt_ptr idtp;
 
 extern void idt_load(u32);
 
+// Stubs de entrada dos vetores 0-63 (kernel/arch/interrupts.asm)
+extern u32 isr_stub_table[INT_STUB_COUNT];
+
+// Manipuladores registrados por vetor
+static interrupt_handler_t interrupt_handlers[256];
+
 void idt_set_gate(u8 num, u32 base, u16 sel, u8 flags) {
     idt[num].base_lo = base & 0xFFFF;
     idt[num].base_hi = (base >> 16) & 0xFFFF;
@@ -197,13 +232,56 @@ void idt_init() {
         idt_set_gate(i, 0, 0, 0);
     }
     
-    // Configura as interrupções básicas
-    // (Aqui seriam configurados os handlers de interrupção)
+    // Configura as exceções, as IRQs e os vetores do APIC local
+    // (portão de interrupção de 32 bits, anel 0)
+    for (int i = 0; i < INT_STUB_COUNT; i++) {
+        idt_set_gate(i, isr_stub_table[i], GDT_KERNEL_CODE, 0x8E);
+    }
     
     // Carrega a IDT
     idt_load((u32)&idtp);
 }
 
+// Carrega a IDT já configurada (CPUs secundárias)
+void idt_reload() {
+    idt_load((u32)&idtp);
+}
+
+// Registra o manipulador de um vetor
+void interrupt_register_handler(u8 vector, interrupt_handler_t handler) {
+    interrupt_handlers[vector] = handler;
+}
+
+// Despacha uma interrupção para o manipulador registrado
+void interrupt_dispatch(interrupt_frame_t* frame) {
+    // IRQs recebem o EOI antes do manipulador, que pode trocar de processo
+    if (frame->int_no >= IRQ_BASE && frame->int_no < IRQ_BASE + IRQ_COUNT) {
+        pic_send_eoi(frame->int_no - IRQ_BASE);
+    } else if (frame->int_no >= INT_APIC_BASE && frame->int_no != INT_APIC_SPURIOUS) {
+        lapic_eoi();
+    }
+    
+    interrupt_handler_t handler = interrupt_handlers[frame->int_no];
+    if (handler) {
+        handler(frame);
+        return;
+    }
+    
+    // Exceção sem manipulador: não há como continuar
+    if (frame->int_no < IRQ_BASE) {
+        vga_write("\nExcecao nao tratada: ");
+        vga_write_dec(frame->int_no);
+        vga_write(" em eip=");
+        vga_write_hex(frame->eip);
+        vga_write(" erro=");
+        vga_write_hex(frame->err_code);
+        vga_write("\n");
+        while (1) {
+            asm volatile("cli; hlt");
+        }
+    }
+}
+
 // PIC (Programmable Interrupt Controller)
 #define PIC1_CMD  0x20
 #define PIC1_DATA 0x21
@@ -232,14 +310,65 @@ void pic_init() {
     outb(PIC2_DATA, 0xFF);
 }
 
+// Libera uma IRQ no PIC
+void pic_unmask_irq(u8 irq) {
+    u16 port = (irq < 8) ? PIC1_DATA : PIC2_DATA;
+    outb(port, inb(port) & ~(1 << (irq % 8)));
+    
+    // IRQs do PIC escravo chegam pela IRQ2 do mestre
+    if (irq >= 8) {
+        outb(PIC1_DATA, inb(PIC1_DATA) & ~(1 << 2));
+    }
+}
+
+// Sinaliza o fim do tratamento de uma IRQ
+void pic_send_eoi(u8 irq) {
+    if (irq >= 8) {
+        outb(PIC2_CMD, 0x20);
+    }
+    outb(PIC1_CMD, 0x20);
+}
+
 // Função principal do kernel
 void kernel_main(multiboot_info_t* mbi) {
     // Inicializa subsistemas
     vga_clear();
     gdt_init();
+    smp_init_bsp();
     idt_init();
     pic_init();
     
+    // Memória: o mapa do Multiboot define quais frames são utilizáveis
+    u32 mem_lower = (mbi->flags & MULTIBOOT_FLAG_MEM) ? mbi->mem_lower : 0;
+    u32 mem_upper = (mbi->flags & MULTIBOOT_FLAG_MEM) ? mbi->mem_upper : 0;
+    if (mbi->flags & MULTIBOOT_FLAG_MMAP) {
+        pmm_init(mem_upper, (memory_map_entry_t*)mbi->mmap_addr, mbi->mmap_length);
+    } else {
+        pmm_init(mem_upper, 0, 0);
+    }
+    vmm_init();
+    heap_init();
+    fpu_init();
+    string_init();
+    
+    // Sistema de arquivos em memória, com /schedstat e /schedtrace
+    fs_init();
+    sched_stats_init();
+    
+    // Escalonador preemptivo: kernel_main passa a ser o processo idle
+    scheduler_init();
+    timer_init(TIMER_HZ);
+    asm volatile("sti");
+    
+    // CPUs secundárias (qemu-system-i386 -smp N); usa o timer para as esperas
+    smp_init();
+    
+    // Threads para o trabalho adiado pelos manipuladores de interrupção
+    workqueue_init();
+    
+    // Discos IDE; os comandos que falham ao começar terminam pela fila de trabalho
+    ata_init();
+    
     // Mensagem de boas-vindas
     vga_write("Kernel inicializado com sucesso!\n");
     vga_write("Sistema Operacional x86 - Versao 0.1\n");
@@ -248,18 +377,49 @@ void kernel_main(multiboot_info_t* mbi) {
     // Informações de memória do Multiboot
     vga_write("Informacoes de memoria:\n");
     vga_write("  Memoria baixa: ");
-    // Aqui seria adicionado código para converter e exibir mbi->mem_lower
+    vga_write_dec(mem_lower);
     vga_write(" KB\n");
     
     vga_write("  Memoria alta: ");
-    // Aqui seria adicionado código para converter e exibir mbi->mem_upper
-    vga_write(" KB\n\n");
+    vga_write_dec(mem_upper);
+    vga_write(" KB\n");
+    
+    vga_write("  Memoria livre: ");
+    vga_write_dec((pmm_get_total_frames() - pmm_get_used_frames()) * 4);
+    vga_write(" KB\n");
+    
+    vga_write("  CPUs: ");
+    vga_write_dec(smp_get_cpu_count());
+    vga_write("\n");
+    
+    for (block_device_t* disk = block_get_devices(); disk; disk = disk->next) {
+        vga_write("  Disco ");
+        vga_write(disk->name);
+        vga_write(": ");
+        vga_write_dec(disk->sector_count / 2048);
+        vga_write(ata_get_dma(disk) ? " MB (DMA)\n" : " MB (PIO)\n");
+    }
+    vga_write("\n");
+    
+#ifdef KERNEL_BENCH
+    bench_context_switch();
+    bench_ipc();
+    bench_edf();
+    bench_string();
+    bench_block();
+#endif
     
     vga_write("Sistema em modo de espera...\n");
     
-    // Loop infinito
+    // Loop infinito do processo idle
     while (1) {
-        // Halt CPU até próxima interrupção
-        asm volatile("hlt");
+        // Aproveita o tempo ocioso para zerar frames com antecedência
+        pmm_refill_zero_pool();
+        
+        // Cede a CPU se algum processo ficou pronto
+        scheduler_schedule();
+        
+        // Dorme sem ticks periódicos até o próximo prazo ou interrupção
+        timer_idle();
     }
 }
@@ -0,0 +1,240 @@
+#include "../include/kstring.h"
+#include "../include/cpu.h"
+#ifndef HOST_BENCH
+#include "../include/fpu.h"
+#endif
+
+// Abaixo disto o alinhamento da cabeça custa mais do que economiza
+#define STRING_SMALL 16
+// A partir disto o SSE2 compensa salvar a FPU e escrever CR0
+#define STRING_SSE_MIN 2048
+// As interrupções ficam desligadas por no máximo um trecho deste tamanho
+#define STRING_SSE_CHUNK 0x10000
+// Destinos maiores que isto não cabem na cache: as escritas a contornam (movntdq)
+#define STRING_STREAM_MIN 0x40000
+
+static string_mode_t string_mode = STRING_REP;
+static u8 string_has_sse2 = 0;
+
+// Primitivas rep: avançam os ponteiros como as instruções
+static inline void string_movsb(u8** destination, const u8** source, u32 count) {
+    asm volatile("rep movsb" : "+D"(*destination), "+S"(*source), "+c"(count) : : "memory");
+}
+
+static inline void string_movsd(u8** destination, const u8** source, u32 count) {
+    asm volatile("rep movsl" : "+D"(*destination), "+S"(*source), "+c"(count) : : "memory");
+}
+
+static inline void string_stosb(u8** destination, u8 value, u32 count) {
+    asm volatile("rep stosb" : "+D"(*destination), "+c"(count) : "a"(value) : "memory");
+}
+
+static inline void string_stosd(u8** destination, u32 value, u32 count) {
+    asm volatile("rep stosl" : "+D"(*destination), "+c"(count) : "a"(value) : "memory");
+}
+
+// Cópia com rep movsd; o destino é alinhado em 4 bytes antes
+static void string_copy_rep(u8* destination, const u8* source, u32 size) {
+    u32 head = -(u32)destination & 3;
+    if (head > size) head = size;
+    string_movsb(&destination, &source, head);
+    size -= head;
+    string_movsd(&destination, &source, size / 4);
+    string_movsb(&destination, &source, size & 3);
+}
+
+// Preenchimento com rep stosd; o destino é alinhado em 4 bytes antes
+static void string_fill_rep(u8* destination, u8 value, u32 size) {
+    u32 head = -(u32)destination & 3;
+    if (head > size) head = size;
+    string_stosb(&destination, value, head);
+    size -= head;
+    string_stosd(&destination, value * 0x01010101, size / 4);
+    string_stosb(&destination, value, size & 3);
+}
+
+#ifndef HOST_BENCH
+// Os registradores XMM não aparecem como clobber: o kernel é compilado sem
+// -msse, então o compilador nunca os usa, e fpu_kernel_begin salva o estado
+// do processo dono da FPU antes de eles serem sobrescritos
+
+// Cópia com SSE2: destino alinhado em 16 bytes, origem em qualquer alinhamento
+static void string_copy_sse2(u8* destination, const u8* source, u32 size) {
+    u32 head = -(u32)destination & 15;
+    string_copy_rep(destination, source, head);
+    destination += head;
+    source += head;
+    size -= head;
+    
+    u32 stream = size >= STRING_STREAM_MIN;
+    while (size >= 64) {
+        u32 blocks = size / 64;
+        if (blocks > STRING_SSE_CHUNK / 64) blocks = STRING_SSE_CHUNK / 64;
+        size -= blocks * 64;
+        
+        u32 flags = fpu_kernel_begin();
+        if (stream) {
+            asm volatile("1: movdqu (%1), %%xmm0\n\t"
+                         "movdqu 16(%1), %%xmm1\n\t"
+                         "movdqu 32(%1), %%xmm2\n\t"
+                         "movdqu 48(%1), %%xmm3\n\t"
+                         "movntdq %%xmm0, (%0)\n\t"
+                         "movntdq %%xmm1, 16(%0)\n\t"
+                         "movntdq %%xmm2, 32(%0)\n\t"
+                         "movntdq %%xmm3, 48(%0)\n\t"
+                         "add $64, %0\n\t"
+                         "add $64, %1\n\t"
+                         "dec %2\n\t"
+                         "jnz 1b\n\t"
+                         "sfence"
+                         : "+r"(destination), "+r"(source), "+r"(blocks) : : "memory", "cc");
+        } else {
+            asm volatile("1: movdqu (%1), %%xmm0\n\t"
+                         "movdqu 16(%1), %%xmm1\n\t"
+                         "movdqu 32(%1), %%xmm2\n\t"
+                         "movdqu 48(%1), %%xmm3\n\t"
+                         "movdqa %%xmm0, (%0)\n\t"
+                         "movdqa %%xmm1, 16(%0)\n\t"
+                         "movdqa %%xmm2, 32(%0)\n\t"
+                         "movdqa %%xmm3, 48(%0)\n\t"
+                         "add $64, %0\n\t"
+                         "add $64, %1\n\t"
+                         "dec %2\n\t"
+                         "jnz 1b"
+                         : "+r"(destination), "+r"(source), "+r"(blocks) : : "memory", "cc");
+        }
+        fpu_kernel_end(flags);
+    }
+    
+    string_copy_rep(destination, source, size);
+}
+
+// Preenchimento com SSE2: o byte é replicado nos 16 bytes de xmm0
+static void string_fill_sse2(u8* destination, u8 value, u32 size) {
+    u32 head = -(u32)destination & 15;
+    string_fill_rep(destination, value, head);
+    destination += head;
+    size -= head;
+    
+    u32 pattern = value * 0x01010101;
+    u32 stream = size >= STRING_STREAM_MIN;
+    while (size >= 64) {
+        u32 blocks = size / 64;
+        if (blocks > STRING_SSE_CHUNK / 64) blocks = STRING_SSE_CHUNK / 64;
+        size -= blocks * 64;
+        
+        u32 flags = fpu_kernel_begin();
+        if (stream) {
+            asm volatile("movd %2, %%xmm0\n\t"
+                         "pshufd $0, %%xmm0, %%xmm0\n\t"
+                         "1: movntdq %%xmm0, (%0)\n\t"
+                         "movntdq %%xmm0, 16(%0)\n\t"
+                         "movntdq %%xmm0, 32(%0)\n\t"
+                         "movntdq %%xmm0, 48(%0)\n\t"
+                         "add $64, %0\n\t"
+                         "dec %1\n\t"
+                         "jnz 1b\n\t"
+                         "sfence"
+                         : "+r"(destination), "+r"(blocks) : "r"(pattern) : "memory", "cc");
+        } else {
+            asm volatile("movd %2, %%xmm0\n\t"
+                         "pshufd $0, %%xmm0, %%xmm0\n\t"
+                         "1: movdqa %%xmm0, (%0)\n\t"
+                         "movdqa %%xmm0, 16(%0)\n\t"
+                         "movdqa %%xmm0, 32(%0)\n\t"
+                         "movdqa %%xmm0, 48(%0)\n\t"
+                         "add $64, %0\n\t"
+                         "dec %1\n\t"
+                         "jnz 1b"
+                         : "+r"(destination), "+r"(blocks) : "r"(pattern) : "memory", "cc");
+        }
+        fpu_kernel_end(flags);
+    }
+    
+    string_fill_rep(destination, value, size);
+}
+#endif
+
+// Escolhe a implementação pelo CPUID
+// O SSE2 só é usado se fpu_init tiver ligado CR4.OSFXSR
+void string_init() {
+#ifndef HOST_BENCH
+    u32 eax, ebx, ecx, edx;
+    cpu_cpuid(1, &eax, &ebx, &ecx, &edx);
+    string_has_sse2 = (edx & CPUID_EDX_SSE2) && (cpu_read_cr4() & CR4_OSFXSR);
+#endif
+    string_mode = string_has_sse2 ? STRING_SSE2 : STRING_REP;
+}
+
+// Troca a implementação em uso (benchmark)
+u32 string_select(string_mode_t mode) {
+    if (mode == STRING_SSE2 && !string_has_sse2) return 0;
+    string_mode = mode;
+    return 1;
+}
+
+// Implementação em uso
+string_mode_t string_get_mode() {
+    return string_mode;
+}
+
+// Copia size bytes entre regiões que não se sobrepõem
+void* kmemcpy(void* destination, const void* source, u32 size) {
+    u8* d = (u8*)destination;
+    const u8* s = (const u8*)source;
+    
+    if (size < STRING_SMALL || string_mode == STRING_BYTES) {
+        for (u32 i = 0; i < size; i++) {
+            d[i] = s[i];
+        }
+#ifndef HOST_BENCH
+    } else if (string_mode == STRING_SSE2 && size >= STRING_SSE_MIN) {
+        string_copy_sse2(d, s, size);
+#endif
+    } else {
+        string_copy_rep(d, s, size);
+    }
+    return destination;
+}
+
+// Copia size bytes entre regiões que podem se sobrepor
+void* kmemmove(void* destination, const void* source, u32 size) {
+    u8* d = (u8*)destination;
+    const u8* s = (const u8*)source;
+    
+    // Destino antes da origem ou sem sobreposição: a cópia para frente é segura,
+    // pois cada trecho é lido antes de a escrita alcançá-lo
+    if (d <= s || d >= s + size) {
+        return kmemcpy(destination, source, size);
+    }
+    
+    // Destino sobre o fim da origem: copia de trás para frente (DF ligado)
+    // Primeiro a cauda em bytes, depois palavras inteiras
+    d += size - 1;
+    s += size - 1;
+    u32 tail = size & 3;
+    u32 words = size / 4;
+    asm volatile("std; rep movsb; cld" : "+D"(d), "+S"(s), "+c"(tail) : : "memory");
+    d -= 3;
+    s -= 3;
+    asm volatile("std; rep movsl; cld" : "+D"(d), "+S"(s), "+c"(words) : : "memory");
+    return destination;
+}
+
+// Preenche size bytes com value
+void* kmemset(void* destination, u8 value, u32 size) {
+    u8* d = (u8*)destination;
+    
+    if (size < STRING_SMALL || string_mode == STRING_BYTES) {
+        for (u32 i = 0; i < size; i++) {
+            d[i] = value;
+        }
+#ifndef HOST_BENCH
+    } else if (string_mode == STRING_SSE2 && size >= STRING_SSE_MIN) {
+        string_fill_sse2(d, value, size);
+#endif
+    } else {
+        string_fill_rep(d, value, size);
+    }
+    return destination;
+}
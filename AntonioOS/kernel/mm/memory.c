@@ -1,77 +1,367 @@
 #include "../include/memory.h"
+#include "../include/cpu.h"
+#include "../include/interrupts.h"
+#include "../include/vga.h"
+#include "../include/spinlock.h"
+#include "../include/kstring.h"
+#ifndef HOST_BENCH
+#include "../include/smp.h"
+#endif
 
 // Constantes para gerenciamento de memória
 #define PAGE_SIZE 4096
 #define FRAME_SIZE 4096
 #define BITMAP_INDEX(frame) (frame / 32)
 #define BITMAP_OFFSET(frame) (frame % 32)
+#define BITMAP_FULL 0xFFFFFFFF
+#define PMM_NO_WORD 0xFFFFFFFF
+#define BUDDY_BLOCK_FRAMES (1 << BUDDY_MAX_ORDER)
+#define MMAP_AVAILABLE 1                  // Tipo de entrada do mapa de memória utilizável
+#define PMM_ADDRESS_LIMIT 0x100000000ULL  // Sem PAE, apenas os primeiros 4GB são endereçáveis
+#define PMM_LOW_MEMORY_END 0x100000       // Memória baixa (BIOS, VGA, pilha de boot) é sempre reservada
+#define PMM_METADATA_LIMIT 0x01000000     // Os metadados precisam estar na região mapeada 1:1
+
+// Fim da imagem do kernel (definido em link.ld)
+extern u8 _kernel_end;
 
 // Variáveis globais
 static physical_memory_manager_t pmm;
+static pmm_zero_pool_t zero_pool;
+static buddy_allocator_t buddy;
 static virtual_memory_manager_t vmm;
 
-// Inicializa o gerenciador de memória física
-void pmm_init(u32 mem_upper) {
-    // Calcula o número total de frames disponíveis
-    // mem_upper é em KB, convertemos para bytes e dividimos pelo tamanho do frame
-    pmm.total_frames = (mem_upper * 1024) / FRAME_SIZE;
-    pmm.used_frames = 0;
+// Travas dos alocadores, compartilhados por todas as CPUs
+// Ordem: heap_lock, depois vmm_lock (falha de página no heap), depois pmm_lock
+static spinlock_t pmm_lock = SPINLOCK_INIT;    // Bitmap, reserva zerada, frame_refs e buddy
+static spinlock_t vmm_lock = SPINLOCK_INIT;    // Tabelas do kernel, espaços e faixas sob demanda
+static spinlock_t heap_lock = SPINLOCK_INIT;   // Blocos e listas do heap
+
+// Atualiza o bit do resumo correspondente a uma palavra do bitmap
+static inline void pmm_update_summary(u32 word) {
+    u32 bit = 1 << BITMAP_OFFSET(word);
+    if (pmm.bitmap[word] == BITMAP_FULL) {
+        pmm.summary[BITMAP_INDEX(word)] |= bit;
+    } else {
+        pmm.summary[BITMAP_INDEX(word)] &= ~bit;
+    }
+}
+
+// Procura, a partir da palavra start, uma palavra do bitmap com algum frame livre
+// O resumo permite pular 32 palavras (1024 frames) cheias de uma só vez
+static u32 pmm_find_free_word(u32 start) {
+    u32 s = BITMAP_INDEX(start);
+    u32 candidates = ~pmm.summary[s] & (BITMAP_FULL << BITMAP_OFFSET(start));
+    
+    // Percorre o resumo uma vez, voltando ao início (a palavra inicial é
+    // revisitada no fim para cobrir os bits anteriores a start)
+    for (u32 n = 0; n <= pmm.summary_words; n++) {
+        if (candidates) {
+            return s * 32 + cpu_bsf(candidates);
+        }
+        if (++s >= pmm.summary_words) s = 0;
+        candidates = ~pmm.summary[s];
+    }
+    
+    return PMM_NO_WORD;
+}
+
+// Remove um bloco da lista livre da sua ordem
+static void buddy_list_remove(u32 page, u32 order) {
+    buddy_page_t* p = &buddy.pages[page];
+    if (p->prev != BUDDY_NO_PAGE) {
+        buddy.pages[p->prev].next = p->next;
+    } else {
+        buddy.free_list[order] = p->next;
+    }
+    if (p->next != BUDDY_NO_PAGE) {
+        buddy.pages[p->next].prev = p->prev;
+    }
+    p->is_free = 0;
+}
+
+// Insere um bloco no início da lista livre da sua ordem
+static void buddy_list_push(u32 page, u32 order) {
+    buddy_page_t* p = &buddy.pages[page];
+    p->order = order;
+    p->is_free = 1;
+    p->prev = BUDDY_NO_PAGE;
+    p->next = buddy.free_list[order];
+    if (p->next != BUDDY_NO_PAGE) {
+        buddy.pages[p->next].prev = page;
+    }
+    buddy.free_list[order] = page;
+}
+
+// Entrega a zona [base_frame, base_frame + frames) ao alocador buddy
+// A zona deve estar alinhada ao maior bloco para que os buddies sejam
+// encontrados com um simples XOR do índice
+static void buddy_init(u32 base_frame, u32 frames, buddy_page_t* pages) {
+    buddy.base = base_frame * FRAME_SIZE;
+    buddy.frames = frames;
+    buddy.free_frames = frames;
+    buddy.pages = pages;
+    
+    for (u32 order = 0; order <= BUDDY_MAX_ORDER; order++) {
+        buddy.free_list[order] = BUDDY_NO_PAGE;
+    }
+    for (u32 i = 0; i < frames; i++) {
+        buddy.pages[i].is_free = 0;
+        buddy.pages[i].order = 0;
+    }
+    
+    // A zona começa como uma sequência de blocos de ordem máxima
+    for (u32 i = 0; i < frames; i += BUDDY_BLOCK_FRAMES) {
+        buddy_list_push(i, BUDDY_MAX_ORDER);
+    }
+}
+
+// Conta os bits ligados de uma palavra
+static inline u32 pmm_popcount(u32 value) {
+    value = value - ((value >> 1) & 0x55555555);
+    value = (value & 0x33333333) + ((value >> 2) & 0x33333333);
+    value = (value + (value >> 4)) & 0x0F0F0F0F;
+    return (value * 0x01010101) >> 24;
+}
+
+// Marca os frames [first, end) como usados ou livres, uma palavra por vez
+// Retorna quantos frames mudaram de estado; o resumo não é atualizado aqui
+static u32 pmm_mark_range(u32 first, u32 end, u32 used) {
+    u32 changed = 0;
+    if (end > pmm.total_frames) end = pmm.total_frames;
+    
+    while (first < end) {
+        u32 offset = BITMAP_OFFSET(first);
+        u32 count = 32 - offset;
+        if (count > end - first) count = end - first;
+        u32 mask = (count == 32) ? BITMAP_FULL : ((1u << count) - 1) << offset;
+        
+        u32 old = pmm.bitmap[BITMAP_INDEX(first)];
+        u32 new = used ? (old | mask) : (old & ~mask);
+        changed += pmm_popcount(old ^ new);
+        pmm.bitmap[BITMAP_INDEX(first)] = new;
+        first += count;
+    }
+    
+    return changed;
+}
+
+// Próxima entrada do mapa de memória (o campo size não conta a si mesmo)
+#define MMAP_NEXT(entry) ((memory_map_entry_t*)((u32)(entry) + (entry)->size + sizeof((entry)->size)))
+
+// Converte uma entrada disponível em frames inteiros [*first, *end)
+// Retorna 0 se a entrada não contém nenhum frame utilizável abaixo de 4GB
+static u32 pmm_entry_frames(memory_map_entry_t* entry, u32* first, u32* end) {
+    if (entry->type != MMAP_AVAILABLE || entry->base_addr >= PMM_ADDRESS_LIMIT) {
+        return 0;
+    }
+    u64 limit = entry->base_addr + entry->length;
+    if (limit > PMM_ADDRESS_LIMIT) limit = PMM_ADDRESS_LIMIT;
+    
+    *first = (u32)((entry->base_addr + FRAME_SIZE - 1) >> 12);
+    *end = (u32)(limit >> 12);
+    return *first < *end;
+}
+
+// Inicializa o gerenciador de memória física a partir do mapa de memória do
+// Multiboot. Sem mapa (mmap_length == 0), usa apenas mem_upper (KB acima de 1MB)
+void pmm_init(u32 mem_upper, memory_map_entry_t* mmap, u32 mmap_length) {
+    memory_map_entry_t fallback;
+    if (!mmap || !mmap_length) {
+        fallback.size = sizeof(fallback) - sizeof(fallback.size);
+        fallback.base_addr = PMM_LOW_MEMORY_END;
+        fallback.length = (u64)mem_upper * 1024;
+        fallback.type = MMAP_AVAILABLE;
+        mmap = &fallback;
+        mmap_length = sizeof(fallback);
+    }
+    memory_map_entry_t* mmap_end = (memory_map_entry_t*)((u32)mmap + mmap_length);
+    
+    // O total de frames vai até o fim da última região disponível;
+    // buracos no meio continuam marcados como usados
+    u32 first, end;
+    pmm.total_frames = 0;
+    for (memory_map_entry_t* e = mmap; e < mmap_end; e = MMAP_NEXT(e)) {
+        if (pmm_entry_frames(e, &first, &end) && end > pmm.total_frames) {
+            pmm.total_frames = end;
+        }
+    }
+    pmm.hint = 0;
     
     // Aloca espaço para o bitmap (1 bit por frame)
     // Cada entrada do bitmap controla 32 frames (32 bits)
-    u32 bitmap_size = pmm.total_frames / 32;
-    if (pmm.total_frames % 32) bitmap_size++;
+    pmm.bitmap_words = pmm.total_frames / 32;
+    if (pmm.total_frames % 32) pmm.bitmap_words++;
+    
+    // O resumo tem 1 bit por palavra do bitmap
+    pmm.summary_words = pmm.bitmap_words / 32;
+    if (pmm.bitmap_words % 32) pmm.summary_words++;
+    
+    // A zona buddy ocupa até um quarto da memória, em blocos de 4MB
+    u32 max_zone_frames = (pmm.total_frames / 4) & ~(BUDDY_BLOCK_FRAMES - 1);
+    u32 metadata_size = pmm.bitmap_words * 4 + pmm.summary_words * 4
+                      + max_zone_frames * sizeof(buddy_page_t)
+                      + ((pmm.total_frames + 1) & ~1) * sizeof(u16);
+    
+    // Os metadados ficam no primeiro trecho disponível após o kernel (e acima
+    // da memória baixa) que os comporte dentro da região mapeada 1:1
+    u32 metadata_start = 0;
+    u32 kernel_end = ((u32)&_kernel_end + FRAME_SIZE - 1) & ~(FRAME_SIZE - 1);
+    if (kernel_end < PMM_LOW_MEMORY_END) kernel_end = PMM_LOW_MEMORY_END;
+    for (memory_map_entry_t* e = mmap; e < mmap_end; e = MMAP_NEXT(e)) {
+        if (!pmm_entry_frames(e, &first, &end)) continue;
+        u32 start = first * FRAME_SIZE;
+        if (start < kernel_end) start = kernel_end;
+        u32 limit = (end < PMM_METADATA_LIMIT / FRAME_SIZE) ? end * FRAME_SIZE : PMM_METADATA_LIMIT;
+        if (start < limit && limit - start >= metadata_size &&
+            (!metadata_start || start < metadata_start)) {
+            metadata_start = start;
+        }
+    }
+    if (!metadata_start) {
+        vga_write("PMM: sem espaco para os metadados\n");
+        cpu_halt();
+    }
+    
+    pmm.bitmap = (u32*)metadata_start;
+    pmm.summary = pmm.bitmap + pmm.bitmap_words;
+    buddy_page_t* buddy_pages = (buddy_page_t*)(pmm.summary + pmm.summary_words);
+    pmm.frame_refs = (u16*)(buddy_pages + max_zone_frames);
+    u32 metadata_end = metadata_start + metadata_size;
+    
+    // Nenhum frame começa compartilhado (zerado de dois em dois contadores)
+    u32* refs = (u32*)pmm.frame_refs;
+    for (u32 i = 0; i < (pmm.total_frames + 1) / 2; i++) {
+        refs[i] = 0;
+    }
     
-    // Coloca o bitmap logo após o kernel
-    // Endereço arbitrário para este exemplo, deve ser ajustado
-    pmm.bitmap = (u32*)0x100000;
+    // Tudo começa reservado; apenas as regiões disponíveis são liberadas.
+    // Os bits após o último frame nunca são liberados
+    for (u32 i = 0; i < pmm.bitmap_words; i++) {
+        pmm.bitmap[i] = BITMAP_FULL;
+    }
+    pmm.used_frames = pmm.total_frames;
+    for (memory_map_entry_t* e = mmap; e < mmap_end; e = MMAP_NEXT(e)) {
+        if (pmm_entry_frames(e, &first, &end)) {
+            pmm.used_frames -= pmm_mark_range(first, end, 0);
+        }
+    }
+    
+    // Reserva a memória baixa (BIOS, pilha de boot), o kernel e os metadados
+    pmm.used_frames += pmm_mark_range(0, kernel_end / FRAME_SIZE, 1);
+    pmm.used_frames += pmm_mark_range(metadata_start / FRAME_SIZE,
+                                      (metadata_end + FRAME_SIZE - 1) / FRAME_SIZE, 1);
     
-    // Inicializa o bitmap (todos os frames livres)
-    for (u32 i = 0; i < bitmap_size; i++) {
-        pmm.bitmap[i] = 0;
+    // A zona buddy é a maior sequência de blocos de 4MB totalmente livres a
+    // partir do topo da memória, limitada a um quarto do total
+    u32 zone_end = 0;
+    u32 zone_frames = 0;
+    u32 block = max_zone_frames ? pmm.total_frames / BUDDY_BLOCK_FRAMES : 0;
+    while (block-- > 0) {
+        u32 free = 1;
+        for (u32 w = 0; w < BUDDY_BLOCK_FRAMES / 32 && free; w++) {
+            free = !pmm.bitmap[block * (BUDDY_BLOCK_FRAMES / 32) + w];
+        }
+        if (free) {
+            if (!zone_frames) zone_end = (block + 1) * BUDDY_BLOCK_FRAMES;
+            zone_frames += BUDDY_BLOCK_FRAMES;
+            if (zone_frames >= max_zone_frames) break;
+        } else if (zone_frames) {
+            break;
+        }
+    }
+    u32 zone_base = zone_end - zone_frames;
+    
+    // A zona buddy é reservada no bitmap (palavras inteiras, pois é alinhada)
+    pmm.used_frames += pmm_mark_range(zone_base, zone_end, 1);
+    buddy_init(zone_base, zone_frames, buddy_pages);
+    
+    // Constrói o resumo; palavras inexistentes no fim contam como cheias
+    for (u32 i = 0; i < pmm.summary_words; i++) {
+        pmm.summary[i] = 0;
+    }
+    if (pmm.bitmap_words % 32) {
+        pmm.summary[pmm.summary_words - 1] = BITMAP_FULL << (pmm.bitmap_words % 32);
+    }
+    for (u32 i = 0; i < pmm.bitmap_words; i++) {
+        pmm_update_summary(i);
+    }
+}
+
+// Estatísticas do gerenciador de memória física
+u32 pmm_get_total_frames() {
+    return pmm.total_frames;
+}
+
+u32 pmm_get_used_frames() {
+    return pmm.used_frames;
+}
+
+// Aloca um frame de memória física (pmm_lock travado)
+static void* pmm_alloc_frame_locked() {
+    if (pmm.used_frames >= pmm.total_frames) {
+        // Sem memória livre: os frames da reserva zerada ainda podem ser usados
+        u32 frame = zero_pool.count ? zero_pool.frames[--zero_pool.count] : 0;
+        return (void*)frame;
     }
     
-    // Marca os primeiros frames como usados (kernel, bitmap, etc.)
-    // Assumindo que o kernel ocupa os primeiros 1MB
-    u32 kernel_frames = 256; // 1MB / 4KB = 256 frames
-    for (u32 i = 0; i < kernel_frames; i++) {
-        u32 idx = BITMAP_INDEX(i);
-        u32 off = BITMAP_OFFSET(i);
-        pmm.bitmap[idx] |= (1 << off);
-        pmm.used_frames++;
+    // Procura por uma palavra com frame livre a partir da última usada (next-fit)
+    u32 word = pmm_find_free_word(pmm.hint);
+    if (word == PMM_NO_WORD) {
+        return 0; // Não deveria chegar aqui
     }
+    
+    // Encontra o primeiro bit livre com uma única instrução
+    u32 bit = cpu_bsf(~pmm.bitmap[word]);
+    
+    // Marca o frame como usado
+    pmm.bitmap[word] |= 1 << bit;
+    pmm.used_frames++;
+    pmm_update_summary(word);
+    pmm.hint = word;
+    
+    // Calcula o endereço físico
+    u32 frame = word * 32 + bit;
+    return (void*)(frame * FRAME_SIZE);
 }
 
 // Aloca um frame de memória física
 void* pmm_alloc_frame() {
-    if (pmm.used_frames >= pmm.total_frames) {
-        return 0; // Sem memória disponível
-    }
-    
-    // Procura por um frame livre
-    for (u32 i = 0; i < pmm.total_frames / 32; i++) {
-        if (pmm.bitmap[i] != 0xFFFFFFFF) { // Se não estiver completamente cheio
-            // Encontra o primeiro bit livre
-            for (u32 j = 0; j < 32; j++) {
-                u32 bit = 1 << j;
-                if (!(pmm.bitmap[i] & bit)) {
-                    // Marca o frame como usado
-                    pmm.bitmap[i] |= bit;
-                    pmm.used_frames++;
-                    
-                    // Calcula o endereço físico
-                    u32 frame = i * 32 + j;
-                    return (void*)(frame * FRAME_SIZE);
-                }
-            }
+    u32 flags = spin_lock_irqsave(&pmm_lock);
+    void* frame = pmm_alloc_frame_locked();
+    spin_unlock_irqrestore(&pmm_lock, flags);
+    return frame;
+}
+
+// Aloca até count frames de uma vez
+// Consome todos os bits livres de cada palavra encontrada antes de buscar a próxima
+u32 pmm_alloc_frames(u32 count, void** frames) {
+    u32 allocated = 0;
+    u32 flags = spin_lock_irqsave(&pmm_lock);
+    
+    while (allocated < count && pmm.used_frames < pmm.total_frames) {
+        u32 word = pmm_find_free_word(pmm.hint);
+        if (word == PMM_NO_WORD) break;
+        
+        u32 free_bits = ~pmm.bitmap[word];
+        while (free_bits && allocated < count) {
+            u32 bit = cpu_bsf(free_bits);
+            free_bits &= free_bits - 1; // Limpa o bit encontrado
+            
+            pmm.bitmap[word] |= 1 << bit;
+            pmm.used_frames++;
+            frames[allocated++] = (void*)((word * 32 + bit) * FRAME_SIZE);
         }
+        
+        pmm_update_summary(word);
+        pmm.hint = word;
     }
     
-    return 0; // Não deveria chegar aqui
+    spin_unlock_irqrestore(&pmm_lock, flags);
+    return allocated;
 }
 
-// Libera um frame de memória física
-void pmm_free_frame(void* frame_addr) {
+// Libera um frame de memória física (pmm_lock travado)
+static void pmm_free_frame_locked(void* frame_addr) {
     u32 frame = (u32)frame_addr / FRAME_SIZE;
     u32 idx = BITMAP_INDEX(frame);
     u32 off = BITMAP_OFFSET(frame);
@@ -80,176 +370,1184 @@ void pmm_free_frame(void* frame_addr) {
     if (pmm.bitmap[idx] & (1 << off)) {
         pmm.bitmap[idx] &= ~(1 << off);
         pmm.used_frames--;
+        pmm_update_summary(idx);
     }
 }
 
+// Libera um frame de memória física
+void pmm_free_frame(void* frame_addr) {
+    u32 flags = spin_lock_irqsave(&pmm_lock);
+    pmm_free_frame_locked(frame_addr);
+    spin_unlock_irqrestore(&pmm_lock, flags);
+}
+
+// Registra mais um mapeamento compartilhando o frame
+void pmm_ref_frame(void* frame_addr) {
+    u32 frame = (u32)frame_addr / FRAME_SIZE;
+    if (frame < pmm.total_frames) {
+        u32 flags = spin_lock_irqsave(&pmm_lock);
+        pmm.frame_refs[frame]++;
+        spin_unlock_irqrestore(&pmm_lock, flags);
+    }
+}
+
+// Remove um mapeamento do frame; o frame é liberado ao perder o último
+void pmm_unref_frame(void* frame_addr) {
+    u32 frame = (u32)frame_addr / FRAME_SIZE;
+    if (frame >= pmm.total_frames) return;
+    
+    u32 flags = spin_lock_irqsave(&pmm_lock);
+    if (pmm.frame_refs[frame]) {
+        pmm.frame_refs[frame]--;
+    } else {
+        pmm_free_frame_locked(frame_addr);
+    }
+    spin_unlock_irqrestore(&pmm_lock, flags);
+}
+
+// Aloca 2^order frames contíguos da zona buddy
+void* pmm_alloc_order(u32 order) {
+    if (order > BUDDY_MAX_ORDER) return 0;
+    
+    u32 flags = spin_lock_irqsave(&pmm_lock);
+    
+    // Procura a menor ordem com um bloco livre
+    u32 current = order;
+    while (current <= BUDDY_MAX_ORDER && buddy.free_list[current] == BUDDY_NO_PAGE) {
+        current++;
+    }
+    if (current > BUDDY_MAX_ORDER) {
+        spin_unlock_irqrestore(&pmm_lock, flags);
+        return 0; // Sem bloco contíguo disponível
+    }
+    
+    u32 page = buddy.free_list[current];
+    buddy_list_remove(page, current);
+    
+    // Divide o bloco ao meio até chegar na ordem pedida,
+    // devolvendo a metade superior às listas livres
+    while (current > order) {
+        current--;
+        buddy_list_push(page + (1 << current), current);
+    }
+    
+    buddy.pages[page].order = order;
+    buddy.free_frames -= 1 << order;
+    spin_unlock_irqrestore(&pmm_lock, flags);
+    return (void*)(buddy.base + page * FRAME_SIZE);
+}
+
+// Libera um bloco da zona buddy, mesclando-o com os buddies livres
+void pmm_free_order(void* addr, u32 order) {
+    u32 a = (u32)addr;
+    if (order > BUDDY_MAX_ORDER || a < buddy.base) return;
+    
+    u32 page = (a - buddy.base) / FRAME_SIZE;
+    if (page >= buddy.frames || (page & ((1 << order) - 1))) {
+        return; // Endereço fora da zona ou desalinhado
+    }
+    
+    u32 flags = spin_lock_irqsave(&pmm_lock);
+    if (buddy.pages[page].is_free) {
+        spin_unlock_irqrestore(&pmm_lock, flags);
+        return; // Liberação dupla
+    }
+    
+    buddy.free_frames += 1 << order;
+    
+    // Sobe de ordem enquanto o buddy estiver livre e inteiro
+    while (order < BUDDY_MAX_ORDER) {
+        u32 sibling = page ^ (1 << order);
+        if (sibling >= buddy.frames || !buddy.pages[sibling].is_free ||
+            buddy.pages[sibling].order != order) {
+            break;
+        }
+        buddy_list_remove(sibling, order);
+        page &= ~(1 << order);
+        order++;
+    }
+    
+    buddy_list_push(page, order);
+    spin_unlock_irqrestore(&pmm_lock, flags);
+}
+
 // Estruturas para paginação
 #define PD_INDEX(addr) ((addr >> 22) & 0x3FF)
 #define PT_INDEX(addr) ((addr >> 12) & 0x3FF)
-#define PAGE_PRESENT 0x1
-#define PAGE_WRITE 0x2
-#define PAGE_USER 0x4
+
+#ifdef HOST_BENCH
+// No benchmark do host não há paginação: a memória física é uma arena comum
+// e diretórios e tabelas são acessados diretamente pelo endereço físico
+#define VMM_TABLE(pd_index) ((u32*)(vmm.page_directory[pd_index] & ~0xFFF))
+#define VMM_DIRECTORY(physical) ((u32*)(physical))
+#define VMM_CURRENT_DIRECTORY (vmm.current_directory)
+#else
+// Tabela de páginas de uma entrada do diretório, vista pelo mapeamento recursivo
+#define VMM_TABLE(pd_index) ((u32*)(PAGE_TABLES_VADDR + (pd_index) * PAGE_SIZE))
+#define VMM_DIRECTORY(physical) ((u32*)PAGE_DIRECTORY_VADDR)
+// Cada CPU pode estar em um espaço diferente: o ativo é o do seu próprio CR3
+#define VMM_CURRENT_DIRECTORY (cpu_read_cr3() & ~0xFFF)
+#endif
+#define VMM_RECURSIVE_PDE 1023
+
+// Regiões do kernel, compartilhadas por todos os espaços de endereçamento:
+// os primeiros 16MB (mapeados 1:1) e tudo a partir de 0xC0000000
+#define VMM_IDENTITY_END USER_SPACE_START
+#define VMM_KERNEL_BASE USER_SPACE_END
+#define VMM_IS_KERNEL_PDE(i) ((i) < PD_INDEX(VMM_IDENTITY_END) || (i) >= PD_INDEX(VMM_KERNEL_BASE))
+
+// Janelas temporárias para acessar frames que não estão mapeados no espaço ativo
+// Cada CPU tem as suas, então só é preciso desligar as interrupções ao usá-las
+#define VMM_WINDOW_PDE 1022
+#define VMM_WINDOW_SLOTS 4
+#ifdef HOST_BENCH
+#define VMM_WINDOW_CPU 0
+#else
+#define VMM_WINDOW_CPU (smp_this_cpu()->id)
+#endif
+#define VMM_WINDOW(slot) (PAGE_TABLES_VADDR - (VMM_WINDOW_CPU * VMM_WINDOW_SLOTS + (slot) + 1) * PAGE_SIZE)
+#define VMM_WINDOW_DIRECTORY 0 // Diretório de outro espaço
+#define VMM_WINDOW_TABLE 1     // Tabela de outro espaço
+#define VMM_WINDOW_COPY 2      // Frame de destino de uma cópia
+#define VMM_WINDOW_ZERO 3      // Frame sendo zerado (reserva de frames zerados)
+
+// Bits do código de erro da falha de página
+#define PF_PRESENT 0x1 // A página estava presente (violação de proteção)
+#define PF_WRITE 0x2   // O acesso era uma escrita
+
+// Faixas reservadas com alocação sob demanda
+#define VMM_MAX_LAZY_REGIONS 32
+
+typedef struct {
+    u32 start;                    // Início da faixa (alinhado à página)
+    u32 end;                      // Fim da faixa (exclusivo)
+    u32 flags;                    // Flags das páginas criadas
+    u32 directory;                // Espaço dono da faixa (0 = kernel, todos os espaços)
+} vmm_lazy_region_t;
+
+static vmm_lazy_region_t lazy_regions[VMM_MAX_LAZY_REGIONS];
+static u32 lazy_region_count = 0;
+
+// Acima deste número de páginas alteradas, recarregar CR3 sai mais barato que invlpg
+#define VMM_INVLPG_THRESHOLD 32
+
+// Marca os mapeamentos do kernel como globais quando a CPU suporta PGE
+#define VMM_GLOBAL_KERNEL_PAGES 1
+
+static vmm_space_t kernel_space;
+
+// Mapeia um frame físico em uma janela temporária
+static void* vmm_map_window(u32 slot, u32 physical) {
+#ifdef HOST_BENCH
+    (void)slot;
+    return (void*)(physical & ~0xFFF);
+#endif
+    void* window = (void*)VMM_WINDOW(slot);
+    VMM_TABLE(VMM_WINDOW_PDE)[PT_INDEX((u32)window)] = (physical & ~0xFFF) | PAGE_PRESENT | PAGE_WRITE;
+    cpu_invlpg(window);
+    return window;
+}
+
+// Remove o mapeamento de uma janela temporária
+static void vmm_unmap_window(u32 slot) {
+#ifdef HOST_BENCH
+    (void)slot;
+    return;
+#endif
+    void* window = (void*)VMM_WINDOW(slot);
+    VMM_TABLE(VMM_WINDOW_PDE)[PT_INDEX((u32)window)] = 0;
+    cpu_invlpg(window);
+}
+
+// Zera um frame físico; antes da paginação o frame é acessado diretamente
+// As interrupções ficam desligadas enquanto a janela está em uso
+static void vmm_zero_frame(u32 physical) {
+    if (!(cpu_read_cr0() & CR0_PG)) {
+        kmemset((void*)physical, 0, PAGE_SIZE);
+        return;
+    }
+    
+    u32 flags = cpu_irq_save();
+    void* window = vmm_map_window(VMM_WINDOW_ZERO, physical);
+    kmemset(window, 0, PAGE_SIZE);
+    vmm_unmap_window(VMM_WINDOW_ZERO);
+    cpu_irq_restore(flags);
+}
+
+// Aloca um frame zerado, da reserva se possível (zera na hora se estiver vazia)
+void* pmm_alloc_zeroed_frame() {
+    u32 flags = spin_lock_irqsave(&pmm_lock);
+    if (zero_pool.count) {
+        u32 frame = zero_pool.frames[--zero_pool.count];
+        zero_pool.hits++;
+        spin_unlock_irqrestore(&pmm_lock, flags);
+        return (void*)frame;
+    }
+    zero_pool.misses++;
+    u32 frame = (u32)pmm_alloc_frame_locked();
+    spin_unlock_irqrestore(&pmm_lock, flags);
+    
+    if (frame) {
+        vmm_zero_frame(frame);
+    }
+    return (void*)frame;
+}
+
+// Completa a reserva de frames zerados (chamada pelo processo idle)
+// Um frame por vez, para que as interrupções voltem a ser atendidas entre eles
+void pmm_refill_zero_pool() {
+    while (zero_pool.count < PMM_ZERO_POOL_SIZE) {
+        // Não tira da memória livre os últimos frames do sistema
+        if (pmm.total_frames - pmm.used_frames <= PMM_ZERO_POOL_SIZE) return;
+        
+        u32 frame = (u32)pmm_alloc_frame();
+        if (!frame) return;
+        vmm_zero_frame(frame);
+        
+        u32 flags = spin_lock_irqsave(&pmm_lock);
+        if (zero_pool.count < PMM_ZERO_POOL_SIZE) {
+            zero_pool.frames[zero_pool.count++] = frame;
+        } else {
+            pmm_free_frame_locked((void*)frame);
+        }
+        spin_unlock_irqrestore(&pmm_lock, flags);
+    }
+}
+
+// Pedidos a pmm_alloc_zeroed_frame atendidos e não atendidos pela reserva
+void pmm_get_zero_pool_stats(u32* hits, u32* misses) {
+    *hits = zero_pool.hits;
+    *misses = zero_pool.misses;
+}
+
+// Copia uma entrada do kernel recém-alterada para todos os outros espaços
+static void vmm_sync_kernel_pde(u32 pd_index) {
+    u32 entry = vmm.page_directory[pd_index];
+    
+    for (vmm_space_t* space = vmm.spaces; space; space = space->next) {
+        if (space->page_directory == VMM_CURRENT_DIRECTORY) continue;
+        u32* directory = (u32*)vmm_map_window(VMM_WINDOW_DIRECTORY, space->page_directory);
+        directory[pd_index] = entry;
+    }
+    vmm_unmap_window(VMM_WINDOW_DIRECTORY);
+}
+
+// Esvazia o TLB inteiro; entradas globais só saem desligando e religando CR4.PGE
+static void vmm_flush_all(u32 include_global) {
+    u32 cr4 = cpu_read_cr4();
+    if (include_global && (cr4 & CR4_PGE)) {
+        cpu_write_cr4(cr4 & ~CR4_PGE);
+        cpu_write_cr4(cr4);
+    } else {
+        cpu_write_cr3(cpu_read_cr3());
+    }
+}
+
+// Invalida o TLB de uma faixa alterada: página a página se forem poucas,
+// ou de uma só vez se forem muitas
+static void vmm_flush_range(u32 virtual, u32 pages, u32 include_global) {
+    if (pages > VMM_INVLPG_THRESHOLD) {
+        vmm_flush_all(include_global);
+        return;
+    }
+    for (u32 i = 0; i < pages; i++) {
+        cpu_invlpg((void*)(virtual + i * PAGE_SIZE));
+    }
+}
+
+// Obtém a tabela de páginas de uma entrada do diretório, criando-a se preciso
+// Uma página de 4MB existente é dividida em 1024 páginas de 4KB equivalentes
+static u32* vmm_get_table(u32 pd_index, u32 flags) {
+    u32 entry = vmm.page_directory[pd_index];
+    
+    if ((entry & PAGE_PRESENT) && !(entry & PAGE_LARGE)) {
+        return VMM_TABLE(pd_index);
+    }
+    
+    // Aloca uma nova tabela de páginas; uma tabela vazia já vem zerada
+    u32 table_frame = (u32)((entry & PAGE_PRESENT) ? pmm_alloc_frame() : pmm_alloc_zeroed_frame());
+    if (!table_frame) return NULL;
+    
+    // Adiciona a tabela ao diretório; ela passa a ser visível em VMM_TABLE
+    vmm.page_directory[pd_index] = table_frame | PAGE_PRESENT | PAGE_WRITE | (flags & PAGE_USER);
+    u32* page_table = VMM_TABLE(pd_index);
+    cpu_invlpg(page_table);
+    
+    if (entry & PAGE_PRESENT) {
+        // Mantém o mapeamento da página grande com a mesma tradução e flags
+        u32 base = entry & 0xFFC00000;
+        u32 page_flags = entry & (PAGE_WRITE | PAGE_USER | PAGE_GLOBAL);
+        for (u32 i = 0; i < 1024; i++) {
+            page_table[i] = (base + i * PAGE_SIZE) | PAGE_PRESENT | page_flags;
+        }
+        vmm_flush_all(entry & PAGE_GLOBAL);
+    }
+    
+    // Tabelas do kernel são compartilhadas por todos os espaços
+    if (VMM_IS_KERNEL_PDE(pd_index)) {
+        vmm_sync_kernel_pde(pd_index);
+    }
+    
+    return page_table;
+}
+
+// Grava a entrada de uma página sem invalidar o TLB
+static u32 vmm_install_page(u32 physical, u32 virtual, u32 flags) {
+    u32* page_table = vmm_get_table(PD_INDEX(virtual), flags);
+    if (!page_table) return 0;
+    
+    page_table[PT_INDEX(virtual)] = (physical & ~0xFFF) | PAGE_PRESENT | flags;
+    return 1;
+}
+
+static void vmm_page_fault(interrupt_frame_t* frame);
 
 // Inicializa o gerenciador de memória virtual
 void vmm_init() {
+    // Detecta o suporte a páginas de 4MB e a páginas globais
+    u32 eax, ebx, ecx, edx;
+    cpu_cpuid(1, &eax, &ebx, &ecx, &edx);
+    vmm.large_pages = (edx & CPUID_EDX_PSE) ? 1 : 0;
+    vmm.kernel_flags = (VMM_GLOBAL_KERNEL_PAGES && (edx & CPUID_EDX_PGE)) ? PAGE_GLOBAL : 0;
+    
     // Aloca um diretório de páginas
-    vmm.page_directory = (u32*)pmm_alloc_frame();
+    // A paginação ainda está desligada, então os frames são acessados pelo endereço físico
+    u32* directory = (u32*)pmm_alloc_zeroed_frame();
     
-    // Zera o diretório de páginas
-    for (int i = 0; i < 1024; i++) {
-        vmm.page_directory[i] = 0;
+    // Mapeia 1:1 a região baixa (kernel, bitmap, VGA)
+    if (vmm.large_pages) {
+        // Uma entrada de 4MB por vez, sem tabelas de páginas
+        for (u32 addr = 0; addr < VMM_IDENTITY_END; addr += LARGE_PAGE_SIZE) {
+            directory[PD_INDEX(addr)] = addr | PAGE_PRESENT | PAGE_WRITE | PAGE_LARGE | vmm.kernel_flags;
+        }
+    } else {
+        for (u32 addr = 0; addr < VMM_IDENTITY_END; addr += PAGE_SIZE) {
+            u32 pd_index = PD_INDEX(addr);
+            if (!(directory[pd_index] & PAGE_PRESENT)) {
+                u32* page_table = (u32*)pmm_alloc_zeroed_frame();
+                directory[pd_index] = (u32)page_table | PAGE_PRESENT | PAGE_WRITE;
+            }
+            u32* page_table = (u32*)(directory[pd_index] & ~0xFFF);
+            page_table[PT_INDEX(addr)] = addr | PAGE_PRESENT | PAGE_WRITE | vmm.kernel_flags;
+        }
+    }
+    
+    // Tabela das janelas temporárias (compartilhada por todos os espaços)
+    u32* window_table = (u32*)pmm_alloc_zeroed_frame();
+    directory[VMM_WINDOW_PDE] = (u32)window_table | PAGE_PRESENT | PAGE_WRITE;
+    
+    // Entrada recursiva
+    directory[VMM_RECURSIVE_PDE] = (u32)directory | PAGE_PRESENT | PAGE_WRITE;
+    
+    // Registra o espaço do kernel
+    vmm.kernel_directory = (u32)directory;
+    vmm.current_directory = (u32)directory;
+    vmm.page_directory = VMM_DIRECTORY(directory);
+    kernel_space.page_directory = (u32)directory;
+    kernel_space.next = NULL;
+    vmm.spaces = &kernel_space;
+    
+    // Ativa a paginação (PSE precisa estar ligado antes de usar páginas de 4MB)
+    if (vmm.large_pages) {
+        cpu_write_cr4(cpu_read_cr4() | CR4_PSE);
+    }
+    cpu_write_cr3((u32)directory);
+    cpu_write_cr0(cpu_read_cr0() | CR0_PG | CR0_WP);
+    if (vmm.kernel_flags & PAGE_GLOBAL) {
+        cpu_write_cr4(cpu_read_cr4() | CR4_PGE);
     }
+    
+    // Alocação sob demanda e copy-on-write dependem do tratador de falha de página
+    interrupt_register_handler(INT_PAGE_FAULT, vmm_page_fault);
+}
+
+// Flags extras para mapeamentos do kernel
+u32 vmm_kernel_flags() {
+    return vmm.kernel_flags;
 }
 
 // Mapeia uma página virtual para um endereço físico
-void vmm_map_page(void* physical, void* virtual, u32 flags) {
+u32 vmm_map_page(void* physical, void* virtual, u32 flags) {
+    u32 irq = spin_lock_irqsave(&vmm_lock);
+    
+    // Mapeia a página e atualiza o TLB
+    u32 mapped = vmm_install_page((u32)physical, (u32)virtual, flags);
+    if (mapped) {
+        cpu_invlpg(virtual);
+    }
+    
+    spin_unlock_irqrestore(&vmm_lock, irq);
+    return mapped;
+}
+
+// Desmapeia uma página virtual
+void vmm_unmap_page(void* virtual) {
     u32 pd_index = PD_INDEX((u32)virtual);
     u32 pt_index = PT_INDEX((u32)virtual);
+    u32 irq = spin_lock_irqsave(&vmm_lock);
+    u32 entry = vmm.page_directory[pd_index];
     
     // Verifica se a tabela de páginas existe
-    if (!(vmm.page_directory[pd_index] & PAGE_PRESENT)) {
-        // Aloca uma nova tabela de páginas
-        u32* page_table = (u32*)pmm_alloc_frame();
+    if (entry & PAGE_PRESENT) {
+        // Uma página de 4MB precisa ser dividida antes
+        u32* page_table = (entry & PAGE_LARGE) ? vmm_get_table(pd_index, 0) : VMM_TABLE(pd_index);
+        if (page_table) {
+            // Desmapeia a página e atualiza o TLB
+            page_table[pt_index] = 0;
+            cpu_invlpg(virtual);
+        }
+    }
+    
+    spin_unlock_irqrestore(&vmm_lock, irq);
+}
+
+// Mapeia uma faixa física contígua
+void vmm_map_range(void* physical, void* virtual, u32 size, u32 flags) {
+    u32 phys = (u32)physical & ~0xFFF;
+    u32 virt = (u32)virtual & ~0xFFF;
+    u32 end = virt + ((size + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1));
+    u32 start = virt;
+    u32 irq = spin_lock_irqsave(&vmm_lock);
+    
+    while (virt < end) {
+        u32 pd_index = PD_INDEX(virt);
+        u32 entry = vmm.page_directory[pd_index];
         
-        // Zera a tabela de páginas
-        for (int i = 0; i < 1024; i++) {
-            page_table[i] = 0;
+        // Página de 4MB: endereços alinhados, faixa suficiente e nenhuma tabela no caminho
+        if (vmm.large_pages && !(phys & (LARGE_PAGE_SIZE - 1)) && !(virt & (LARGE_PAGE_SIZE - 1)) &&
+            end - virt >= LARGE_PAGE_SIZE && (!(entry & PAGE_PRESENT) || (entry & PAGE_LARGE))) {
+            vmm.page_directory[pd_index] = phys | PAGE_PRESENT | PAGE_LARGE | flags;
+            if (VMM_IS_KERNEL_PDE(pd_index)) {
+                vmm_sync_kernel_pde(pd_index);
+            }
+            phys += LARGE_PAGE_SIZE;
+            virt += LARGE_PAGE_SIZE;
+            continue;
         }
         
-        // Adiciona a tabela ao diretório
-        vmm.page_directory[pd_index] = (u32)page_table | PAGE_PRESENT | PAGE_WRITE | flags;
+        if (!vmm_install_page(phys, virt, flags)) break;
+        phys += PAGE_SIZE;
+        virt += PAGE_SIZE;
     }
     
-    // Obtém a tabela de páginas
-    u32* page_table = (u32*)(vmm.page_directory[pd_index] & ~0xFFF);
+    vmm_flush_range(start, (virt - start) / PAGE_SIZE, flags & PAGE_GLOBAL);
+    spin_unlock_irqrestore(&vmm_lock, irq);
+}
+
+// Desmapeia uma faixa de endereços virtuais
+void vmm_unmap_range(void* virtual, u32 size) {
+    u32 virt = (u32)virtual & ~0xFFF;
+    u32 end = virt + ((size + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1));
+    u32 start = virt;
+    u32 global = 0;
+    u32 irq = spin_lock_irqsave(&vmm_lock);
     
-    // Mapeia a página
-    page_table[pt_index] = (u32)physical | PAGE_PRESENT | flags;
+    while (virt < end) {
+        u32 pd_index = PD_INDEX(virt);
+        u32 entry = vmm.page_directory[pd_index];
+        
+        if (!(entry & PAGE_PRESENT)) {
+            // Nada mapeado até a próxima entrada do diretório
+            virt = (virt & 0xFFC00000) + LARGE_PAGE_SIZE;
+            continue;
+        }
+        
+        global |= entry & PAGE_GLOBAL;
+        
+        // Página de 4MB coberta por inteiro: remove a entrada do diretório
+        if ((entry & PAGE_LARGE) && !(virt & (LARGE_PAGE_SIZE - 1)) && end - virt >= LARGE_PAGE_SIZE) {
+            vmm.page_directory[pd_index] = 0;
+            if (VMM_IS_KERNEL_PDE(pd_index)) {
+                vmm_sync_kernel_pde(pd_index);
+            }
+            virt += LARGE_PAGE_SIZE;
+            continue;
+        }
+        
+        u32* page_table = (entry & PAGE_LARGE) ? vmm_get_table(pd_index, 0) : VMM_TABLE(pd_index);
+        if (!page_table) break;
+        global |= page_table[PT_INDEX(virt)] & PAGE_GLOBAL;
+        page_table[PT_INDEX(virt)] = 0;
+        virt += PAGE_SIZE;
+    }
     
-    // Atualiza o TLB
-    asm volatile("invlpg (%0)" : : "r"(virtual));
+    if (end > start) {
+        vmm_flush_range(start, (end - start) / PAGE_SIZE, global);
+    }
+    spin_unlock_irqrestore(&vmm_lock, irq);
 }
 
-// Desmapeia uma página virtual
-void vmm_unmap_page(void* virtual) {
+// Obtém o endereço físico mapeado em um endereço virtual (0 se não mapeado)
+u32 vmm_get_physical(void* virtual) {
     u32 pd_index = PD_INDEX((u32)virtual);
     u32 pt_index = PT_INDEX((u32)virtual);
     
-    // Verifica se a tabela de páginas existe
-    if (vmm.page_directory[pd_index] & PAGE_PRESENT) {
-        // Obtém a tabela de páginas
-        u32* page_table = (u32*)(vmm.page_directory[pd_index] & ~0xFFF);
+    u32 directory_entry = vmm.page_directory[pd_index];
+    if (!(directory_entry & PAGE_PRESENT)) return 0;
+    if (directory_entry & PAGE_LARGE) {
+        return (directory_entry & 0xFFC00000) | ((u32)virtual & (LARGE_PAGE_SIZE - 1));
+    }
+    
+    u32 entry = VMM_TABLE(pd_index)[pt_index];
+    if (!(entry & PAGE_PRESENT)) return 0;
+    
+    return (entry & ~0xFFF) | ((u32)virtual & 0xFFF);
+}
+
+// Cria um espaço de endereçamento que compartilha as entradas do kernel
+u32* vmm_create_address_space() {
+    vmm_space_t* space = (vmm_space_t*)kmalloc(sizeof(vmm_space_t));
+    if (!space) return NULL;
+    
+    u32 frame = (u32)pmm_alloc_frame();
+    if (!frame) {
+        kfree(space);
+        return NULL;
+    }
+    
+    // As entradas do kernel são copiadas do diretório ativo, que está sempre atualizado
+    // (sob a trava, para que nenhuma entrada nova do kernel fique de fora)
+    u32 irq = spin_lock_irqsave(&vmm_lock);
+    u32* directory = (u32*)vmm_map_window(VMM_WINDOW_DIRECTORY, frame);
+    for (u32 i = 0; i < VMM_RECURSIVE_PDE; i++) {
+        directory[i] = VMM_IS_KERNEL_PDE(i) ? vmm.page_directory[i] : 0;
+    }
+    directory[VMM_RECURSIVE_PDE] = frame | PAGE_PRESENT | PAGE_WRITE;
+    vmm_unmap_window(VMM_WINDOW_DIRECTORY);
+    
+    space->page_directory = frame;
+    space->next = vmm.spaces;
+    vmm.spaces = space;
+    spin_unlock_irqrestore(&vmm_lock, irq);
+    
+    return (u32*)frame;
+}
+
+// Destrói um espaço de endereçamento e libera a sua parte de usuário
+void vmm_destroy_address_space(u32* page_directory) {
+    u32 frame = (u32)page_directory;
+    if (!frame || frame == vmm.kernel_directory) return;
+    
+    // Não é possível liberar o diretório em uso
+    if (frame == VMM_CURRENT_DIRECTORY) {
+        vmm_switch_address_space((u32*)vmm.kernel_directory);
+    }
+    
+    // Remove o espaço da lista
+    u32 irq = spin_lock_irqsave(&vmm_lock);
+    vmm_space_t** link = &vmm.spaces;
+    while (*link && (*link)->page_directory != frame) {
+        link = &(*link)->next;
+    }
+    if (!*link) {
+        spin_unlock_irqrestore(&vmm_lock, irq);
+        return;
+    }
+    vmm_space_t* space = *link;
+    *link = space->next;
+    
+    // Libera as páginas e tabelas da parte de usuário
+    u32* directory = (u32*)vmm_map_window(VMM_WINDOW_DIRECTORY, frame);
+    for (u32 i = 0; i < VMM_RECURSIVE_PDE; i++) {
+        if (VMM_IS_KERNEL_PDE(i)) continue;
         
-        // Desmapeia a página
-        page_table[pt_index] = 0;
+        u32 entry = directory[i];
+        if (!(entry & PAGE_PRESENT) || (entry & PAGE_LARGE)) continue;
         
-        // Atualiza o TLB
-        asm volatile("invlpg (%0)" : : "r"(virtual));
+        u32* page_table = (u32*)vmm_map_window(VMM_WINDOW_TABLE, entry);
+        for (u32 j = 0; j < 1024; j++) {
+            if (page_table[j] & PAGE_PRESENT) {
+                // Páginas copy-on-write podem continuar em uso por outro espaço
+                pmm_unref_frame((void*)(page_table[j] & ~0xFFF));
+            }
+        }
+        pmm_free_frame((void*)(entry & ~0xFFF));
+    }
+    vmm_unmap_window(VMM_WINDOW_TABLE);
+    vmm_unmap_window(VMM_WINDOW_DIRECTORY);
+    
+    pmm_free_frame((void*)frame);
+    
+    // Descarta as faixas sob demanda do espaço
+    for (u32 i = 0; i < lazy_region_count;) {
+        if (lazy_regions[i].directory == frame) {
+            lazy_regions[i] = lazy_regions[--lazy_region_count];
+        } else {
+            i++;
+        }
     }
+    spin_unlock_irqrestore(&vmm_lock, irq);
+    
+    kfree(space);
+}
+
+// Ativa um espaço de endereçamento
+void vmm_switch_address_space(u32* page_directory) {
+    u32 frame = (u32)page_directory;
+    if (!frame || frame == VMM_CURRENT_DIRECTORY) return;
+    
+    vmm.current_directory = frame;
+    vmm.page_directory = VMM_DIRECTORY(frame);
+    cpu_write_cr3(frame);
+}
+
+// Obtém o endereço físico do diretório do kernel
+u32* vmm_get_kernel_directory() {
+    return (u32*)vmm.kernel_directory;
+}
+
+// Reserva uma faixa virtual com alocação sob demanda
+void vmm_reserve_lazy(void* virtual, u32 size, u32 flags) {
+    u32 start = (u32)virtual & ~0xFFF;
+    u32 end = ((u32)virtual + size + PAGE_SIZE - 1) & ~0xFFF;
+    u32 directory = VMM_IS_KERNEL_PDE(PD_INDEX(start)) ? 0 : VMM_CURRENT_DIRECTORY;
+    u32 irq = spin_lock_irqsave(&vmm_lock);
+    
+    // Estende uma faixa adjacente com as mesmas características
+    for (u32 i = 0; i < lazy_region_count; i++) {
+        vmm_lazy_region_t* region = &lazy_regions[i];
+        if (region->directory == directory && region->flags == flags && region->end == start) {
+            region->end = end;
+            spin_unlock_irqrestore(&vmm_lock, irq);
+            return;
+        }
+    }
+    
+    if (lazy_region_count < VMM_MAX_LAZY_REGIONS) {
+        vmm_lazy_region_t* region = &lazy_regions[lazy_region_count++];
+        region->start = start;
+        region->end = end;
+        region->flags = flags;
+        region->directory = directory;
+    }
+    spin_unlock_irqrestore(&vmm_lock, irq);
+}
+
+// Procura a faixa sob demanda que contém um endereço no espaço ativo (vmm_lock travado)
+static vmm_lazy_region_t* vmm_find_lazy_region(u32 address) {
+    u32 directory = VMM_CURRENT_DIRECTORY;
+    for (u32 i = 0; i < lazy_region_count; i++) {
+        vmm_lazy_region_t* region = &lazy_regions[i];
+        if (address >= region->start && address < region->end &&
+            (!region->directory || region->directory == directory)) {
+            return region;
+        }
+    }
+    return NULL;
+}
+
+// Escrita em uma página copy-on-write: copia o frame, a menos que este espaço
+// seja o último a usá-lo, caso em que basta devolver a permissão de escrita
+// Chamada com vmm_lock travado
+static u32 vmm_handle_cow(u32 page) {
+    u32 pd_index = PD_INDEX(page);
+    u32 directory_entry = vmm.page_directory[pd_index];
+    if (!(directory_entry & PAGE_PRESENT) || (directory_entry & PAGE_LARGE)) return 0;
+    
+    u32* entry = &VMM_TABLE(pd_index)[PT_INDEX(page)];
+    if (!(*entry & PAGE_PRESENT) || !(*entry & PAGE_COW)) return 0;
+    
+    u32 frame = *entry & ~0xFFF;
+    u32 flags = (*entry & 0xFFF & ~PAGE_COW) | PAGE_WRITE;
+    
+    if (!pmm.frame_refs[frame / FRAME_SIZE]) {
+        *entry = frame | flags;
+        cpu_invlpg((void*)page);
+        return 1;
+    }
+    
+    u32 copy = (u32)pmm_alloc_frame();
+    if (!copy) return 0;
+    
+    kmemcpy(vmm_map_window(VMM_WINDOW_COPY, copy), (void*)page, PAGE_SIZE);
+    vmm_unmap_window(VMM_WINDOW_COPY);
+    
+    *entry = copy | flags;
+    cpu_invlpg((void*)page);
+    pmm_unref_frame((void*)frame);
+    return 1;
+}
+
+// Tratador da falha de página (vetor 14)
+static void vmm_page_fault(interrupt_frame_t* frame) {
+    u32 address = cpu_read_cr2();
+    u32 page = address & ~0xFFF;
+    
+    u32 irq = spin_lock_irqsave(&vmm_lock);
+    
+    if (!(frame->err_code & PF_PRESENT)) {
+        // Primeiro acesso a uma faixa sob demanda: entrega um frame zerado
+        vmm_lazy_region_t* region = vmm_find_lazy_region(address);
+        if (region) {
+            // Outra CPU pode ter atendido a mesma página enquanto esta esperava a trava
+            if (vmm_get_physical((void*)page)) {
+                spin_unlock_irqrestore(&vmm_lock, irq);
+                return;
+            }
+            
+            // O frame chega zerado, mesmo que a página seja somente leitura
+            u32 physical = (u32)pmm_alloc_zeroed_frame();
+            if (physical && vmm_install_page(physical, page, region->flags)) {
+                cpu_invlpg((void*)page);
+                spin_unlock_irqrestore(&vmm_lock, irq);
+                return;
+            }
+        }
+    } else if (frame->err_code & PF_WRITE) {
+        if (vmm_handle_cow(page)) {
+            spin_unlock_irqrestore(&vmm_lock, irq);
+            return;
+        }
+    }
+    
+    spin_unlock_irqrestore(&vmm_lock, irq);
+    
+    // Acesso inválido ou sem memória: não há como continuar
+    vga_write("\nFalha de pagina em ");
+    vga_write_hex(address);
+    vga_write(" (eip=");
+    vga_write_hex(frame->eip);
+    vga_write(" erro=");
+    vga_write_hex(frame->err_code);
+    vga_write(")\n");
+    cpu_halt();
+}
+
+// Cria uma cópia do espaço ativo com as páginas de usuário em copy-on-write
+u32* vmm_clone_address_space() {
+    u32* child = vmm_create_address_space();
+    if (!child) return NULL;
+    
+    u32 irq = spin_lock_irqsave(&vmm_lock);
+    for (u32 i = 0; i < VMM_RECURSIVE_PDE; i++) {
+        if (VMM_IS_KERNEL_PDE(i)) continue;
+        
+        u32 entry = vmm.page_directory[i];
+        if (!(entry & PAGE_PRESENT)) continue;
+        
+        // Páginas de 4MB de usuário são divididas para serem compartilhadas por página
+        u32* source = vmm_get_table(i, entry & PAGE_USER);
+        u32 table = (u32)pmm_alloc_frame();
+        if (!source || !table) break;
+        
+        u32* child_table = (u32*)vmm_map_window(VMM_WINDOW_TABLE, table);
+        for (u32 j = 0; j < 1024; j++) {
+            u32 pte = source[j];
+            if (pte & PAGE_PRESENT) {
+                // Páginas graváveis passam a ser somente leitura nos dois espaços
+                if (pte & (PAGE_WRITE | PAGE_COW)) {
+                    pte = (pte & ~PAGE_WRITE) | PAGE_COW;
+                    source[j] = pte;
+                }
+                pmm_ref_frame((void*)(pte & ~0xFFF));
+            }
+            child_table[j] = pte;
+        }
+        
+        u32* child_directory = (u32*)vmm_map_window(VMM_WINDOW_DIRECTORY, (u32)child);
+        child_directory[i] = table | (vmm.page_directory[i] & 0xFFF);
+    }
+    vmm_unmap_window(VMM_WINDOW_TABLE);
+    vmm_unmap_window(VMM_WINDOW_DIRECTORY);
+    
+    // As permissões do espaço ativo mudaram
+    vmm_flush_all(0);
+    
+    // O filho herda as faixas sob demanda do pai
+    u32 count = lazy_region_count;
+    u32 directory = VMM_CURRENT_DIRECTORY;
+    for (u32 i = 0; i < count && lazy_region_count < VMM_MAX_LAZY_REGIONS; i++) {
+        if (lazy_regions[i].directory == directory) {
+            lazy_regions[lazy_region_count] = lazy_regions[i];
+            lazy_regions[lazy_region_count].directory = (u32)child;
+            lazy_region_count++;
+        }
+    }
+    spin_unlock_irqrestore(&vmm_lock, irq);
+    
+    return child;
 }
 
 // Estrutura para o heap do kernel
 #define HEAP_START 0xD0000000
 #define HEAP_INITIAL_SIZE 0x100000 // 1MB
+#define HEAP_MAX_SIZE 0x10000000   // 256MB
+#define HEAP_GROW_MIN 0x10000      // O heap cresce no mínimo 64KB por vez
 
+// Cada bloco tem um cabeçalho e um rodapé (boundary tag) com o seu tamanho,
+// o que permite encontrar o vizinho anterior em O(1) ao liberar
 typedef struct {
     u32 magic;     // Assinatura para detectar corrupção
-    u32 size;      // Tamanho do bloco
-    u8 is_free;    // 1 se livre, 0 se alocado
+    u32 size;      // Tamanho total do bloco (cabeçalho + dados + rodapé), bit 0 = livre
 } block_header_t;
 
+// Blocos livres guardam as ligações da lista da sua classe na área de dados
+typedef struct free_block {
+    block_header_t header;
+    struct free_block* next_free;
+    struct free_block* prev_free;
+} free_block_t;
+
+#define BLOCK_MAGIC 0xDEADBEEF
+#define BLOCK_FREE 0x1
+#define BLOCK_ALIGN 8
+#define BLOCK_OVERHEAD (sizeof(block_header_t) + sizeof(u32))
+// Menor bloco: cabeçalho + ligações + rodapé, alinhado a 8
+#define BLOCK_MIN_SIZE ((sizeof(free_block_t) + sizeof(u32) + BLOCK_ALIGN - 1) & ~(BLOCK_ALIGN - 1))
+#define BLOCK_SIZE(block) ((block)->size & ~(BLOCK_ALIGN - 1))
+#define BLOCK_IS_FREE(block) ((block)->size & BLOCK_FREE)
+#define BLOCK_FOOTER(block) ((u32*)((u32)(block) + BLOCK_SIZE(block) - sizeof(u32)))
+#define BLOCK_NEXT(block) ((block_header_t*)((u32)(block) + BLOCK_SIZE(block)))
+#define BLOCK_DATA(block) ((void*)((u32)(block) + sizeof(block_header_t)))
+
+// Classes de tamanho: a classe c guarda blocos com tamanho em [2^c, 2^(c+1))
+#define HEAP_CLASSES 32
+// Quantos blocos da própria classe são examinados antes de subir de classe
+#define HEAP_CLASS_SCAN 8
+
 static void* heap_start = (void*)HEAP_START;
 static void* heap_end = (void*)(HEAP_START + HEAP_INITIAL_SIZE);
-static block_header_t* first_block = NULL;
+static free_block_t* heap_classes[HEAP_CLASSES];
+static u32 heap_class_bitmap = 0; // Bit c ligado se a classe c não está vazia
 
-#define BLOCK_MAGIC 0xDEADBEEF
+// Classe de tamanho de um bloco
+static inline u32 heap_class(u32 size) {
+    return cpu_bsr(size);
+}
+
+// Escreve cabeçalho e rodapé de um bloco
+static inline void heap_set_block(block_header_t* block, u32 size, u32 is_free) {
+    block->magic = BLOCK_MAGIC;
+    block->size = size | (is_free ? BLOCK_FREE : 0);
+    *BLOCK_FOOTER(block) = block->size;
+}
+
+// Insere um bloco livre na lista da sua classe
+static void heap_list_insert(block_header_t* block) {
+    free_block_t* free_block = (free_block_t*)block;
+    u32 c = heap_class(BLOCK_SIZE(block));
+    
+    free_block->prev_free = NULL;
+    free_block->next_free = heap_classes[c];
+    if (heap_classes[c]) {
+        heap_classes[c]->prev_free = free_block;
+    }
+    heap_classes[c] = free_block;
+    heap_class_bitmap |= 1 << c;
+}
+
+// Remove um bloco livre da lista da sua classe
+static void heap_list_remove(block_header_t* block) {
+    free_block_t* free_block = (free_block_t*)block;
+    u32 c = heap_class(BLOCK_SIZE(block));
+    
+    if (free_block->prev_free) {
+        free_block->prev_free->next_free = free_block->next_free;
+    } else {
+        heap_classes[c] = free_block->next_free;
+    }
+    if (free_block->next_free) {
+        free_block->next_free->prev_free = free_block->prev_free;
+    }
+    if (!heap_classes[c]) {
+        heap_class_bitmap &= ~(1 << c);
+    }
+}
+
+// Mescla um bloco livre (fora das listas) com os vizinhos livres
+static block_header_t* heap_coalesce(block_header_t* block) {
+    u32 size = BLOCK_SIZE(block);
+    
+    // Vizinho seguinte: o epílogo nunca está livre
+    block_header_t* next = BLOCK_NEXT(block);
+    if (BLOCK_IS_FREE(next)) {
+        heap_list_remove(next);
+        size += BLOCK_SIZE(next);
+    }
+    
+    // Vizinho anterior: encontrado pelo rodapé; o prólogo nunca está livre
+    u32 prev_footer = *(u32*)((u32)block - sizeof(u32));
+    if (prev_footer & BLOCK_FREE) {
+        block_header_t* prev = (block_header_t*)((u32)block - (prev_footer & ~(BLOCK_ALIGN - 1)));
+        heap_list_remove(prev);
+        size += BLOCK_SIZE(prev);
+        block = prev;
+    }
+    
+    heap_set_block(block, size, 1);
+    return block;
+}
+
+// Reduz um bloco alocado para size bytes, devolvendo a sobra ao heap
+static void heap_split(block_header_t* block, u32 size) {
+    if (BLOCK_SIZE(block) < size + BLOCK_MIN_SIZE) return;
+    u32 remaining = BLOCK_SIZE(block) - size;
+    
+    heap_set_block(block, size, 0);
+    block_header_t* rest = BLOCK_NEXT(block);
+    heap_set_block(rest, remaining, 1);
+    heap_list_insert(heap_coalesce(rest));
+}
+
+// Procura um bloco livre de pelo menos size bytes
+static block_header_t* heap_find(u32 size) {
+    u32 c = heap_class(size);
+    
+    // Alguns blocos da própria classe podem servir
+    free_block_t* candidate = heap_classes[c];
+    for (u32 n = 0; candidate && n < HEAP_CLASS_SCAN; n++) {
+        if (BLOCK_SIZE(&candidate->header) >= size) {
+            return &candidate->header;
+        }
+        candidate = candidate->next_free;
+    }
+    
+    // Qualquer bloco de uma classe maior serve: pega o primeiro da menor delas
+    u32 larger = (c + 1 < HEAP_CLASSES) ? heap_class_bitmap & ~((2u << c) - 1) : 0;
+    if (larger) {
+        return &heap_classes[cpu_bsf(larger)]->header;
+    }
+    
+    // Último recurso antes de crescer: o restante da própria classe
+    for (; candidate; candidate = candidate->next_free) {
+        if (BLOCK_SIZE(&candidate->header) >= size) {
+            return &candidate->header;
+        }
+    }
+    
+    return NULL;
+}
+
+// Estende o heap e devolve o novo bloco livre (fora das listas)
+// A janela inteira do heap é reservada sob demanda em heap_init, então crescer
+// só move o fim do heap: os frames chegam pelo tratador de falha de página
+// quando as novas páginas forem tocadas
+static block_header_t* heap_grow(u32 size) {
+    u32 bytes = size < HEAP_GROW_MIN ? HEAP_GROW_MIN : size;
+    bytes = (bytes + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1);
+    if ((u32)heap_end + bytes > HEAP_START + HEAP_MAX_SIZE) {
+        return NULL;
+    }
+    u32 end = (u32)heap_end + bytes;
+    
+    // O antigo epílogo vira o cabeçalho do novo bloco; um novo epílogo fecha o heap
+    block_header_t* block = (block_header_t*)((u32)heap_end - sizeof(block_header_t));
+    heap_end = (void*)end;
+    heap_set_block(block, bytes, 1);
+    block_header_t* epilogue = BLOCK_NEXT(block);
+    epilogue->magic = BLOCK_MAGIC;
+    epilogue->size = 0;
+    
+    return heap_coalesce(block);
+}
 
 // Inicializa o heap do kernel
 void heap_init() {
-    // Mapeia as páginas para o heap inicial
-    for (u32 addr = (u32)heap_start; addr < (u32)heap_end; addr += PAGE_SIZE) {
-        void* physical = pmm_alloc_frame();
-        vmm_map_page(physical, (void*)addr, PAGE_WRITE);
+    u32 flags = PAGE_WRITE | vmm.kernel_flags;
+    
+    // Reserva a janela inteira do heap sem alocar frames
+    vmm_reserve_lazy(heap_start, HEAP_MAX_SIZE, flags);
+    
+    // Com PSE, o heap inicial é uma única página de 4MB vinda do buddy:
+    // uma entrada de diretório, uma entrada de TLB e nenhuma tabela de páginas
+    void* large = vmm.large_pages ? pmm_alloc_order(BUDDY_MAX_ORDER) : 0;
+    if (large) {
+        vmm_map_range(large, heap_start, LARGE_PAGE_SIZE, flags);
+        heap_end = (void*)((u32)heap_start + LARGE_PAGE_SIZE);
+    } else {
+        heap_end = (void*)((u32)heap_start + HEAP_INITIAL_SIZE);
+    }
+    
+    for (u32 c = 0; c < HEAP_CLASSES; c++) {
+        heap_classes[c] = NULL;
     }
+    heap_class_bitmap = 0;
+    
+    // Prólogo: rodapé de um bloco ocupado fictício, para a mescla com o anterior
+    // Epílogo: cabeçalho ocupado de tamanho 0, para a mescla com o seguinte
+    u32* prologue = (u32*)heap_start;
+    prologue[0] = 0;
+    prologue[1] = 0;
+    
+    block_header_t* first_block = (block_header_t*)((u32)heap_start + BLOCK_ALIGN);
+    u32 size = (u32)heap_end - (u32)first_block - sizeof(block_header_t);
+    heap_set_block(first_block, size, 1);
+    
+    block_header_t* epilogue = BLOCK_NEXT(first_block);
+    epilogue->magic = BLOCK_MAGIC;
+    epilogue->size = 0;
     
-    // Inicializa o primeiro bloco
-    first_block = (block_header_t*)heap_start;
-    first_block->magic = BLOCK_MAGIC;
-    first_block->size = HEAP_INITIAL_SIZE - sizeof(block_header_t);
-    first_block->is_free = 1;
+    heap_list_insert(first_block);
+}
+
+// Aloca memória no heap do kernel (heap_lock travado)
+static void* kmalloc_locked(u32 size) {
+    if (!size) return NULL;
+    
+    // Tamanho total do bloco, alinhado a 8 bytes
+    u32 needed = (size + BLOCK_OVERHEAD + BLOCK_ALIGN - 1) & ~(BLOCK_ALIGN - 1);
+    if (needed < BLOCK_MIN_SIZE) needed = BLOCK_MIN_SIZE;
+    
+    block_header_t* block = heap_find(needed);
+    if (block) {
+        heap_list_remove(block);
+    } else {
+        // Nenhuma classe tem espaço: mapeia mais memória
+        block = heap_grow(needed);
+        if (!block) return NULL;
+    }
+    
+    heap_set_block(block, BLOCK_SIZE(block), 0);
+    heap_split(block, needed);
+    return BLOCK_DATA(block);
+}
+
+// Libera memória no heap do kernel (heap_lock travado)
+static void kfree_locked(void* ptr) {
+    if (!ptr) return;
+    
+    // Obtém o cabeçalho do bloco
+    block_header_t* block = (block_header_t*)((u32)ptr - sizeof(block_header_t));
+    
+    // Verifica a assinatura e liberação dupla
+    if (block->magic != BLOCK_MAGIC || BLOCK_IS_FREE(block)) {
+        // Ponteiro inválido
+        return;
+    }
+    
+    // Marca o bloco como livre e mescla com os dois vizinhos em O(1)
+    heap_set_block(block, BLOCK_SIZE(block), 1);
+    heap_list_insert(heap_coalesce(block));
 }
 
 // Aloca memória no heap do kernel
 void* kmalloc(u32 size) {
-    // Alinha o tamanho a 4 bytes
-    if (size % 4 != 0) {
-        size += 4 - (size % 4);
+    u32 flags = spin_lock_irqsave(&heap_lock);
+    void* ptr = kmalloc_locked(size);
+    spin_unlock_irqrestore(&heap_lock, flags);
+    return ptr;
+}
+
+// Aloca memória com o endereço alinhado a align (potência de 2)
+void* kmalloc_aligned(u32 size, u32 align) {
+    if (align <= BLOCK_ALIGN) return kmalloc(size);
+    if (!size) return NULL;
+    
+    u32 needed = (size + BLOCK_OVERHEAD + BLOCK_ALIGN - 1) & ~(BLOCK_ALIGN - 1);
+    if (needed < BLOCK_MIN_SIZE) needed = BLOCK_MIN_SIZE;
+    
+    // Reserva folga para alinhar e para separar um bloco livre à frente
+    u32 flags = spin_lock_irqsave(&heap_lock);
+    u32 data = (u32)kmalloc_locked(needed + align + BLOCK_MIN_SIZE);
+    if (!data) {
+        spin_unlock_irqrestore(&heap_lock, flags);
+        return NULL;
     }
     
-    // Procura um bloco livre grande o suficiente
-    block_header_t* current = first_block;
-    while (current) {
-        // Verifica a assinatura
-        if (current->magic != BLOCK_MAGIC) {
-            // Heap corrompido
-            return NULL;
-        }
-        
-        if (current->is_free && current->size >= size) {
-            // Encontrou um bloco adequado
-            
-            // Verifica se vale a pena dividir o bloco
-            if (current->size > size + sizeof(block_header_t) + 4) {
-                // Divide o bloco
-                block_header_t* new_block = (block_header_t*)((u32)current + sizeof(block_header_t) + size);
-                new_block->magic = BLOCK_MAGIC;
-                new_block->size = current->size - size - sizeof(block_header_t);
-                new_block->is_free = 1;
-                
-                current->size = size;
-            }
-            
-            current->is_free = 0;
-            return (void*)((u32)current + sizeof(block_header_t));
-        }
+    u32 aligned = (data + align - 1) & ~(align - 1);
+    if (aligned != data) {
+        while (aligned - data < BLOCK_MIN_SIZE) aligned += align;
         
-        // Avança para o próximo bloco
-        if (current->size == 0) break; // Evita loop infinito
-        current = (block_header_t*)((u32)current + sizeof(block_header_t) + current->size);
+        // Devolve a parte da frente como um bloco livre próprio;
+        // o vizinho anterior está ocupado, então não há o que mesclar
+        block_header_t* block = (block_header_t*)(data - sizeof(block_header_t));
+        u32 total = BLOCK_SIZE(block);
+        u32 front = aligned - data;
+        heap_set_block(block, front, 1);
+        heap_list_insert(block);
         
-        // Verifica se chegou ao fim do heap
-        if ((u32)current >= (u32)heap_end) {
-            break;
-        }
+        block = (block_header_t*)(aligned - sizeof(block_header_t));
+        heap_set_block(block, total - front, 0);
     }
     
-    // Não encontrou bloco adequado
-    return NULL;
+    // Devolve a sobra do fim
+    heap_split((block_header_t*)(aligned - sizeof(block_header_t)), needed);
+    spin_unlock_irqrestore(&heap_lock, flags);
+    
+    return (void*)aligned;
 }
 
 // Libera memória no heap do kernel
 void kfree(void* ptr) {
     if (!ptr) return;
     
-    // Obtém o cabeçalho do bloco
-    block_header_t* block = (block_header_t*)((u32)ptr - sizeof(block_header_t));
+    u32 flags = spin_lock_irqsave(&heap_lock);
+    kfree_locked(ptr);
+    spin_unlock_irqrestore(&heap_lock, flags);
+}
+
+// Redimensiona um bloco do heap (heap_lock travado)
+static void* krealloc_locked(void* ptr, u32 size) {
+    if (!ptr) return kmalloc_locked(size);
+    if (!size) {
+        kfree_locked(ptr);
+        return NULL;
+    }
     
-    // Verifica a assinatura
-    if (block->magic != BLOCK_MAGIC) {
-        // Ponteiro inválido
-        return;
+    block_header_t* block = (block_header_t*)((u32)ptr - sizeof(block_header_t));
+    if (block->magic != BLOCK_MAGIC || BLOCK_IS_FREE(block)) {
+        return NULL;
     }
     
-    // Marca o bloco como livre
-    block->is_free = 1;
+    u32 needed = (size + BLOCK_OVERHEAD + BLOCK_ALIGN - 1) & ~(BLOCK_ALIGN - 1);
+    if (needed < BLOCK_MIN_SIZE) needed = BLOCK_MIN_SIZE;
+    u32 current = BLOCK_SIZE(block);
+    
+    // Encolhe no lugar
+    if (needed <= current) {
+        heap_split(block, needed);
+        return ptr;
+    }
     
-    // Tenta mesclar com o próximo bloco se estiver livre
-    block_header_t* next = (block_header_t*)((u32)block + sizeof(block_header_t) + block->size);
-    if ((u32)next < (u32)heap_end && next->magic == BLOCK_MAGIC && next->is_free) {
-        block->size += sizeof(block_header_t) + next->size;
+    // Cresce no lugar absorvendo o vizinho seguinte, se estiver livre
+    block_header_t* next = BLOCK_NEXT(block);
+    if (BLOCK_IS_FREE(next) && current + BLOCK_SIZE(next) >= needed) {
+        heap_list_remove(next);
+        heap_set_block(block, current + BLOCK_SIZE(next), 0);
+        heap_split(block, needed);
+        return ptr;
     }
     
-    // Tenta mesclar com o bloco anterior se estiver livre
-    // (Isso exigiria uma lista duplamente encadeada ou uma varredura do início,
-    // o que não é implementado neste exemplo simplificado)
+    // Move para um novo bloco
+    u8* new_ptr = (u8*)kmalloc_locked(size);
+    if (!new_ptr) return NULL;
+    
+    kmemcpy(new_ptr, ptr, current - BLOCK_OVERHEAD);
+    
+    kfree_locked(ptr);
+    return new_ptr;
+}
+
+// Redimensiona um bloco do heap, preservando o conteúdo
+void* krealloc(void* ptr, u32 size) {
+    u32 flags = spin_lock_irqsave(&heap_lock);
+    void* new_ptr = krealloc_locked(ptr, size);
+    spin_unlock_irqrestore(&heap_lock, flags);
+    return new_ptr;
+}
+
+// Percorre todos os blocos do heap e resume o seu estado
+void heap_get_stats(heap_stats_t* stats) {
+    u32 flags = spin_lock_irqsave(&heap_lock);
+    stats->heap_size = (u32)heap_end - (u32)heap_start;
+    stats->used_bytes = 0;
+    stats->free_bytes = 0;
+    stats->largest_free = 0;
+    stats->used_blocks = 0;
+    stats->free_blocks = 0;
+    
+    block_header_t* block = (block_header_t*)((u32)heap_start + BLOCK_ALIGN);
+    while (BLOCK_SIZE(block)) {
+        u32 size = BLOCK_SIZE(block);
+        if (BLOCK_IS_FREE(block)) {
+            stats->free_bytes += size;
+            stats->free_blocks++;
+            if (size > stats->largest_free) stats->largest_free = size;
+        } else {
+            stats->used_bytes += size;
+            stats->used_blocks++;
+        }
+        block = BLOCK_NEXT(block);
+    }
+    spin_unlock_irqrestore(&heap_lock, flags);
 }
@@ -0,0 +1,113 @@
+#include "../include/slab.h"
+#include "../include/memory.h"
+
+// Tamanho mínimo de memória de objetos em cada slab
+#define KMEM_SLAB_BYTES 4096
+// Número mínimo de objetos por slab (para objetos grandes, como pilhas)
+#define KMEM_MIN_OBJECTS 4
+
+// Lista de caches registrados
+static kmem_cache_t* cache_list = NULL;
+static spinlock_t cache_list_lock = SPINLOCK_INIT;
+
+// A ligação da lista livre fica logo após o objeto, para que o conteúdo
+// construído do objeto seja preservado enquanto ele está no cache
+#define KMEM_LINK(cache, object) (*(void**)((u32)(object) + (cache)->stride - sizeof(void*)))
+
+// Cria um cache de objetos
+kmem_cache_t* kmem_cache_create(const char* name, u32 size, u32 align, void (*ctor)(void*)) {
+    kmem_cache_t* cache = (kmem_cache_t*)kmalloc(sizeof(kmem_cache_t));
+    if (!cache) return NULL;
+    
+    // Copia o nome
+    int i;
+    for (i = 0; i < 31 && name[i]; i++) {
+        cache->name[i] = name[i];
+    }
+    cache->name[i] = '\0';
+    
+    // O alinhamento mínimo é o de um ponteiro e deve ser potência de 2
+    if (align < sizeof(void*)) align = sizeof(void*);
+    
+    // Calcula a distância entre objetos (objeto + ligação, alinhado)
+    u32 stride = (size + 3) & ~3;
+    stride += sizeof(void*);
+    stride = (stride + align - 1) & ~(align - 1);
+    
+    cache->object_size = size;
+    cache->stride = stride;
+    cache->align = align;
+    cache->objects_per_slab = KMEM_SLAB_BYTES / stride;
+    if (cache->objects_per_slab < KMEM_MIN_OBJECTS) {
+        cache->objects_per_slab = KMEM_MIN_OBJECTS;
+    }
+    cache->ctor = ctor;
+    cache->free_list = NULL;
+    cache->slabs = NULL;
+    cache->total_objects = 0;
+    cache->active_objects = 0;
+    spin_init(&cache->lock);
+    
+    // Registra o cache
+    u32 flags = spin_lock_irqsave(&cache_list_lock);
+    cache->next = cache_list;
+    cache_list = cache;
+    spin_unlock_irqrestore(&cache_list_lock, flags);
+    
+    return cache;
+}
+
+// Cria um novo slab e coloca seus objetos na lista livre (trava do cache travada)
+static int kmem_cache_grow(kmem_cache_t* cache) {
+    u32 bytes = sizeof(kmem_slab_t) + cache->align - 1 + cache->objects_per_slab * cache->stride;
+    kmem_slab_t* slab = (kmem_slab_t*)kmalloc(bytes);
+    if (!slab) return 0;
+    
+    slab->next = cache->slabs;
+    cache->slabs = slab;
+    
+    // Primeiro objeto alinhado após o cabeçalho do slab
+    u32 object = ((u32)slab + sizeof(kmem_slab_t) + cache->align - 1) & ~(cache->align - 1);
+    
+    for (u32 i = 0; i < cache->objects_per_slab; i++, object += cache->stride) {
+        if (cache->ctor) {
+            cache->ctor((void*)object);
+        }
+        KMEM_LINK(cache, object) = cache->free_list;
+        cache->free_list = (void*)object;
+    }
+    
+    cache->total_objects += cache->objects_per_slab;
+    return 1;
+}
+
+// Aloca um objeto do cache
+void* kmem_cache_alloc(kmem_cache_t* cache) {
+    if (!cache) return NULL;
+    
+    u32 flags = spin_lock_irqsave(&cache->lock);
+    
+    // Só recorre ao kmalloc quando a lista livre está vazia
+    if (!cache->free_list && !kmem_cache_grow(cache)) {
+        spin_unlock_irqrestore(&cache->lock, flags);
+        return NULL;
+    }
+    
+    void* object = cache->free_list;
+    cache->free_list = KMEM_LINK(cache, object);
+    cache->active_objects++;
+    
+    spin_unlock_irqrestore(&cache->lock, flags);
+    return object;
+}
+
+// Devolve um objeto ao cache
+void kmem_cache_free(kmem_cache_t* cache, void* object) {
+    if (!cache || !object) return;
+    
+    u32 flags = spin_lock_irqsave(&cache->lock);
+    KMEM_LINK(cache, object) = cache->free_list;
+    cache->free_list = object;
+    cache->active_objects--;
+    spin_unlock_irqrestore(&cache->lock, flags);
+}
@@ -0,0 +1,181 @@
+#include "../include/ipc.h"
+#include "../include/memory.h"
+
+// Ordem das travas: port->lock antes das travas do VMM e do PMM; as filas
+// de espera da porta só são usadas com port->lock solta
+
+#define IPC_PAGE_SIZE 4096
+#define IPC_RING_MASK (IPC_RING_SIZE - 1)
+
+// Cria uma porta
+ipc_port_t* ipc_port_create() {
+    ipc_port_t* port = (ipc_port_t*)kmalloc(sizeof(ipc_port_t));
+    if (!port) return NULL;
+    
+    spin_init(&port->lock);
+    port->head = 0;
+    port->tail = 0;
+    port->closed = 0;
+    port->handoffs = 0;
+    wait_queue_init(&port->receivers);
+    wait_queue_init(&port->senders);
+    return port;
+}
+
+// Fecha a porta: mensagens ainda não recebidas são descartadas
+void ipc_port_close(ipc_port_t* port) {
+    u32 flags = spin_lock_irqsave(&port->lock);
+    port->closed = 1;
+    while (port->head != port->tail) {
+        ipc_slot_t* slot = &port->ring[port->head & IPC_RING_MASK];
+        for (u32 i = 0; i < slot->page_count; i++) {
+            pmm_unref_frame((void*)slot->frames[i]);
+        }
+        port->head++;
+    }
+    spin_unlock_irqrestore(&port->lock, flags);
+    
+    wake_up_all(&port->receivers);
+    wake_up_all(&port->senders);
+}
+
+// Fecha e libera a porta
+void ipc_port_destroy(ipc_port_t* port) {
+    if (!port) return;
+    ipc_port_close(port);
+    kfree(port);
+}
+
+// Confere se pages páginas a partir de address cabem na parte privada do espaço
+static u32 ipc_user_range(u32 address, u32 pages) {
+    if (address & (IPC_PAGE_SIZE - 1)) return 0;
+    if (address < USER_SPACE_START || address >= USER_SPACE_END) return 0;
+    return pages <= (USER_SPACE_END - address) / IPC_PAGE_SIZE;
+}
+
+// Envia uma mensagem, com ou sem páginas
+static u32 ipc_send_message(ipc_port_t* port, const void* data, u32 length, u32 address, u32 pages) {
+    if (!port || length > IPC_INLINE_MAX || (length && !data)) return IPC_ERROR_INVALID;
+    if (pages > IPC_MAX_PAGES || (pages && !ipc_user_range(address, pages))) {
+        return IPC_ERROR_INVALID;
+    }
+    
+    // Uma escrita em cada página a torna presente e só deste espaço:
+    // preenche páginas sob demanda e separa páginas copy-on-write, cujo
+    // frame ainda é de outro processo
+    for (u32 i = 0; i < pages; i++) {
+        volatile u8* byte = (volatile u8*)(address + i * IPC_PAGE_SIZE);
+        *byte = *byte;
+    }
+    
+    // Espera espaço no anel
+    u32 flags;
+    while (1) {
+        wait_event(&port->senders, port->closed || port->tail - port->head < IPC_RING_SIZE);
+        flags = spin_lock_irqsave(&port->lock);
+        if (port->closed) {
+            spin_unlock_irqrestore(&port->lock, flags);
+            return IPC_ERROR_CLOSED;
+        }
+        if (port->tail - port->head < IPC_RING_SIZE) break;
+        spin_unlock_irqrestore(&port->lock, flags);
+    }
+    
+    ipc_slot_t* slot = &port->ring[port->tail & IPC_RING_MASK];
+    slot->sender = process_get_current()->pid;
+    slot->length = length;
+    slot->page_count = pages;
+    const u8* bytes = (const u8*)data;
+    for (u32 i = 0; i < length; i++) {
+        slot->data[i] = bytes[i];
+    }
+    
+    // As páginas saem deste espaço sem que o frame seja liberado: a
+    // referência passa para a mensagem
+    for (u32 i = 0; i < pages; i++) {
+        void* page = (void*)(address + i * IPC_PAGE_SIZE);
+        slot->frames[i] = vmm_get_physical(page) & ~0xFFF;
+        vmm_unmap_page(page);
+    }
+    port->tail++;
+    spin_unlock_irqrestore(&port->lock, flags);
+    
+    // Caminho rápido: quem espera a mensagem roda já nesta CPU, em vez de
+    // aguardar a sua vez na fila de prontos
+    u32 receiver = wake_up_one(&port->receivers);
+    if (receiver && scheduler_yield_to(receiver)) {
+        // Outras CPUs podem estar enviando pela mesma porta
+        flags = spin_lock_irqsave(&port->lock);
+        port->handoffs++;
+        spin_unlock_irqrestore(&port->lock, flags);
+    }
+    return IPC_OK;
+}
+
+// Envia uma mensagem pequena
+u32 ipc_send(ipc_port_t* port, const void* data, u32 length) {
+    return ipc_send_message(port, data, length, 0, 0);
+}
+
+// Envia páginas junto com uma mensagem pequena
+u32 ipc_send_pages(ipc_port_t* port, const void* data, u32 length, void* address, u32 pages) {
+    return ipc_send_message(port, data, length, (u32)address, pages);
+}
+
+// Recebe uma mensagem
+u32 ipc_receive(ipc_port_t* port, ipc_message_t* message, void* map_address) {
+    if (!port || !message) return IPC_ERROR_INVALID;
+    
+    // Espera uma mensagem (fechar a porta descarta as que não foram recebidas)
+    u32 flags;
+    while (1) {
+        wait_event(&port->receivers, port->closed || port->head != port->tail);
+        flags = spin_lock_irqsave(&port->lock);
+        if (port->head != port->tail) break;
+        if (port->closed) {
+            spin_unlock_irqrestore(&port->lock, flags);
+            return IPC_ERROR_CLOSED;
+        }
+        spin_unlock_irqrestore(&port->lock, flags);
+    }
+    
+    ipc_slot_t* slot = &port->ring[port->head & IPC_RING_MASK];
+    u32 address = (u32)map_address;
+    if (slot->page_count) {
+        // O destino precisa estar livre; senão a mensagem fica na porta
+        u32 valid = address && ipc_user_range(address, slot->page_count);
+        for (u32 i = 0; valid && i < slot->page_count; i++) {
+            if (vmm_get_physical((void*)(address + i * IPC_PAGE_SIZE))) valid = 0;
+        }
+        if (!valid) {
+            spin_unlock_irqrestore(&port->lock, flags);
+            return IPC_ERROR_INVALID;
+        }
+        
+        // O frame muda de dono sem cópia
+        // Sem memória para uma tabela de páginas, o que já foi mapeado é
+        // desfeito e a mensagem, com os frames, fica na porta
+        for (u32 i = 0; i < slot->page_count; i++) {
+            if (!vmm_map_page((void*)slot->frames[i], (void*)(address + i * IPC_PAGE_SIZE),
+                              PAGE_WRITE | PAGE_USER)) {
+                while (i--) {
+                    vmm_unmap_page((void*)(address + i * IPC_PAGE_SIZE));
+                }
+                spin_unlock_irqrestore(&port->lock, flags);
+                return IPC_ERROR_NO_MEMORY;
+            }
+        }
+    }
+    
+    message->sender = slot->sender;
+    message->length = slot->length;
+    message->page_count = slot->page_count;
+    for (u32 i = 0; i < slot->length; i++) {
+        message->data[i] = slot->data[i];
+    }
+    port->head++;
+    spin_unlock_irqrestore(&port->lock, flags);
+    
+    wake_up_one(&port->senders);
+    return IPC_OK;
+}
@@ -1,113 +1,747 @@
 #include "../include/process.h"
 #include "../include/memory.h"
+#include "../include/slab.h"
+#include "../include/cpu.h"
+#include "../include/timer.h"
+#include "../include/fpu.h"
+#include "../include/smp.h"
+#include "../include/wait.h"
+#include "../include/sched_stats.h"
+#include "../include/kstring.h"
 
-// Lista de processos
+// Cada CPU tem as suas filas de prontos, o processo atual e o idle em cpu_t
+// Travas: process_lock protege a tabela e a lista de processos, a lista de
+// dormindo e a de zumbis; a rq_lock de uma CPU protege as suas filas e o
+// estado dos processos com process->cpu igual a ela
+// Ordem: process_lock, fila de espera, rq_lock; nunca duas rq_lock juntas
+
+// Lista de processos (dupla, para remover em O(1))
 static process_t* process_list = NULL;
-static process_t* current_process = NULL;
-static u32 next_pid = 1;
+static spinlock_t process_lock = SPINLOCK_INIT;
+
+// Tabela de processos, indexada por PROCESS_PID_SLOT(pid)
+static process_t* process_table[PROCESS_TABLE_SIZE];
+static u16 process_generation[PROCESS_TABLE_SIZE]; // Geração atual de cada entrada
+static u16 free_slots[PROCESS_TABLE_SIZE];          // Pilha de entradas livres
+static u32 free_slot_count = 0;
+
+// Processos terminados esperando o reaper liberar os seus recursos
+// (ligados por process->next, já que saíram da lista de processos)
+static process_t* zombie_list = NULL;
+static wait_queue_t reaper_queue = WAIT_QUEUE_INIT;
+static process_t* reaper = NULL;
+
+// Processos dormindo, em ordem crescente de wake_tick
+static process_t* sleep_list = NULL;
+
+// Quantum em ticks
+static u32 scheduler_quantum = SCHEDULER_DEFAULT_QUANTUM_MS * TIMER_HZ / 1000;
+
+// Caches de objetos para estruturas de processo e pilhas do kernel
+static kmem_cache_t* process_cache = NULL;
+static kmem_cache_t* stack_cache = NULL;
+
+// Construtor das pilhas do kernel
+// O heap é preenchido sob demanda, mas uma pilha do kernel não pode sofrer
+// falha de página ao ser usada; por isso cada página é tocada uma vez aqui
+static void kernel_stack_ctor(void* stack) {
+    for (u32 offset = 0; offset < KERNEL_STACK_SIZE; offset += 4096) {
+        ((volatile u8*)stack)[offset] = 0;
+    }
+    ((volatile u8*)stack)[KERNEL_STACK_SIZE - 1] = 0;
+}
+
+// Insere um processo EDF pronto na fila EDF, depois dos de prazo igual ou
+// mais próximo (O(n) nos processos EDF prontos, que são poucos)
+static void run_queue_push_edf(run_queue_t* rq, process_t* process) {
+    process_t* prev = NULL;
+    process_t* next = rq->edf_head;
+    while (next && next->edf_abs_deadline <= process->edf_abs_deadline) {
+        prev = next;
+        next = next->rq_next;
+    }
+    process->rq_prev = prev;
+    process->rq_next = next;
+    if (prev) {
+        prev->rq_next = process;
+    } else {
+        rq->edf_head = process;
+    }
+    if (next) {
+        next->rq_prev = process;
+    }
+    rq->count++;
+}
+
+// Insere um processo pronto no fim da fila da sua prioridade
+// A espera nas filas, contabilizada ao ganhar a CPU, começa aqui
+static void run_queue_push(run_queue_t* rq, process_t* process) {
+    process->ready_since = cpu_rdtsc();
+    if (process->edf_period) {
+        run_queue_push_edf(rq, process);
+        return;
+    }
+    
+    u32 priority = process->priority;
+    process->rq_next = NULL;
+    process->rq_prev = rq->tail[priority];
+    if (rq->tail[priority]) {
+        rq->tail[priority]->rq_next = process;
+    } else {
+        rq->head[priority] = process;
+        rq->bitmap |= 1 << priority;
+    }
+    rq->tail[priority] = process;
+    rq->count++;
+}
+
+// Remove um processo de qualquer posição da fila da sua prioridade (ou da fila EDF)
+static void run_queue_remove(run_queue_t* rq, process_t* process) {
+    if (process->edf_period) {
+        if (process->rq_prev) {
+            process->rq_prev->rq_next = process->rq_next;
+        } else {
+            rq->edf_head = process->rq_next;
+        }
+        if (process->rq_next) {
+            process->rq_next->rq_prev = process->rq_prev;
+        }
+        process->rq_next = NULL;
+        process->rq_prev = NULL;
+        rq->count--;
+        return;
+    }
+    
+    u32 priority = process->priority;
+    if (process->rq_prev) {
+        process->rq_prev->rq_next = process->rq_next;
+    } else {
+        rq->head[priority] = process->rq_next;
+    }
+    if (process->rq_next) {
+        process->rq_next->rq_prev = process->rq_prev;
+    } else {
+        rq->tail[priority] = process->rq_prev;
+    }
+    if (!rq->head[priority]) {
+        rq->bitmap &= ~(1 << priority);
+    }
+    process->rq_next = NULL;
+    process->rq_prev = NULL;
+    rq->count--;
+}
+
+// Retira o processo EDF de prazo mais próximo ou, sem processos EDF, o
+// primeiro da fila não vazia de maior prioridade
+// Uma única instrução bsf encontra a fila, qualquer que seja o número de processos
+static process_t* run_queue_pop(run_queue_t* rq) {
+    if (rq->edf_head) {
+        process_t* process = rq->edf_head;
+        run_queue_remove(rq, process);
+        return process;
+    }
+    if (!rq->bitmap) return NULL;
+    process_t* process = rq->head[cpu_bsf(rq->bitmap)];
+    run_queue_remove(rq, process);
+    return process;
+}
+
+// Esvazia as filas de prontos de uma CPU
+static void run_queue_init(run_queue_t* rq) {
+    for (u32 i = 0; i < PROCESS_PRIORITY_LEVELS; i++) {
+        rq->head[i] = NULL;
+        rq->tail[i] = NULL;
+    }
+    rq->bitmap = 0;
+    rq->edf_head = NULL;
+    rq->count = 0;
+}
+
+// Trava as filas da CPU do processo
+// process->cpu só muda com a trava da CPU antiga, por isso é conferido de novo
+static cpu_t* run_queue_lock(process_t* process) {
+    while (1) {
+        cpu_t* cpu = smp_get_cpu(process->cpu);
+        spin_lock(&cpu->rq_lock);
+        if (process->cpu == cpu->id) return cpu;
+        spin_unlock(&cpu->rq_lock);
+    }
+}
+
+// Acorda quem deve rodar um processo que acabou de entrar nas filas de cpu:
+// a própria cpu, se estiver ociosa, ou então uma CPU ociosa, que vai roubá-lo
+// Um processo EDF não é roubado: a sua CPU é interrompida para preemptar o
+// atual (a CPU atual o faz no próximo tick, em scheduler_tick)
+static void scheduler_kick(cpu_t* cpu, process_t* process) {
+    if (cpu->current == cpu->idle || process->edf_period) {
+        smp_send_reschedule(cpu);
+        return;
+    }
+    for (u32 i = 0; i < smp_get_cpu_count(); i++) {
+        cpu_t* other = smp_get_cpu(i);
+        if (other->current == other->idle) {
+            smp_send_reschedule(other);
+            return;
+        }
+    }
+}
+
+// CPU para um processo novo: a com menos processos prontos ou rodando
+static u32 scheduler_pick_cpu() {
+    u32 best = smp_this_cpu()->id;
+    u32 best_load = 0xFFFFFFFF;
+    for (u32 i = 0; i < smp_get_cpu_count(); i++) {
+        cpu_t* cpu = smp_get_cpu(i);
+        u32 load = cpu->run_queue.count + (cpu->current != cpu->idle);
+        if (load < best_load) {
+            best = i;
+            best_load = load;
+        }
+    }
+    return best;
+}
+
+// Devolve um processo bloqueado às filas da sua CPU
+void scheduler_wake(process_t* process) {
+    u32 flags = cpu_irq_save();
+    cpu_t* cpu = run_queue_lock(process);
+    u32 woken = process->state == PROCESS_STATE_BLOCKED;
+    if (woken) {
+        process->state = PROCESS_STATE_READY;
+        run_queue_push(&cpu->run_queue, process);
+    }
+    spin_unlock(&cpu->rq_lock);
+    if (woken) scheduler_kick(cpu, process);
+    cpu_irq_restore(flags);
+}
+
+// Tira um processo da lista de processos dormindo, se estiver nela
+static void sleep_list_remove(process_t* process) {
+    if (process->sleep_prev) {
+        process->sleep_prev->sleep_next = process->sleep_next;
+    } else if (sleep_list == process) {
+        sleep_list = process->sleep_next;
+    } else {
+        return; // Não está dormindo
+    }
+    if (process->sleep_next) {
+        process->sleep_next->sleep_prev = process->sleep_prev;
+    }
+    process->sleep_next = NULL;
+    process->sleep_prev = NULL;
+}
+
+// Chamada por um processo assim que volta a rodar: o processo que deixou
+// a CPU já teve o esp salvo por context_switch e pode rodar em outra CPU
+static void scheduler_finish_switch() {
+    cpu_t* cpu = smp_this_cpu();
+    cpu->prev->on_cpu = 0;
+    cpu->prev = NULL;
+}
 
-// Tamanho da pilha do kernel para cada processo
-#define KERNEL_STACK_SIZE 4096
+// Primeira execução de um processo: context_switch "retorna" para cá
+// entry recebe arg (NULL para processos comuns, que o ignoram)
+static void process_trampoline(void (*entry)(), void* arg) {
+    scheduler_finish_switch();
+    
+    // scheduler_schedule desligou as interrupções antes da troca e só as
+    // restaura no contexto de quem a chamou
+    asm volatile("sti");
+    entry(arg);
+    process_exit();
+}
 
 // Inicializa o sistema de processos
 void process_init() {
-    // Inicializa a lista de processos
+    // Inicializa a lista e a tabela de processos
     process_list = NULL;
-    current_process = NULL;
+    sleep_list = NULL;
+    zombie_list = NULL;
+    free_slot_count = 0;
+    for (u32 slot = PROCESS_TABLE_SIZE; slot-- > 0;) {
+        process_table[slot] = NULL;
+        free_slots[free_slot_count++] = slot;
+    }
+    
+    // Cria os caches na primeira inicialização
+    if (!process_cache) {
+        process_cache = kmem_cache_create("process_t", sizeof(process_t), 4, NULL);
+        stack_cache = kmem_cache_create("kernel_stack", KERNEL_STACK_SIZE, 16, kernel_stack_ctor);
+    }
 }
 
-// Cria um novo processo
-process_t* process_create(const char* name, void* entry_point) {
+// Aloca e prepara um processo, sem colocá-lo na lista nem nas filas
+// Uma thread do kernel usa o diretório do kernel em vez de um espaço próprio
+static process_t* process_alloc(const char* name, void* entry_point, void* arg, u32 kernel_thread) {
     // Aloca memória para o processo
-    process_t* process = (process_t*)kmalloc(sizeof(process_t));
+    process_t* process = (process_t*)kmem_cache_alloc(process_cache);
     if (!process) return NULL;
     
-    // Inicializa os campos básicos
-    process->pid = next_pid++;
+    // Os campos começam zerados; só os demais são inicializados
+    kmemset(process, 0, sizeof(process_t));
     for (int i = 0; i < 31 && name[i]; i++) {
         process->name[i] = name[i];
     }
-    process->name[31] = '\0';
     process->state = PROCESS_STATE_READY;
+    process->priority = PROCESS_PRIORITY_DEFAULT;
+    process->time_slice = scheduler_quantum;
     
-    // Cria um diretório de páginas para o processo
-    // (Simplificado: usa o diretório do kernel para todos os processos)
-    process->page_directory = (u32*)0x1000; // Endereço arbitrário para exemplo
+    // Cria um espaço de endereçamento próprio, que compartilha as entradas do kernel
+    process->page_directory = kernel_thread ? vmm_get_kernel_directory() : vmm_create_address_space();
+    if (!process->page_directory) {
+        kmem_cache_free(process_cache, process);
+        return NULL;
+    }
     
     // Aloca pilha do kernel para o processo
-    process->kernel_stack = kmalloc(KERNEL_STACK_SIZE);
+    process->kernel_stack = kmem_cache_alloc(stack_cache);
     if (!process->kernel_stack) {
-        kfree(process);
+        vmm_destroy_address_space(process->page_directory);
+        kmem_cache_free(process_cache, process);
         return NULL;
     }
     
-    // Configura o estado inicial da CPU
-    process->cpu_state = (cpu_state_t*)((u32)process->kernel_stack + KERNEL_STACK_SIZE - sizeof(cpu_state_t));
+    // Monta a pilha inicial como se o processo tivesse chamado context_switch:
+    // ao restaurá-la, o ret leva a process_trampoline(entry_point, arg)
+    u32* stack = (u32*)((u32)process->kernel_stack + KERNEL_STACK_SIZE);
+    *--stack = (u32)arg;                // Argumentos de process_trampoline
+    *--stack = (u32)entry_point;
+    *--stack = 0;                       // Endereço de retorno fictício
+    *--stack = (u32)process_trampoline; // Retorno de context_switch
+    *--stack = 0;                       // ebp
+    *--stack = 0;                       // ebx
+    *--stack = 0;                       // esi
+    *--stack = 0;                       // edi
+    process->kernel_esp = (u32)stack;
     
-    // Zera o estado da CPU
-    for (int i = 0; i < sizeof(cpu_state_t) / 4; i++) {
-        ((u32*)process->cpu_state)[i] = 0;
-    }
+    return process;
+}
+
+// Libera os recursos de um processo que não está em nenhuma CPU
+static void process_free(process_t* process) {
+    fpu_release(process);
+    vmm_destroy_address_space(process->page_directory);
+    kmem_cache_free(stack_cache, process->kernel_stack);
+    kmem_cache_free(process_cache, process);
+}
+
+// Dá um PID ao processo e o coloca na tabela e na lista (process_lock travado)
+// Retorna 0 se a tabela estiver cheia
+static u32 process_list_add(process_t* process) {
+    if (!free_slot_count) return 0;
     
-    // Configura registradores para o ponto de entrada
-    process->cpu_state->eip = (u32)entry_point;
-    process->cpu_state->cs = 0x08; // Seletor de segmento de código
-    process->cpu_state->ds = 0x10; // Seletor de segmento de dados
-    process->cpu_state->es = 0x10;
-    process->cpu_state->fs = 0x10;
-    process->cpu_state->gs = 0x10;
-    process->cpu_state->ss = 0x10;
-    process->cpu_state->eflags = 0x202; // IF=1, bit reservado=1
+    // A geração 0 é pulada para que nenhum PID seja 0
+    u32 slot = free_slots[--free_slot_count];
+    if (!++process_generation[slot]) {
+        process_generation[slot] = 1;
+    }
+    process->pid = ((u32)process_generation[slot] << PROCESS_TABLE_BITS) | slot;
+    process_table[slot] = process;
     
-    // Adiciona o processo à lista
+    process->prev = NULL;
     process->next = process_list;
+    if (process_list) {
+        process_list->prev = process;
+    }
     process_list = process;
+    return 1;
+}
+
+// Tira o processo da tabela e da lista; o PID deixa de valer (process_lock travado)
+static void process_list_remove(process_t* process) {
+    u32 slot = PROCESS_PID_SLOT(process->pid);
+    process_table[slot] = NULL;
+    free_slots[free_slot_count++] = slot;
+    
+    if (process->prev) {
+        process->prev->next = process->next;
+    } else {
+        process_list = process->next;
+    }
+    if (process->next) {
+        process->next->prev = process->prev;
+    }
+    process->next = NULL;
+    process->prev = NULL;
+}
+
+// Escolhe a CPU de um processo EDF: a primeira em que a sua densidade
+// ainda cabe (process_lock travado); retorna 0 se não cabe em nenhuma
+static u32 scheduler_edf_admit(process_t* process) {
+    for (u32 i = 0; i < smp_get_cpu_count(); i++) {
+        cpu_t* cpu = smp_get_cpu(i);
+        if (cpu->edf_utilization + process->edf_density <= EDF_UTILIZATION_ONE) {
+            cpu->edf_utilization += process->edf_density;
+            process->cpu = i;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Coloca um processo recém-criado na tabela e nas filas
+static process_t* process_start(process_t* process) {    
+    // Adiciona o processo à lista e às filas da CPU menos carregada
+    // (ou da CPU que o admitiu, se for EDF)
+    u32 flags = spin_lock_irqsave(&process_lock);
+    if (process->edf_period && !scheduler_edf_admit(process)) {
+        spin_unlock_irqrestore(&process_lock, flags);
+        process_free(process);
+        return NULL;
+    }
+    if (!process_list_add(process)) {
+        if (process->edf_period) {
+            smp_get_cpu(process->cpu)->edf_utilization -= process->edf_density;
+        }
+        spin_unlock_irqrestore(&process_lock, flags);
+        process_free(process);
+        return NULL;
+    }
+    if (process->edf_period) {
+        // O período começa agora
+        process->edf_release = timer_get_ticks();
+        process->edf_abs_deadline = process->edf_release + process->edf_deadline;
+        process->edf_budget = process->edf_runtime;
+    } else {
+        process->cpu = scheduler_pick_cpu();
+    }
+    cpu_t* cpu = run_queue_lock(process);
+    run_queue_push(&cpu->run_queue, process);
+    spin_unlock(&cpu->rq_lock);
+    spin_unlock(&process_lock);
+    scheduler_kick(cpu, process);
+    cpu_irq_restore(flags);
     
     return process;
 }
 
+// Cria um novo processo
+process_t* process_create(const char* name, void* entry_point) {
+    process_t* process = process_alloc(name, entry_point, NULL, 0);
+    if (!process) return NULL;
+    return process_start(process);
+}
+
+// Cria uma thread do kernel
+process_t* kthread_create(void (*fn)(void*), void* arg) {
+    return kthread_create_named("kthread", fn, arg);
+}
+
+// Cria uma thread do kernel com um nome
+process_t* kthread_create_named(const char* name, void (*fn)(void*), void* arg) {
+    process_t* process = process_alloc(name, (void*)fn, arg, 1);
+    if (!process) return NULL;
+    return process_start(process);
+}
+
+// Cria uma thread do kernel da classe EDF
+process_t* kthread_create_edf(const char* name, void (*fn)(void*), void* arg, const edf_params_t* params) {
+    u32 runtime = timer_ms_to_ticks(params->runtime);
+    u32 deadline = timer_ms_to_ticks(params->deadline);
+    u32 period = timer_ms_to_ticks(params->period);
+    if (!runtime || runtime > deadline || deadline > period || period > EDF_MAX_PERIOD) {
+        return NULL;
+    }
+    
+    process_t* process = process_alloc(name, (void*)fn, arg, 1);
+    if (!process) return NULL;
+    process->edf_period = period;
+    process->edf_runtime = runtime;
+    process->edf_deadline = deadline;
+    
+    // Densidade arredondada para cima: a soma nunca subestima a utilização
+    process->edf_density = ((runtime << 16) + deadline - 1) / deadline;
+    return process_start(process);
+}
+
+// Termina um processo (process_lock travado)
+// Ele sai da tabela, da lista, da lista de dormindo, da fila de espera e das
+// filas de prontos, tudo em O(1), e entra na lista de zumbis; a pilha só é
+// liberada pelo reaper, depois que o processo deixar a CPU
+// Retorna 0 se o processo não pode ser terminado
+static u32 process_kill_locked(process_t* process) {
+    if (process->state == PROCESS_STATE_TERMINATED) return 0;
+    if (process == smp_get_cpu(process->cpu)->idle || process == reaper) return 0;
+    
+    sleep_list_remove(process);
+    wait_queue_remove(process);
+    process_list_remove(process);
+    if (process->edf_period) {
+        smp_get_cpu(process->cpu)->edf_utilization -= process->edf_density;
+    }
+    
+    cpu_t* cpu = run_queue_lock(process);
+    if (process->state == PROCESS_STATE_READY) {
+        run_queue_remove(&cpu->run_queue, process);
+    }
+    process->state = PROCESS_STATE_TERMINATED;
+    u32 on_cpu = process->on_cpu;
+    spin_unlock(&cpu->rq_lock);
+    
+    process->next = zombie_list;
+    zombie_list = process;
+    wake_up_one(&reaper_queue);
+    
+    // Rodando em outra CPU: o IPI a faz deixar o processo já
+    if (on_cpu) {
+        smp_send_reschedule(cpu);
+    }
+    return 1;
+}
+
 // Termina um processo
 void process_terminate(process_t* process) {
     if (!process) return;
     
-    // Marca o processo como terminado
-    process->state = PROCESS_STATE_TERMINATED;
+    u32 flags = spin_lock_irqsave(&process_lock);
+    u32 killed = process_kill_locked(process);
+    spin_unlock(&process_lock);
     
-    // Remove o processo da lista (simplificado)
-    if (process_list == process) {
-        process_list = process->next;
-    } else {
-        process_t* prev = process_list;
-        while (prev && prev->next != process) {
-            prev = prev->next;
-        }
-        if (prev) {
-            prev->next = process->next;
-        }
+    // Terminou a si mesmo: deixa a CPU para não voltar mais
+    if (killed && process == smp_this_cpu()->current) {
+        scheduler_schedule();
     }
-    
-    // Libera recursos
-    kfree(process->kernel_stack);
-    kfree(process);
+    cpu_irq_restore(flags);
+}
+
+// Procura um processo pelo PID
+process_t* process_find(u32 pid) {
+    u32 flags = spin_lock_irqsave(&process_lock);
+    process_t* process = process_table[PROCESS_PID_SLOT(pid)];
+    if (process && process->pid != pid) {
+        process = NULL; // Entrada reusada por outro processo
+    }
+    spin_unlock_irqrestore(&process_lock, flags);
+    return process;
 }
 
 // Bloqueia um processo
+// Um processo em execução não está em fila; ele só deixa a CPU no próximo scheduler_schedule
 void process_block(process_t* process) {
     if (!process) return;
+    u32 flags = cpu_irq_save();
+    cpu_t* cpu = run_queue_lock(process);
+    if (process->state == PROCESS_STATE_READY) {
+        run_queue_remove(&cpu->run_queue, process);
+    }
     process->state = PROCESS_STATE_BLOCKED;
+    spin_unlock(&cpu->rq_lock);
+    cpu_irq_restore(flags);
 }
 
 // Desbloqueia um processo
 void process_unblock(process_t* process) {
     if (!process) return;
+    u32 flags = spin_lock_irqsave(&process_lock);
     if (process->state == PROCESS_STATE_BLOCKED) {
-        process->state = PROCESS_STATE_READY;
+        sleep_list_remove(process);
+    }
+    scheduler_wake(process);
+    spin_unlock_irqrestore(&process_lock, flags);
+}
+
+// Desfaz process_block no processo atual
+// Se já foi acordado, ele está nas filas de prontos desta CPU e sai delas
+// (um processo em execução nunca é roubado: scheduler_steal pula on_cpu)
+void process_unblock_current() {
+    u32 flags = cpu_irq_save();
+    cpu_t* cpu = smp_this_cpu();
+    process_t* process = cpu->current;
+    
+    spin_lock(&cpu->rq_lock);
+    if (process->state == PROCESS_STATE_READY) {
+        run_queue_remove(&cpu->run_queue, process);
+    }
+    if (process->state != PROCESS_STATE_TERMINATED) {
+        process->state = PROCESS_STATE_RUNNING;
     }
+    spin_unlock(&cpu->rq_lock);
+    cpu_irq_restore(flags);
+}
+
+// Altera a prioridade de um processo, movendo-o de fila se estiver pronto
+void process_set_priority(process_t* process, u32 priority) {
+    if (!process || priority >= PROCESS_PRIORITY_LEVELS) return;
+    u32 flags = cpu_irq_save();
+    cpu_t* cpu = run_queue_lock(process);
+    if (process->state == PROCESS_STATE_READY) {
+        // A mudança de fila não reinicia a espera
+        u64 ready_since = process->ready_since;
+        run_queue_remove(&cpu->run_queue, process);
+        process->priority = priority;
+        run_queue_push(&cpu->run_queue, process);
+        process->ready_since = ready_since;
+    } else {
+        process->priority = priority;
+    }
+    spin_unlock(&cpu->rq_lock);
+    cpu_irq_restore(flags);
+}
+
+// Coloca o processo atual (process, em cpu) na lista de dormindo até
+// wake_tick e o marca como bloqueado; ele deixa a CPU no próximo
+// scheduler_schedule (interrupções desligadas)
+static void process_sleep_until(cpu_t* cpu, process_t* process, u64 wake_tick) {
+    spin_lock(&process_lock);
+    process->wake_tick = wake_tick;
+    
+    // Insere mantendo a lista ordenada: o primeiro é sempre o próximo prazo
+    process_t* prev = NULL;
+    process_t* next = sleep_list;
+    while (next && next->wake_tick <= process->wake_tick) {
+        prev = next;
+        next = next->sleep_next;
+    }
+    process->sleep_prev = prev;
+    process->sleep_next = next;
+    if (prev) {
+        prev->sleep_next = process;
+    } else {
+        sleep_list = process;
+    }
+    if (next) {
+        next->sleep_prev = process;
+    }
+    u32 earliest = sleep_list == process;
+    
+    spin_lock(&cpu->rq_lock);
+    process->state = PROCESS_STATE_BLOCKED;
+    spin_unlock(&cpu->rq_lock);
+    spin_unlock(&process_lock);
+    
+    // A BSP pode estar dormindo sem ticks até um prazo posterior
+    if (earliest) {
+        smp_send_reschedule(smp_get_cpu(0));
+    }
+}
+
+// Bloqueia o processo atual por ms milissegundos
+void process_sleep(u32 ms) {
+    u32 flags = cpu_irq_save();
+    cpu_t* cpu = smp_this_cpu();
+    process_t* process = cpu->current;
+    if (!process || process == cpu->idle) {
+        cpu_irq_restore(flags);
+        return;
+    }
+    
+    process_sleep_until(cpu, process, timer_get_ticks() + timer_ms_to_ticks(ms));
+    scheduler_schedule();
+    cpu_irq_restore(flags);
+}
+
+// Põe o processo EDF atual para dormir até o início do próximo período
+// (interrupções desligadas)
+// Um processo atrasado além do próximo período recomeça já
+static void process_edf_sleep(cpu_t* cpu, process_t* process) {
+    u64 now = timer_get_ticks();
+    u64 release = process->edf_release + process->edf_period;
+    if (release < now) release = now;
+    process->edf_waiting = 1;
+    process_sleep_until(cpu, process, release);
+}
+
+// Encerra a execução do período atual do processo EDF atual
+void process_wait_next_period() {
+    u32 flags = cpu_irq_save();
+    cpu_t* cpu = smp_this_cpu();
+    process_t* process = cpu->current;
+    if (!process || !process->edf_period) {
+        cpu_irq_restore(flags);
+        return;
+    }
+    
+    if (timer_get_ticks() > process->edf_abs_deadline) {
+        process->edf_misses++;
+    }
+    process_edf_sleep(cpu, process);
+    scheduler_schedule();
+    cpu_irq_restore(flags);
+}
+
+// Termina o processo atual
+// A pilha em uso não pode ser liberada aqui; o reaper libera os recursos
+// depois que o processo deixar a CPU
+void process_exit() {
+    u32 flags = cpu_irq_save();
+    cpu_t* cpu = smp_this_cpu();
+    process_t* process = cpu->current;
+    if (!process || process == cpu->idle) {
+        cpu_irq_restore(flags);
+        return;
+    }
+    
+    process_terminate(process);
+    
+    // Não deveria chegar aqui
+    cpu_halt();
 }
 
 // Obtém o processo atual
 process_t* process_get_current() {
-    return current_process;
+    u32 flags = cpu_irq_save();
+    process_t* process = smp_this_cpu()->current;
+    cpu_irq_restore(flags);
+    return process;
+}
+
+// Copia a contabilidade dos processos
+// runtime vai até a última vez que o processo deixou a CPU
+u32 process_get_stats(process_stats_t* stats, u32 max) {
+    u32 count = 0;
+    u32 flags = spin_lock_irqsave(&process_lock);
+    for (process_t* process = process_list; process && count < max; process = process->next) {
+        process_stats_t* entry = &stats[count++];
+        entry->pid = process->pid;
+        for (u32 i = 0; i < 32; i++) {
+            entry->name[i] = process->name[i];
+        }
+        entry->state = process->state;
+        entry->cpu = process->cpu;
+        entry->priority = process->priority;
+        entry->runtime = process->runtime;
+        entry->voluntary_switches = process->voluntary_switches;
+        entry->involuntary_switches = process->involuntary_switches;
+        for (u32 i = 0; i < SCHED_WAIT_BUCKETS; i++) {
+            entry->wait_histogram[i] = process->wait_histogram[i];
+        }
+    }
+    spin_unlock_irqrestore(&process_lock, flags);
+    return count;
+}
+
+// Processo que libera os zumbis
+// Cada passada leva a lista inteira de uma vez; os que ainda estão deixando
+// uma CPU (on_cpu) voltam para a lista e são tentados de novo em 1ms
+static void reaper_main(void* arg) {
+    (void)arg;
+    while (1) {
+        wait_event(&reaper_queue, zombie_list != NULL);
+        
+        u32 flags = spin_lock_irqsave(&process_lock);
+        process_t* batch = zombie_list;
+        zombie_list = NULL;
+        spin_unlock_irqrestore(&process_lock, flags);
+        
+        u32 busy = 0;
+        while (batch) {
+            process_t* process = batch;
+            batch = process->next;
+            if (process->on_cpu) {
+                flags = spin_lock_irqsave(&process_lock);
+                process->next = zombie_list;
+                zombie_list = process;
+                spin_unlock_irqrestore(&process_lock, flags);
+                busy = 1;
+            } else {
+                process_free(process);
+            }
+        }
+        
+        if (busy) {
+            process_sleep(1);
+        }
+    }
 }
 
 // Inicializa o escalonador
@@ -115,80 +749,349 @@ void scheduler_init() {
     // Inicializa o sistema de processos
     process_init();
     
-    // Cria o processo inicial (idle)
-    process_t* idle = process_create("idle", NULL); // NULL será substituído pelo ponto de entrada real
+    // kernel_main passa a ser o processo idle da BSP, na pilha de boot
+    scheduler_init_cpu(smp_this_cpu());
     
-    // Define o processo atual
-    current_process = idle;
-    current_process->state = PROCESS_STATE_RUNNING;
+    // Processo que libera os processos terminados
+    reaper = kthread_create_named("reaper", reaper_main, NULL);
+}
+
+// Prepara as filas de uma CPU e cria o seu processo idle
+process_t* scheduler_init_cpu(cpu_t* cpu) {
+    run_queue_init(&cpu->run_queue);
+    
+    process_t* idle = process_alloc("idle", NULL, NULL, 1);
+    if (!idle) return NULL;
+    
+    // O idle nunca fica nas filas: ele roda apenas quando todas estão vazias
+    // e não há o que roubar das outras CPUs
+    idle->priority = PROCESS_PRIORITY_IDLE;
+    idle->state = PROCESS_STATE_RUNNING;
+    idle->cpu = cpu->id;
+    idle->on_cpu = 1;
+    idle->run_start = cpu_rdtsc();
+    
+    u32 flags = spin_lock_irqsave(&process_lock);
+    process_list_add(idle);
+    spin_unlock_irqrestore(&process_lock, flags);
+    
+    cpu->idle = idle;
+    cpu->current = idle;
+    return idle;
 }
 
 // Adiciona um processo ao escalonador
 void scheduler_add_process(process_t* process) {
-    // O processo já foi adicionado à lista em process_create
+    // O processo já foi adicionado à lista e à fila de prontos em process_create
     // Aqui poderíamos adicionar lógica adicional se necessário
 }
 
-// Remove um processo do escalonador
-void scheduler_remove_process(u32 pid) {
-    // Procura o processo com o PID especificado
-    process_t* process = process_list;
-    while (process) {
-        if (process->pid == pid) {
-            process_terminate(process);
-            return;
+// Termina o processo com o PID especificado
+// A procura e o término acontecem sob a mesma trava: o processo não pode
+// ser liberado entre um e outro
+u32 scheduler_remove_process(u32 pid) {
+    u32 flags = spin_lock_irqsave(&process_lock);
+    process_t* process = process_table[PROCESS_PID_SLOT(pid)];
+    u32 killed = process && process->pid == pid && process_kill_locked(process);
+    spin_unlock(&process_lock);
+    
+    if (killed && process == smp_this_cpu()->current) {
+        scheduler_schedule();
+    }
+    cpu_irq_restore(flags);
+    return killed;
+}
+
+// Rouba um processo pronto de outra CPU (chamada pela CPU ociosa cpu)
+// A vítima é a CPU com mais processos esperando; de lá sai o processo de
+// maior prioridade, exceto o dono da FPU da vítima, cujo estado está nos
+// registradores dela e não pode ser salvo daqui, e um processo acordado
+// que ainda não terminou de deixar a vítima (on_cpu)
+static process_t* scheduler_steal(cpu_t* cpu) {
+    cpu_t* victim = NULL;
+    u32 most = 0;
+    for (u32 i = 0; i < smp_get_cpu_count(); i++) {
+        cpu_t* other = smp_get_cpu(i);
+        if (other != cpu && other->run_queue.count > most) {
+            victim = other;
+            most = other->run_queue.count;
         }
-        process = process->next;
     }
+    if (!victim) return NULL;
+    
+    process_t* process = NULL;
+    spin_lock(&victim->rq_lock);
+    u32 bitmap = victim->run_queue.bitmap;
+    while (bitmap && !process) {
+        u32 priority = cpu_bsf(bitmap);
+        bitmap &= bitmap - 1;
+        for (process_t* p = victim->run_queue.head[priority]; p; p = p->rq_next) {
+            if (p != victim->fpu_owner && !p->on_cpu) {
+                process = p;
+                break;
+            }
+        }
+    }
+    if (process) {
+        run_queue_remove(&victim->run_queue, process);
+        process->cpu = cpu->id;
+        process->state = PROCESS_STATE_RUNNING;
+        process->on_cpu = 1;
+        cpu->steals++;
+    }
+    spin_unlock(&victim->rq_lock);
+    return process;
+}
+
+// Faixa do histograma de espera (ver SCHED_WAIT_BUCKETS)
+static u32 scheduler_wait_bucket(u64 wait) {
+    if (wait < (1 << SCHED_WAIT_SHIFT)) return 0;
+    if (wait >> 32) return SCHED_WAIT_BUCKETS - 1;
+    u32 bucket = cpu_bsr((u32)wait) - SCHED_WAIT_SHIFT + 1;
+    return bucket < SCHED_WAIT_BUCKETS ? bucket : SCHED_WAIT_BUCKETS - 1;
+}
+
+// Contabiliza a troca de old_process para next (interrupções desligadas)
+// old_process sai ainda pronto quando foi preemptado ou cedeu a vez, e
+// bloqueado ou terminado quando saiu por conta própria
+// Os TSCs das CPUs podem não estar alinhados: uma espera que começou em
+// outra CPU e parece negativa conta como zero
+static void scheduler_account(cpu_t* cpu, process_t* old_process, process_t* next) {
+    u64 now = cpu_rdtsc();
+    old_process->runtime += now - old_process->run_start;
+    if (old_process->state == PROCESS_STATE_RUNNING || old_process->state == PROCESS_STATE_READY) {
+        old_process->involuntary_switches++;
+    } else {
+        old_process->voluntary_switches++;
+    }
+    
+    // O idle não espera em fila
+    u64 wait = 0;
+    if (next != cpu->idle) {
+        wait = now > next->ready_since ? now - next->ready_since : 0;
+        next->wait_histogram[scheduler_wait_bucket(wait)]++;
+    }
+    next->run_start = now;
+    
+    sched_trace_record(now, cpu->id, old_process, next, wait);
+}
+
+// Passa a CPU de old_process para next, já escolhido e com on_cpu ligado
+// (interrupções desligadas)
+// Um processo com on_cpu ligado nas filas desta CPU é sempre o próprio
+// old_process, acordado antes de sair dela; os outros já deixaram a CPU
+// em que rodaram (scheduler_steal não leva processos com on_cpu)
+static void scheduler_switch(cpu_t* cpu, process_t* old_process, process_t* next) {
+    // Quantum novo para o processo escolhido
+    next->time_slice = scheduler_quantum;
+    if (next == old_process) return;
+    
+    scheduler_account(cpu, old_process, next);
+    cpu->current = next;
+    cpu->prev = old_process;
+    
+    // Troca o CR3 apenas quando o espaço de endereçamento muda,
+    // evitando esvaziar o TLB entre processos que compartilham o diretório
+    if (next->page_directory != old_process->page_directory) {
+        vmm_switch_address_space(next->page_directory);
+    }
+    // A FPU continua com o estado do dono anterior até o primeiro uso (#NM)
+    fpu_switch(next);
+    context_switch(&old_process->kernel_esp, next->kernel_esp);
+    
+    // De volta a old_process, talvez em outra CPU
+    scheduler_finish_switch();
 }
 
 // Realiza a troca de contexto
 void scheduler_schedule() {
-    // Se não há processos, retorna
-    if (!process_list) return;
+    u32 flags = cpu_irq_save();
+    cpu_t* cpu = smp_this_cpu();
     
     // Salva o processo atual
-    process_t* old_process = current_process;
+    process_t* old_process = cpu->current;
+    if (!old_process) {
+        cpu_irq_restore(flags);
+        return;
+    }
     
-    // Encontra o próximo processo a ser executado
-    process_t* next = NULL;
+    spin_lock(&cpu->rq_lock);
+    
+    // Round Robin dentro de cada prioridade: o processo atual, se ainda
+    // puder rodar, volta para o fim da fila da sua prioridade
+    // (acordado antes de sair da CPU, ele já está na fila, como READY)
+    if (old_process->state == PROCESS_STATE_RUNNING && old_process != cpu->idle) {
+        old_process->state = PROCESS_STATE_READY;
+        run_queue_push(&cpu->run_queue, old_process);
+    }
     
-    // Estratégia simples de Round Robin
-    if (current_process) {
-        next = current_process->next;
+    // O próximo é o primeiro da fila de maior prioridade (O(1))
+    // on_cpu é ligado ainda sob a trava: um processo escolhido, mas que
+    // ainda não começou a rodar, não pode ser liberado pelo reaper
+    process_t* next = run_queue_pop(&cpu->run_queue);
+    if (next) {
+        next->state = PROCESS_STATE_RUNNING;
+        next->on_cpu = 1;
     }
+    spin_unlock(&cpu->rq_lock);
     
-    // Se chegou ao fim da lista ou não há processo atual, volta ao início
+    // Filas vazias: rouba trabalho de uma CPU ocupada, ou roda o idle
     if (!next) {
-        next = process_list;
+        next = scheduler_steal(cpu);
     }
+    if (!next) {
+        next = cpu->idle;
+        next->on_cpu = 1;
+    }
+    
+    scheduler_switch(cpu, old_process, next);
+    cpu_irq_restore(flags);
+}
+
+// Cede a CPU diretamente ao processo pid (caminho rápido do IPC)
+// O processo é tirado das filas de qualquer CPU e roda já, sem passar pela
+// escolha por prioridade; o processo atual volta ao fim da sua fila
+// A procura e a retirada da fila acontecem sob process_lock: o processo
+// não pode ser terminado e liberado entre uma e outra
+u32 scheduler_yield_to(u32 pid) {
+    u32 flags = cpu_irq_save();
+    cpu_t* cpu = smp_this_cpu();
+    process_t* old_process = cpu->current;
+    
+    spin_lock(&process_lock);
+    process_t* target = process_table[PROCESS_PID_SLOT(pid)];
+    if (!old_process || !target || target->pid != pid || target == old_process) {
+        spin_unlock(&process_lock);
+        cpu_irq_restore(flags);
+        return 0;
+    }
+    
+    // Como em scheduler_steal: não leva um processo que ainda deixa outra
+    // CPU, o dono da FPU de outra CPU nem um processo EDF de outra CPU
+    cpu_t* owner = run_queue_lock(target);
+    u32 taken = target->state == PROCESS_STATE_READY && !target->on_cpu &&
+                (owner == cpu || (target != owner->fpu_owner && !target->edf_period));
+    if (taken) {
+        run_queue_remove(&owner->run_queue, target);
+        target->cpu = cpu->id;
+        target->state = PROCESS_STATE_RUNNING;
+        target->on_cpu = 1;
+    }
+    spin_unlock(&owner->rq_lock);
+    spin_unlock(&process_lock);
     
-    // Procura um processo que esteja pronto
-    process_t* start = next;
-    do {
-        if (next->state == PROCESS_STATE_READY) {
-            break;
+    if (taken) {
+        spin_lock(&cpu->rq_lock);
+        if (old_process->state == PROCESS_STATE_RUNNING && old_process != cpu->idle) {
+            old_process->state = PROCESS_STATE_READY;
+            run_queue_push(&cpu->run_queue, old_process);
         }
-        next = next->next;
-        if (!next) next = process_list;
-    } while (next != start);
+        spin_unlock(&cpu->rq_lock);
+        scheduler_switch(cpu, old_process, target);
+    }
+    cpu_irq_restore(flags);
+    return taken;
+}
+
+// Define o quantum de cada processo, em milissegundos
+void scheduler_set_quantum(u32 ms) {
+    scheduler_quantum = timer_ms_to_ticks(ms);
+}
+
+// 1 se um processo EDF pronto em cpu deve tirar a CPU de current
+static u32 scheduler_edf_preempts(cpu_t* cpu, process_t* current) {
+    spin_lock(&cpu->rq_lock);
+    process_t* head = cpu->run_queue.edf_head;
+    u32 preempts = head && (current == cpu->idle || !current->edf_period ||
+                            head->edf_abs_deadline < current->edf_abs_deadline);
+    spin_unlock(&cpu->rq_lock);
+    return preempts;
+}
+
+// 1 se o processo atual deve deixar a CPU já
+u32 scheduler_need_resched() {
+    cpu_t* cpu = smp_this_cpu();
+    process_t* current = cpu->current;
+    if (!current) return 0;
+    return current->state == PROCESS_STATE_TERMINATED || scheduler_edf_preempts(cpu, current);
+}
+
+// Chamado pelo timer de cada CPU (interrupções desligadas)
+void scheduler_tick(u32 elapsed) {
+    cpu_t* cpu = smp_this_cpu();
+    process_t* process = cpu->current;
+    if (!process) return;
     
-    // Se não encontrou nenhum processo pronto, mantém o atual
-    if (next->state != PROCESS_STATE_READY) {
+    // O idle cede a CPU assim que houver alguém pronto
+    if (process == cpu->idle) {
+        if (cpu->run_queue.count) scheduler_schedule();
         return;
     }
     
-    // Atualiza o estado dos processos
-    if (current_process && current_process->state == PROCESS_STATE_RUNNING) {
-        current_process->state = PROCESS_STATE_READY;
+    // Processo EDF: roda até acabar o orçamento do período, sem quantum;
+    // sem orçamento, dorme até o próximo período
+    if (process->edf_period) {
+        if (process->edf_budget > elapsed) {
+            process->edf_budget -= elapsed;
+        } else {
+            process->edf_budget = 0;
+            process->edf_overruns++;
+            process_edf_sleep(cpu, process);
+            scheduler_schedule();
+            return;
+        }
     }
-    next->state = PROCESS_STATE_RUNNING;
     
-    // Atualiza o processo atual
-    current_process = next;
+    // Um processo EDF pronto passa à frente (de um processo Round Robin ou
+    // de um EDF de prazo mais distante)
+    if (scheduler_edf_preempts(cpu, process)) {
+        scheduler_schedule();
+        return;
+    }
+    if (process->edf_period) return;
     
-    // Realiza a troca de contexto
-    if (old_process != current_process) {
-        context_switch(old_process->cpu_state, current_process->cpu_state);
+    // Fim do quantum: preempta
+    if (process->time_slice > elapsed) {
+        process->time_slice -= elapsed;
+    } else {
+        process->time_slice = 0;
+        scheduler_schedule();
     }
 }
+
+// Acorda os processos cujo prazo venceu; a lista está ordenada
+// Cada um volta para as filas da CPU em que rodou por último
+// Processos EDF que esperavam o próximo período começam uma nova execução
+void scheduler_wake_sleepers() {
+    u64 now = timer_get_ticks();
+    u32 flags = spin_lock_irqsave(&process_lock);
+    while (sleep_list && sleep_list->wake_tick <= now) {
+        process_t* process = sleep_list;
+        sleep_list_remove(process);
+        
+        // Novo período EDF: orçamento cheio e prazo novo, antes de entrar
+        // na fila EDF, ordenada pelo prazo
+        if (process->edf_waiting) {
+            process->edf_waiting = 0;
+            process->edf_release = process->wake_tick;
+            process->edf_abs_deadline = process->edf_release + process->edf_deadline;
+            process->edf_budget = process->edf_runtime;
+        }
+        scheduler_wake(process);
+    }
+    spin_unlock_irqrestore(&process_lock, flags);
+}
+
+// Tick do próximo prazo (processo dormindo), ou TIMER_NO_DEADLINE
+u64 scheduler_next_deadline() {
+    u32 flags = spin_lock_irqsave(&process_lock);
+    u64 deadline = sleep_list ? sleep_list->wake_tick : TIMER_NO_DEADLINE;
+    spin_unlock_irqrestore(&process_lock, flags);
+    return deadline;
+}
+
+// Número de processos prontos esperando a CPU atual
+// Chamada com as interrupções desligadas (o valor é desta CPU)
+u32 scheduler_ready_count() {
+    return smp_this_cpu()->run_queue.count;
+}
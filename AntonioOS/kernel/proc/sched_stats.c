@@ -0,0 +1,196 @@
+#include "../include/sched_stats.h"
+#include "../include/filesystem.h"
+#include "../include/memory.h"
+#include "../include/cpu.h"
+
+// Anel de trocas de contexto
+// Cada troca reserva uma posição com lock xadd e a preenche; sequence é
+// zerado antes e gravado por último, então quem lê descarta um evento cuja
+// sequence muda durante a cópia (ainda sendo gravado ou já sobrescrito)
+static sched_trace_event_t trace_ring[SCHED_TRACE_SIZE];
+static volatile u32 trace_next = 0;
+
+static fs_node_t stat_node;
+static fs_node_t trace_node;
+
+// Grava uma troca no anel
+void sched_trace_record(u64 tsc, u32 cpu, process_t* prev, process_t* next, u64 wait) {
+    u32 index = cpu_xadd(&trace_next, 1);
+    sched_trace_event_t* event = &trace_ring[index & (SCHED_TRACE_SIZE - 1)];
+    
+    // No x86 as gravações ficam visíveis na ordem do programa: basta
+    // impedir que o compilador as reordene
+    event->sequence = 0;
+    asm volatile("" : : : "memory");
+    event->cpu = cpu;
+    event->prev_pid = prev->pid;
+    event->prev_state = prev->state;
+    event->next_pid = next->pid;
+    event->wait = (wait >> 32) ? 0xFFFFFFFF : (u32)wait;
+    event->tsc = tsc;
+    asm volatile("" : : : "memory");
+    event->sequence = index + 1;
+}
+
+// Texto gerado a cada leitura
+typedef struct {
+    char* data;
+    u32 length;
+    u32 capacity;
+} sched_text_t;
+
+static void text_write(sched_text_t* text, const char* str) {
+    while (*str && text->length < text->capacity) {
+        text->data[text->length++] = *str++;
+    }
+}
+
+// Escreve um número de 64 bits em decimal
+// A divisão é feita por divl, 32 bits por vez: o kernel não tem a
+// divisão de 64 bits da libgcc
+static void text_dec(sched_text_t* text, u64 value) {
+    char digits[20];
+    int count = 0;
+    do {
+        u32 high = (u32)(value >> 32);
+        u32 low = (u32)value;
+        u32 remainder = high % 10;
+        high /= 10;
+        asm("divl %4" : "=a"(low), "=d"(remainder) : "a"(low), "d"(remainder), "r"(10));
+        digits[count++] = '0' + remainder;
+        value = ((u64)high << 32) | low;
+    } while (value);
+    
+    char str[21];
+    for (int i = 0; i < count; i++) {
+        str[i] = digits[count - 1 - i];
+    }
+    str[count] = '\0';
+    text_write(text, str);
+}
+
+// Entrega a parte [offset, offset + size) do texto e o libera
+static u32 text_read(sched_text_t* text, u32 offset, u32 size, u8* buffer) {
+    u32 copied = 0;
+    if (offset < text->length) {
+        copied = text->length - offset;
+        if (copied > size) copied = size;
+        for (u32 i = 0; i < copied; i++) {
+            buffer[i] = text->data[offset + i];
+        }
+    }
+    kfree(text->data);
+    return copied;
+}
+
+// /schedstat: uma linha por processo
+// Cada leitura gera um retrato novo; leituras em partes podem ver retratos diferentes
+static u32 sched_stat_read(fs_node_t* node, u32 offset, u32 size, u8* buffer) {
+    (void)node;
+    process_stats_t* stats = (process_stats_t*)kmalloc(PROCESS_TABLE_SIZE * sizeof(process_stats_t));
+    if (!stats) return 0;
+    u32 count = process_get_stats(stats, PROCESS_TABLE_SIZE);
+    
+    sched_text_t text;
+    text.length = 0;
+    text.capacity = 256 + count * (64 + 11 * (6 + SCHED_WAIT_BUCKETS));
+    text.data = (char*)kmalloc(text.capacity);
+    if (!text.data) {
+        kfree(stats);
+        return 0;
+    }
+    
+    text_write(&text, "# pid nome estado cpu prioridade ciclos voluntarias involuntarias"
+                      " espera[<2^12 2^12 ... >=2^26 ciclos]\n");
+    for (u32 i = 0; i < count; i++) {
+        process_stats_t* entry = &stats[i];
+        text_dec(&text, entry->pid);
+        text_write(&text, " ");
+        text_write(&text, entry->name);
+        text_write(&text, " ");
+        text_dec(&text, entry->state);
+        text_write(&text, " ");
+        text_dec(&text, entry->cpu);
+        text_write(&text, " ");
+        text_dec(&text, entry->priority);
+        text_write(&text, " ");
+        text_dec(&text, entry->runtime);
+        text_write(&text, " ");
+        text_dec(&text, entry->voluntary_switches);
+        text_write(&text, " ");
+        text_dec(&text, entry->involuntary_switches);
+        for (u32 b = 0; b < SCHED_WAIT_BUCKETS; b++) {
+            text_write(&text, " ");
+            text_dec(&text, entry->wait_histogram[b]);
+        }
+        text_write(&text, "\n");
+    }
+    kfree(stats);
+    
+    return text_read(&text, offset, size, buffer);
+}
+
+// /schedtrace: as últimas trocas, da mais antiga para a mais recente
+static u32 sched_trace_read(fs_node_t* node, u32 offset, u32 size, u8* buffer) {
+    (void)node;
+    sched_text_t text;
+    text.length = 0;
+    text.capacity = 128 + SCHED_TRACE_SIZE * 80;
+    text.data = (char*)kmalloc(text.capacity);
+    if (!text.data) return 0;
+    
+    text_write(&text, "# tsc cpu anterior estado_anterior proximo espera_ciclos\n");
+    u32 end = trace_next;
+    u32 start = end > SCHED_TRACE_SIZE ? end - SCHED_TRACE_SIZE : 0;
+    for (u32 index = start; index != end; index++) {
+        sched_trace_event_t* slot = &trace_ring[index & (SCHED_TRACE_SIZE - 1)];
+        u32 sequence = slot->sequence;
+        asm volatile("" : : : "memory");
+        sched_trace_event_t event = *slot;
+        asm volatile("" : : : "memory");
+        if (sequence != index + 1 || slot->sequence != sequence) continue;
+        
+        text_dec(&text, event.tsc);
+        text_write(&text, " ");
+        text_dec(&text, event.cpu);
+        text_write(&text, " ");
+        text_dec(&text, event.prev_pid);
+        text_write(&text, " ");
+        text_dec(&text, event.prev_state);
+        text_write(&text, " ");
+        text_dec(&text, event.next_pid);
+        text_write(&text, " ");
+        text_dec(&text, event.wait);
+        text_write(&text, "\n");
+    }
+    
+    return text_read(&text, offset, size, buffer);
+}
+
+// Prepara um nó somente leitura da raiz
+static void sched_node_init(fs_node_t* node, const char* name,
+                            u32 (*read)(fs_node_t*, u32, u32, u8*)) {
+    for (int i = 0; i < 127 && name[i]; i++) {
+        node->name[i] = name[i];
+        node->name[i+1] = '\0';
+    }
+    node->type = FS_FILE;
+    node->permissions = 0444; // r--r--r--
+    node->uid = 0;
+    node->gid = 0;
+    node->size = 0;           // Gerado a cada leitura
+    node->impl = 0;
+    node->read = read;
+    node->write = NULL;
+    node->open = NULL;
+    node->close = NULL;
+    node->readdir = NULL;
+    node->finddir = NULL;
+    fs_register_node(node);
+}
+
+// Cria /schedstat e /schedtrace
+void sched_stats_init() {
+    sched_node_init(&stat_node, "schedstat", sched_stat_read);
+    sched_node_init(&trace_node, "schedtrace", sched_trace_read);
+}
@@ -0,0 +1,111 @@
+#include "../include/wait.h"
+
+// Os processos esperando formam uma lista dupla dentro de process_t
+// (wait_next/wait_prev); process->wait_queue indica a fila em que estão
+// Ordem das travas: queue->lock antes da rq_lock de qualquer CPU
+
+// Inicializa uma fila de espera vazia
+void wait_queue_init(wait_queue_t* queue) {
+    spin_init(&queue->lock);
+    queue->head = NULL;
+    queue->tail = NULL;
+}
+
+// Insere um processo no fim da fila (queue->lock travado)
+static void wait_queue_append(wait_queue_t* queue, process_t* process) {
+    process->wait_queue = queue;
+    process->wait_next = NULL;
+    process->wait_prev = queue->tail;
+    if (queue->tail) {
+        queue->tail->wait_next = process;
+    } else {
+        queue->head = process;
+    }
+    queue->tail = process;
+}
+
+// Remove um processo de qualquer posição da fila (queue->lock travado)
+static void wait_queue_unlink(wait_queue_t* queue, process_t* process) {
+    if (process->wait_prev) {
+        process->wait_prev->wait_next = process->wait_next;
+    } else {
+        queue->head = process->wait_next;
+    }
+    if (process->wait_next) {
+        process->wait_next->wait_prev = process->wait_prev;
+    } else {
+        queue->tail = process->wait_prev;
+    }
+    process->wait_queue = NULL;
+    process->wait_next = NULL;
+    process->wait_prev = NULL;
+}
+
+// Coloca o processo atual na fila e o marca como bloqueado
+// As duas coisas acontecem sob queue->lock: quem acorda vê o processo já
+// bloqueado ou ainda fora da fila, nunca no meio do caminho
+void wait_prepare(wait_queue_t* queue) {
+    process_t* process = process_get_current();
+    
+    u32 flags = spin_lock_irqsave(&queue->lock);
+    if (process->wait_queue != queue) {
+        wait_queue_append(queue, process);
+    }
+    process_block(process);
+    spin_unlock_irqrestore(&queue->lock, flags);
+}
+
+// Tira o processo atual da fila e desfaz o bloqueio, se a condição já valia
+void wait_finish(wait_queue_t* queue) {
+    process_t* process = process_get_current();
+    
+    u32 flags = spin_lock_irqsave(&queue->lock);
+    if (process->wait_queue == queue) {
+        wait_queue_unlink(queue, process);
+    }
+    spin_unlock_irqrestore(&queue->lock, flags);
+    
+    process_unblock_current();
+}
+
+// Acorda o primeiro processo da fila
+// O PID é lido antes de acordá-lo: enquanto está na fila, o processo não
+// pode ser terminado sem passar por queue->lock
+u32 wake_up_one(wait_queue_t* queue) {
+    u32 pid = 0;
+    u32 flags = spin_lock_irqsave(&queue->lock);
+    process_t* process = queue->head;
+    if (process) {
+        pid = process->pid;
+        wait_queue_unlink(queue, process);
+        scheduler_wake(process);
+    }
+    spin_unlock_irqrestore(&queue->lock, flags);
+    return pid;
+}
+
+// Acorda todos os processos da fila, na ordem em que começaram a esperar
+u32 wake_up_all(wait_queue_t* queue) {
+    u32 woken = 0;
+    u32 flags = spin_lock_irqsave(&queue->lock);
+    while (queue->head) {
+        process_t* process = queue->head;
+        wait_queue_unlink(queue, process);
+        scheduler_wake(process);
+        woken++;
+    }
+    spin_unlock_irqrestore(&queue->lock, flags);
+    return woken;
+}
+
+// Remove um processo da fila em que está esperando
+void wait_queue_remove(process_t* process) {
+    wait_queue_t* queue = process->wait_queue;
+    if (!queue) return;
+    
+    u32 flags = spin_lock_irqsave(&queue->lock);
+    if (process->wait_queue == queue) {
+        wait_queue_unlink(queue, process);
+    }
+    spin_unlock_irqrestore(&queue->lock, flags);
+}
@@ -0,0 +1,120 @@
+#include "../include/workqueue.h"
+#include "../include/memory.h"
+#include "../include/cpu.h"
+#include "../include/smp.h"
+
+// Fila de uso geral
+workqueue_t* system_workqueue = NULL;
+
+// Prepara um trabalho
+void work_init(work_t* work, void (*fn)(work_t* work)) {
+    work->fn = fn;
+    work->next = NULL;
+    work->state = 0;
+}
+
+// Empilha um trabalho na fila com cmpxchg, tentando de novo se outra CPU
+// empilhou antes, e acorda uma thread
+static void workqueue_push(workqueue_t* queue, work_t* work) {
+    u32 head;
+    do {
+        head = (u32)queue->pending;
+        work->next = (work_t*)head;
+    } while (cpu_cmpxchg((volatile u32*)&queue->pending, head, (u32)work) != head);
+    
+    wake_up_one(&queue->wait);
+}
+
+// Thread de uma fila: espera trabalho, leva tudo o que foi enfileirado e executa
+// A pilha é trocada por NULL com xchg, então não há ABA entre as threads
+static void workqueue_worker(void* arg) {
+    workqueue_t* queue = (workqueue_t*)arg;
+    
+    while (1) {
+        wait_event(&queue->wait, queue->pending != NULL);
+        
+        work_t* stack = (work_t*)cpu_xchg((volatile u32*)&queue->pending, 0);
+        
+        // Inverte a pilha para executar na ordem de chegada
+        work_t* list = NULL;
+        while (stack) {
+            work_t* work = stack;
+            stack = work->next;
+            work->next = list;
+            list = work;
+        }
+        
+        while (list) {
+            work_t* work = list;
+            list = work->next;
+            
+            // Sai de pendente antes de executar: a própria função (ou uma
+            // interrupção) pode reenfileirá-lo
+            // Um trabalho na pilha nunca está em execução, então o estado é WORK_PENDING
+            cpu_xchg(&work->state, WORK_RUNNING);
+            work->fn(work);
+            queue->completed++;
+            
+            // Reenfileirado durante a execução: só agora volta à fila
+            u32 state;
+            do {
+                state = work->state;
+            } while (cpu_cmpxchg(&work->state, state, state & ~WORK_RUNNING) != state);
+            if (state & WORK_PENDING) {
+                workqueue_push(queue, work);
+            }
+        }
+    }
+}
+
+// Cria uma fila de trabalho
+workqueue_t* workqueue_create(const char* name, u32 workers) {
+    workqueue_t* queue = (workqueue_t*)kmalloc(sizeof(workqueue_t));
+    if (!queue) return NULL;
+    
+    int i;
+    for (i = 0; i < 15 && name[i]; i++) {
+        queue->name[i] = name[i];
+    }
+    queue->name[i] = '\0';
+    queue->pending = NULL;
+    queue->completed = 0;
+    wait_queue_init(&queue->wait);
+    
+    if (workers < 1) workers = 1;
+    if (workers > WORKQUEUE_MAX_WORKERS) workers = WORKQUEUE_MAX_WORKERS;
+    
+    queue->worker_count = 0;
+    for (u32 w = 0; w < workers; w++) {
+        process_t* worker = kthread_create_named(queue->name, workqueue_worker, queue);
+        if (!worker) break;
+        queue->workers[queue->worker_count++] = worker;
+    }
+    if (!queue->worker_count) {
+        kfree(queue);
+        return NULL;
+    }
+    
+    return queue;
+}
+
+// Enfileira um trabalho
+u32 queue_work(workqueue_t* queue, work_t* work) {
+    // Já enfileirado e ainda não executado: a execução pendente basta
+    // Em execução: fica marcado e a thread que o executa o empilha ao terminar
+    u32 state;
+    do {
+        state = work->state;
+        if (state & WORK_PENDING) return 0;
+    } while (cpu_cmpxchg(&work->state, state, state | WORK_PENDING) != state);
+    
+    if (!(state & WORK_RUNNING)) {
+        workqueue_push(queue, work);
+    }
+    return 1;
+}
+
+// Cria a fila de uso geral, com uma thread por CPU
+void workqueue_init() {
+    system_workqueue = workqueue_create("events", smp_get_cpu_count());
+}
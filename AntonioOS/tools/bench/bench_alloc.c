@@ -0,0 +1,362 @@
+/* bench_alloc.c
+ * Benchmark dos alocadores do kernel (pmm, heap) no espaço de usuário do host
+ *
+ * Compilado junto com kernel/mm/memory.c por `make bench-host`, com
+ * -DHOST_BENCH. A memória física é simulada por uma arena mapeada em
+ * ARENA_BASE, e a janela do heap do kernel é mapeada no mesmo endereço
+ * usado pelo kernel. As cargas usam uma semente fixa, então duas execuções
+ * com os mesmos argumentos fazem exatamente as mesmas operações.
+ *
+ * Uso: bench_alloc [operações] [semente]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <math.h>
+#include <sys/mman.h>
+
+#include "memory.h"
+#include "interrupts.h"
+#include "vga.h"
+
+// Memória física simulada: [ARENA_BASE, ARENA_BASE + ARENA_SIZE)
+// Os endereços físicos devolvidos pelo pmm são usados diretamente
+#define ARENA_BASE 0x100000
+#define ARENA_SIZE (128 << 20)
+
+// Janela do heap do kernel (HEAP_START e HEAP_MAX_SIZE em memory.c)
+#define HEAP_WINDOW 0xD0000000
+#define HEAP_WINDOW_SIZE 0x10000000
+
+#define DEFAULT_OPS 1000000
+#define DEFAULT_SEED 0x5EED1234
+
+#define PMM_LIVE_MAX 4096
+#define HEAP_LIVE_MAX 8192
+#define CHURN_LIVE_MAX 16384
+#define CHURN_SAMPLES 10
+
+// Saída de vídeo e interrupções não existem no host
+void vga_write(const char* str) { fputs(str, stderr); }
+void vga_write_dec(u32 value) { fprintf(stderr, "%u", value); }
+void vga_write_hex(u32 value) { fprintf(stderr, "0x%08X", value); }
+void interrupt_register_handler(u8 vector, interrupt_handler_t handler) {
+    (void)vector;
+    (void)handler;
+}
+
+// Gerador pseudoaleatório (xorshift64*), reproduzível a partir da semente
+static u64 rng_state;
+
+static u32 rng_next() {
+    rng_state ^= rng_state >> 12;
+    rng_state ^= rng_state << 25;
+    rng_state ^= rng_state >> 27;
+    return (u32)((rng_state * 0x2545F4914F6CDD1DULL) >> 32);
+}
+
+static double rng_unit() {
+    return (rng_next() + 0.5) / 4294967296.0;
+}
+
+// Tamanho uniforme em [min, max]
+static u32 size_uniform(u32 min, u32 max) {
+    return min + rng_next() % (max - min + 1);
+}
+
+// Tamanho com distribuição de lei de potência (Pareto, alpha = 1.2):
+// muitos objetos pequenos e uma cauda longa de objetos grandes
+static u32 size_power_law(u32 min, u32 max) {
+    double size = min / pow(rng_unit(), 1.0 / 1.2);
+    return size > max ? max : (u32)size;
+}
+
+// Medição de tempo
+static u64 now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (u64)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static u64 timer_overhead;
+
+// Custo de duas leituras seguidas do relógio, descontado de cada amostra
+static void timer_calibrate() {
+    timer_overhead = ~0ULL;
+    for (int i = 0; i < 10000; i++) {
+        u64 start = now_ns();
+        u64 delta = now_ns() - start;
+        if (delta < timer_overhead) timer_overhead = delta;
+    }
+}
+
+// Amostras de latência de uma carga
+typedef struct {
+    u32* ns;
+    u32 count;
+    u64 total;
+} samples_t;
+
+static void samples_init(samples_t* s, u32 capacity) {
+    s->ns = (u32*)malloc(capacity * sizeof(u32));
+    s->count = 0;
+    s->total = 0;
+    if (!s->ns) {
+        perror("malloc");
+        exit(1);
+    }
+}
+
+static inline void samples_add(samples_t* s, u64 start, u64 end) {
+    u64 delta = end - start;
+    delta = delta > timer_overhead ? delta - timer_overhead : 0;
+    s->ns[s->count++] = (u32)delta;
+    s->total += delta;
+}
+
+static int compare_u32(const void* a, const void* b) {
+    u32 x = *(const u32*)a, y = *(const u32*)b;
+    return (x > y) - (x < y);
+}
+
+static u32 percentile(samples_t* s, double p) {
+    u32 index = (u32)(p * (s->count - 1));
+    return s->ns[index];
+}
+
+static void samples_report(const char* name, samples_t* s) {
+    if (!s->count) return;
+    qsort(s->ns, s->count, sizeof(u32), compare_u32);
+    printf("%-28s %9u %8.1f %7u %7u %7u %8u %9u\n", name, s->count,
+           (double)s->total / s->count, percentile(s, 0.50), percentile(s, 0.90),
+           percentile(s, 0.99), percentile(s, 0.999), s->ns[s->count - 1]);
+    free(s->ns);
+}
+
+// Fragmentação externa: fração da memória livre fora do maior bloco livre
+static double heap_fragmentation(heap_stats_t* stats) {
+    if (!stats->free_bytes) return 0.0;
+    return 1.0 - (double)stats->largest_free / stats->free_bytes;
+}
+
+// Carga 1: mistura aleatória de pmm_alloc_frame/pmm_free_frame
+static void bench_pmm_mix(u32 ops) {
+    static void* live[PMM_LIVE_MAX];
+    u32 count = 0;
+    samples_t alloc, release;
+    samples_init(&alloc, ops);
+    samples_init(&release, ops);
+
+    for (u32 i = 0; i < ops; i++) {
+        if (count < PMM_LIVE_MAX && (count == 0 || rng_next() % 2)) {
+            u64 start = now_ns();
+            void* frame = pmm_alloc_frame();
+            samples_add(&alloc, start, now_ns());
+            if (frame) live[count++] = frame;
+        } else {
+            u32 victim = rng_next() % count;
+            void* frame = live[victim];
+            live[victim] = live[--count];
+            u64 start = now_ns();
+            pmm_free_frame(frame);
+            samples_add(&release, start, now_ns());
+        }
+    }
+    while (count) pmm_free_frame(live[--count]);
+
+    samples_report("pmm_alloc_frame", &alloc);
+    samples_report("pmm_free_frame", &release);
+}
+
+// Carga 2: frames zerados com a reserva vazia (zeragem na hora) e cheia
+static void bench_pmm_zeroed(u32 ops) {
+    samples_t miss, hit;
+    samples_init(&miss, ops);
+    samples_init(&hit, ops);
+    void* frames[PMM_ZERO_POOL_SIZE];
+
+    for (u32 done = 0; done + PMM_ZERO_POOL_SIZE <= ops; done += PMM_ZERO_POOL_SIZE) {
+        // Reserva vazia
+        for (u32 i = 0; i < PMM_ZERO_POOL_SIZE; i++) {
+            u64 start = now_ns();
+            frames[i] = pmm_alloc_zeroed_frame();
+            samples_add(&miss, start, now_ns());
+        }
+        for (u32 i = 0; i < PMM_ZERO_POOL_SIZE; i++) pmm_free_frame(frames[i]);
+
+        // Reserva cheia, como se o idle tivesse rodado
+        pmm_refill_zero_pool();
+        for (u32 i = 0; i < PMM_ZERO_POOL_SIZE; i++) {
+            u64 start = now_ns();
+            frames[i] = pmm_alloc_zeroed_frame();
+            samples_add(&hit, start, now_ns());
+        }
+        for (u32 i = 0; i < PMM_ZERO_POOL_SIZE; i++) pmm_free_frame(frames[i]);
+    }
+
+    samples_report("pmm_alloc_zeroed (vazia)", &miss);
+    samples_report("pmm_alloc_zeroed (cheia)", &hit);
+}
+
+// Cargas 3 e 4: mistura aleatória de kmalloc/kfree com uma distribuição de tamanhos
+static void bench_heap_mix(u32 ops, const char* alloc_name, const char* free_name,
+                           u32 (*size_of)(u32, u32)) {
+    static void* live[HEAP_LIVE_MAX];
+    u32 count = 0;
+    samples_t alloc, release;
+    samples_init(&alloc, ops);
+    samples_init(&release, ops);
+
+    for (u32 i = 0; i < ops; i++) {
+        if (count < HEAP_LIVE_MAX && (count == 0 || rng_next() % 2)) {
+            u32 size = size_of(16, 65536);
+            u64 start = now_ns();
+            void* ptr = kmalloc(size);
+            samples_add(&alloc, start, now_ns());
+            if (ptr) live[count++] = ptr;
+        } else {
+            u32 victim = rng_next() % count;
+            void* ptr = live[victim];
+            live[victim] = live[--count];
+            u64 start = now_ns();
+            kfree(ptr);
+            samples_add(&release, start, now_ns());
+        }
+    }
+    while (count) kfree(live[--count]);
+
+    samples_report(alloc_name, &alloc);
+    samples_report(free_name, &release);
+}
+
+static u32 size_small_uniform(u32 min, u32 max) {
+    (void)max;
+    return size_uniform(min, 4096);
+}
+
+// Carga 5: rotatividade longa com tempos de vida variados e krealloc,
+// acompanhando a fragmentação do heap ao longo da execução
+static void bench_heap_churn(u32 ops) {
+    static void* live[CHURN_LIVE_MAX];
+    static u32 live_size[CHURN_LIVE_MAX];
+    u32 count = 0;
+    u64 live_bytes = 0;
+    samples_t alloc, release, resize;
+    samples_init(&alloc, ops);
+    samples_init(&release, ops);
+    samples_init(&resize, ops);
+    heap_stats_t stats;
+
+    printf("\nRotatividade longa (%u operacoes, ate %u objetos vivos)\n", ops, CHURN_LIVE_MAX);
+    printf("%10s %10s %12s %12s %12s %10s\n", "operacao", "objetos", "vivos(B)",
+           "heap(B)", "maior livre", "frag");
+
+    for (u32 i = 0; i < ops; i++) {
+        // Mantém a ocupação oscilando entre metade e o total da capacidade
+        u32 target = CHURN_LIVE_MAX / 2 + (u32)((CHURN_LIVE_MAX / 2) *
+                     (0.5 + 0.5 * sin(i * 6.283185 / (ops / 4 + 1))));
+        u32 op = rng_next() % 10;
+
+        if (count && op == 0) {
+            u32 victim = rng_next() % count;
+            u32 size = size_power_law(16, 65536);
+            u64 start = now_ns();
+            void* ptr = krealloc(live[victim], size);
+            samples_add(&resize, start, now_ns());
+            if (ptr) {
+                live_bytes += size;
+                live_bytes -= live_size[victim];
+                live[victim] = ptr;
+                live_size[victim] = size;
+            }
+        } else if (count < target) {
+            u32 size = size_power_law(16, 65536);
+            u64 start = now_ns();
+            void* ptr = kmalloc(size);
+            samples_add(&alloc, start, now_ns());
+            if (ptr) {
+                live[count] = ptr;
+                live_size[count++] = size;
+                live_bytes += size;
+            }
+        } else if (count) {
+            // Objetos mais antigos (início do vetor) tendem a viver mais
+            u32 victim = count - 1 - (u32)(count * rng_unit() * rng_unit());
+            u64 start = now_ns();
+            kfree(live[victim]);
+            samples_add(&release, start, now_ns());
+            live_bytes -= live_size[victim];
+            live[victim] = live[count - 1];
+            live_size[victim] = live_size[--count];
+        }
+
+        if ((i + 1) % (ops / CHURN_SAMPLES) == 0) {
+            heap_get_stats(&stats);
+            printf("%10u %10u %12llu %12u %12u %9.1f%%\n", i + 1, count,
+                   (unsigned long long)live_bytes, stats.heap_size,
+                   stats.largest_free, 100.0 * heap_fragmentation(&stats));
+        }
+    }
+
+    heap_get_stats(&stats);
+    printf("Sobrecarga final: heap %u B para %llu B vivos (%.2fx)\n\n", stats.heap_size,
+           (unsigned long long)live_bytes, live_bytes ? (double)stats.heap_size / live_bytes : 0.0);
+
+    while (count) kfree(live[--count]);
+
+    printf("%-28s %9s %8s %7s %7s %7s %8s %9s\n", "operacao", "amostras", "ns/op",
+           "p50", "p90", "p99", "p99.9", "max");
+    samples_report("kmalloc (rotatividade)", &alloc);
+    samples_report("kfree (rotatividade)", &release);
+    samples_report("krealloc (rotatividade)", &resize);
+}
+
+// Mapeia uma região do host em um endereço fixo
+static void map_fixed(u32 address, u32 size, int flags) {
+    void* p = mmap((void*)(unsigned long)address, size, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE | flags, -1, 0);
+    if (p != (void*)(unsigned long)address) {
+        fprintf(stderr, "bench_alloc: nao foi possivel mapear 0x%08X\n", address);
+        exit(1);
+    }
+}
+
+int main(int argc, char** argv) {
+    u32 ops = argc > 1 ? (u32)strtoul(argv[1], NULL, 0) : DEFAULT_OPS;
+    u64 seed = argc > 2 ? strtoull(argv[2], NULL, 0) : DEFAULT_SEED;
+    if (ops < CHURN_SAMPLES) ops = CHURN_SAMPLES;
+
+    map_fixed(ARENA_BASE, ARENA_SIZE, 0);
+    map_fixed(HEAP_WINDOW, HEAP_WINDOW_SIZE, MAP_NORESERVE);
+
+    // Mapa de memória no formato do Multiboot: memória baixa e a arena
+    static memory_map_entry_t mmap_entries[2] = {
+        { sizeof(memory_map_entry_t) - 4, 0, 0x9FC00, 1 },
+        { sizeof(memory_map_entry_t) - 4, ARENA_BASE, ARENA_SIZE, 1 },
+    };
+    pmm_init(0, mmap_entries, sizeof(mmap_entries));
+    vmm_init();
+    heap_init();
+
+    timer_calibrate();
+    printf("bench_alloc: %u operacoes, semente 0x%llX, %u MB de memoria fisica\n",
+           ops, (unsigned long long)seed, ARENA_SIZE >> 20);
+    printf("Latencias em ns (custo do relogio, %llu ns, ja descontado)\n\n",
+           (unsigned long long)timer_overhead);
+    printf("%-28s %9s %8s %7s %7s %7s %8s %9s\n", "operacao", "amostras", "ns/op",
+           "p50", "p90", "p99", "p99.9", "max");
+
+    rng_state = seed;
+    bench_pmm_mix(ops);
+    bench_pmm_zeroed(ops / 16);
+    rng_state = seed;
+    bench_heap_mix(ops, "kmalloc (uniforme 16-4K)", "kfree (uniforme 16-4K)", size_small_uniform);
+    rng_state = seed;
+    bench_heap_mix(ops, "kmalloc (lei de potencia)", "kfree (lei de potencia)", size_power_law);
+    rng_state = seed;
+    bench_heap_churn(ops * 2);
+
+    return 0;
+}